@@ -4,18 +4,42 @@
 include(../common/common.pri)
 TARGET = ClothSimulation
 
+# The wind is driven by the bundled libnoise (build ../common/packages/noise first)
+INCLUDEPATH += ../common/packages/noise/src
+LIBS += -L../common/packages/noise/lib -lnoise
+
 # Input
 SOURCES += src/main.cpp \
            ../common/src/scene.cpp \
            ../common/src/camera.cpp \
            ../common/src/trackballcamera.cpp \
-    src/ClothScene.cpp
+           ../common/src/workstealingpool.cpp \
+    src/ClothScene.cpp \
+    src/PointCache.cpp \
+    src/PointCacheCodec.cpp \
+    src/Cloth.cpp \
+    src/ClothWorld.cpp \
+    src/ClothTopology.cpp \
+    src/SpringStream.cpp \
+    src/MeshLoader.cpp \
+    src/ShaderPrograms.cpp \
+    src/WindField.cpp
 
 HEADERS += \
            ../common/include/scene.h \
            ../common/include/camera.h \
            ../common/include/trackballcamera.h \
-    src/ClothScene.h
+           ../common/include/workstealingpool.h \
+    src/ClothScene.h \
+    src/PointCache.h \
+    src/PointCacheCodec.h \
+    src/Cloth.h \
+    src/ClothWorld.h \
+    src/ClothTopology.h \
+    src/SpringStream.h \
+    src/MeshLoader.h \
+    src/ShaderPrograms.h \
+    src/WindField.h
 
 OTHER_FILES += \
            shaders/* \
@@ -0,0 +1,39 @@
+#version 410 core                                            // Keeping you on the bleeding edge!
+
+// The modelview and projection matrices are no longer given in OpenGL 4.2
+uniform mat4 MVP;
+uniform mat4 MV;
+uniform mat3 N; // This is the inverse transpose of the mv matrix
+
+// Positions and normals of every cloth in the group, one after the other
+uniform samplerBuffer Positions;
+uniform samplerBuffer Normals;
+uniform int VerticesPerInstance;
+
+// Where this instance sits in the world (advanced once per instance)
+layout (location=3) in vec3 InstanceOffset;
+
+// These attributes are passed onto the shader (should they all be smoothed?)
+smooth out vec3 WSVertexPosition;
+smooth out vec3 WSVertexNormal;
+smooth out vec2 WSTexCoord;
+
+void main()
+{
+    // For indexed draws gl_VertexID is the index, so this finds our vertex of our cloth
+    int idx = gl_InstanceID * VerticesPerInstance + gl_VertexID;
+    vec3 VertexPosition = texelFetch(Positions, idx).xyz + InstanceOffset;
+    vec3 VertexNormal = texelFetch(Normals, idx).xyz;
+
+    // Transform the vertex normal by the inverse transpose modelview matrix
+    WSVertexNormal = normalize(N * VertexNormal);
+
+    // Compute the unprojected vertex position
+    WSVertexPosition = vec3(MV * vec4(VertexPosition, 1.0) );
+
+    // There are no texture coordinates on the cloth
+    WSTexCoord = vec2(0.0);
+
+    // Compute the position of the vertex
+    gl_Position = MVP * vec4(VertexPosition,1.0);
+}
@@ -0,0 +1,743 @@
+#include "Cloth.h"
+#include "ClothTopology.h"
+#include "SpringStream.h"
+#include "WindField.h"
+
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+Cloth::Cloth(const ClothParameters &_params) : m_params(_params), res(_params.res)
+{
+  last_time = clock();
+}
+
+void Cloth::initSpringsAndVerts()
+{
+  m_springs.clear();
+  m_isGrid = true;
+  m_triangles.clear();
+  res = m_params.res;
+  vertexPositions.resize(res*res);
+  vertexNormals.resize(res*res);
+  pointMasses.resize(res*res);
+  m_forces.resize(res*res);
+
+  //--------------------------STRUCTURAL SPRINGS---------------
+
+  for(int i=0; i<res; ++i)
+  {
+    for(int j=0; j<res; ++j)
+    {
+      m_forces[i*res + j] = glm::vec3(0.0f);
+      // j is x
+      // i is y
+      vertexPositions[i*res + j]=glm::vec3(float(j)/float(res),float(i)/float(res),0.0f);
+
+      //if(i==0 && j==0) std::cout<<"0,0: "<<vertexPositions[i*res + j].x<<","<<vertexPositions[i*res + j].y<<","<<vertexPositions[i*res + j].z<<"\n";
+      //if(i==0 && j==res-1) std::cout<<"0,0: "<<vertexPositions[i*res + j].x<<","<<vertexPositions[i*res + j].y<<","<<vertexPositions[i*res + j].z<<"\n";
+
+      vertexNormals[i*res + j] = glm::vec3(0.0f,0.0f,1.0f);
+      PointMass newPoint;
+      newPoint.velocity = glm::vec3(0.0f);
+      newPoint.prevPos = glm::vec3(float(j)/float(res),float(i)/float(res),0.0f);
+      newPoint.index = i*res + j;
+      newPoint.mass = 1.0f;
+      pointMasses[i*res + j]=newPoint;
+      //-----------SETUP SPRINGS---------------
+      if(j!=(res-1) && i!=(res-1))
+      {
+        Spring newLink1;
+        newLink1.PointMassA = i*res+j;
+        newLink1.PointMassB = i*res+j+1;
+        newLink1.restingDistance=1.0f/float(res);
+        newLink1.stiffness=m_params.stiffness;
+        newLink1.damping=m_params.damping;
+        m_springs.push_back(newLink1);
+        Spring newLink2;
+        newLink2.PointMassA = i*res+j;
+        newLink2.PointMassB = (i+1)*res+j;
+        newLink2.restingDistance=1.0f/float(res);
+        newLink2.stiffness=m_params.stiffness;
+        newLink2.damping=m_params.damping;
+        m_springs.push_back(newLink2);
+      }
+      //-------------FAR LEFT-------------------
+      else if(j==(res-1) && i!=(res-1))
+      {
+        Spring newLink2;
+        newLink2.PointMassA = i*res+j;
+        newLink2.PointMassB = (i+1)*res+j;
+        newLink2.restingDistance=1.0f/float(res);
+        newLink2.stiffness=m_params.stiffness;
+        newLink2.damping=m_params.damping;
+        m_springs.push_back(newLink2);
+      }
+      //-------------TOP ROW------------------
+      else if(i==(res-1)&&j!=(res-1))
+      {
+        Spring newLink1;
+        newLink1.PointMassA = i*res+j;
+        newLink1.PointMassB = i*res+j+1;
+        newLink1.restingDistance=1.0f/float(res);
+
+        newLink1.stiffness=m_params.stiffness;
+        newLink1.damping=m_params.damping;
+        m_springs.push_back(newLink1);
+      }
+    }
+  }
+
+  //--------------BEND SPRINGS----------------------
+
+  for(int i =0 ; i<res; ++i)
+  {
+      for(int j =0; j<res; ++j)
+      {
+          if(i<(res-2) && j<(res-2))
+          {
+            Spring newBend;
+            newBend.PointMassA = i*res + j;
+            newBend.PointMassB = i*res + j + 2;
+            newBend.restingDistance = 2.0f/float(res);
+            newBend.stiffness=m_params.stiffness;
+            newBend.damping=m_params.damping;
+            m_springs.push_back(newBend);
+            Spring newBend2;
+            newBend2.PointMassA = i*res + j;
+            newBend2.PointMassB = (i+2)*res + j;
+            newBend2.restingDistance = 2.0f/float(res);
+            newBend2.stiffness=m_params.stiffness;
+            newBend2.damping=m_params.damping;
+            m_springs.push_back(newBend2);
+          }
+          else if(i>=(res-2) && j<(res-2))
+          {
+              Spring newBend;
+              newBend.PointMassA = i*res + j;
+              newBend.PointMassB = i*res + j + 2;
+              newBend.restingDistance = 2.0f/float(res);
+              newBend.stiffness=m_params.stiffness;
+              newBend.damping=m_params.damping;
+              m_springs.push_back(newBend);
+          }
+          else if(j>=(res-2) && i<(res-2))
+          {
+              Spring newBend2;
+              newBend2.PointMassA = i*res + j;
+              newBend2.PointMassB = (i+2)*res + j;
+              newBend2.restingDistance = 2.0f/float(res);
+              newBend2.stiffness=m_params.stiffness;
+              newBend2.damping=m_params.damping;
+              m_springs.push_back(newBend2);
+          }
+      }
+  }
+  //---------------SHEAR SPRINGS-----------------------
+  float normald = 1.0f/float(res);
+  float distance = sqrt(2*(normald*normald));
+  for(int i =0; i<res; ++i)
+  {
+      for(int j=0; j<res; ++j)
+      {
+          if(j!=(res-1) && i!=(res-1))
+          {
+            Spring newLink1;
+            newLink1.PointMassA = i*res+j;
+            newLink1.PointMassB = (i+1)*res+j+1;
+            newLink1.restingDistance=distance;
+            newLink1.stiffness=m_params.stiffness;
+            newLink1.damping=m_params.damping;
+            m_springs.push_back(newLink1);
+            Spring newLink2;
+            newLink2.PointMassA = i*res+j+1;
+            newLink2.PointMassB = (i+1)*res+j;
+            newLink2.restingDistance=distance;
+            newLink2.stiffness=m_params.stiffness;
+            newLink2.damping=m_params.damping;
+            m_springs.push_back(newLink2);
+          }
+      }
+  }
+
+  //---------------ANCHORS-----------------------
+  m_pins.clear();
+  m_pins.push_back(std::make_pair((res-1)*res, glm::vec3(0.0f,(float(res)-1.0f)/float(res),0.0f)));
+  m_pins.push_back(std::make_pair((res-1)*res + res -1, glm::vec3((float(res)-1.0f)/float(res),(float(res)-1.0f)/float(res),0.0f)));
+
+  initSolver();
+}
+
+void Cloth::initFromTopology(const ClothTopology &_topology)
+{
+  m_isGrid = false;
+  res = 0;
+  vertexPositions = _topology.positions();
+  m_triangles = _topology.triangles();
+  _topology.buildSprings(m_params.stiffness, m_params.damping, m_springs);
+  m_pins.clear();
+
+  size_t count = vertexPositions.size();
+  vertexNormals.assign(count, glm::vec3(0.0f,0.0f,1.0f));
+  m_forces.assign(count, glm::vec3(0.0f));
+  pointMasses.resize(count);
+  for(size_t i=0; i<count; ++i)
+  {
+    pointMasses[i].velocity = glm::vec3(0.0f);
+    pointMasses[i].prevPos = vertexPositions[i];
+    pointMasses[i].index = int(i);
+    pointMasses[i].mass = 1.0f;
+  }
+
+  initSolver();
+  updateNormals(&vertexPositions[0]);
+}
+
+void Cloth::pin(int _particle)
+{
+  m_pins.push_back(std::make_pair(_particle, vertexPositions[_particle]));
+}
+
+void Cloth::initSolver()
+{
+  m_springStream.encode(m_springs);
+  initTiles();
+
+  if(m_isGrid) m_spacing = 1.0f/float(res);
+  else
+  {
+    float total = 0.0f;
+    for(const Spring &spring : m_springs) total += spring.restingDistance;
+    m_spacing = m_springs.empty() ? 0.0f : total/float(m_springs.size());
+  }
+
+  // Every particle weighs the same, so this is what spreads a triangle's wind force
+  std::vector<unsigned int> tris;
+  buildTriangles(tris);
+  float area = 0.0f;
+  for(size_t t=0; t+2<tris.size(); t+=3)
+  {
+    glm::vec3 a = vertexPositions[tris[t]], b = vertexPositions[tris[t+1]], c = vertexPositions[tris[t+2]];
+    area += 0.5f*glm::length(glm::cross(b - a, c - a));
+  }
+  m_particlesPerArea = area > 0.0f ? float(vertexPositions.size())/area : 0.0f;
+
+  // Everything from here on reads the packed springs
+  std::vector<Spring>().swap(m_springs);
+}
+
+void Cloth::initTiles()
+{
+  int count = int(vertexPositions.size());
+  m_particleTile.resize(count);
+  int numTiles = 0;
+  if(m_isGrid)
+  {
+    // Square tiles over the sheet, rows are rows of the sheet
+    int tilesX = (res + s_tileSize - 1)/s_tileSize;
+    for(int p=0; p<count; ++p) m_particleTile[p] = ((p/res)/s_tileSize)*tilesX + (p%res)/s_tileSize;
+    numTiles = tilesX*tilesX;
+    m_rowLength = res;
+  }
+  else
+  {
+    // A mesh has no rows, so a tile and a row are both just a run of particles
+    m_rowLength = s_tileSize*s_tileSize;
+    for(int p=0; p<count; ++p) m_particleTile[p] = p/m_rowLength;
+    numTiles = (count + m_rowLength - 1)/m_rowLength;
+  }
+
+  m_tiles.assign(numTiles, Tile());
+  m_tileParticles.assign(numTiles, std::vector<int>());
+  for(int p=0; p<count; ++p) m_tileParticles[m_particleTile[p]].push_back(p);
+
+  m_tileNeighbours.assign(numTiles, std::vector<int>());
+  for(const Spring &spring : m_springs)
+  {
+    int a = m_particleTile[spring.PointMassA], b = m_particleTile[spring.PointMassB];
+    if(a == b) continue;
+    m_tileNeighbours[a].push_back(b);
+    m_tileNeighbours[b].push_back(a);
+  }
+  for(std::vector<int> &neighbours : m_tileNeighbours)
+  {
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+  }
+
+  int numRows = (count + m_rowLength - 1)/m_rowLength;
+  m_rowMoved.assign(numRows, 1);
+  m_rowChanged.assign(numRows, 1);
+  m_invMass.resize(count);
+  m_stepStart.resize(count);
+  m_windAcceleration.assign(count, glm::vec3(0.0f));
+  m_activeDirty = true;
+}
+
+void Cloth::buildTriangles(std::vector<unsigned int> &o_tris) const
+{
+  if(!m_isGrid)
+  {
+    o_tris = m_triangles;
+    return;
+  }
+
+  // Define some connectivity information for our sheet.
+  unsigned int num_tris = (res-1)*(res-1)*2;
+  o_tris.resize(num_tris*3);
+  int i, j, fidx = 0;
+  for (i=0; i < res - 1; ++i) {
+      for (j=0; j < res - 1; ++j) {
+          o_tris[fidx*3+0] = i*res+j; o_tris[fidx*3+1] = i*res+j+1; o_tris[fidx*3+2] = (i+1)*res+j;
+          fidx++;
+          o_tris[fidx*3+0] = i*res+j+1; o_tris[fidx*3+1] = (i+1)*res+j+1; o_tris[fidx*3+2] = (i+1)*res+j;
+          fidx++;
+      }
+  }
+}
+
+void Cloth::updateSimulation(integrators _whichIntegrator, const glm::vec3 &_sphereCentre, float _sphereRadius)
+{
+  float deltaT = float(clock()-last_time)/CLOCKS_PER_SEC;
+  last_time = clock();
+
+  float timestepLength = 0.016f;
+  int timesteps = floor(float(deltaT+leftOvertime)/timestepLength);
+  leftOvertime=deltaT-timestepLength*timesteps;
+
+  //std::cout<<"deltaT: "<<deltaT<<"timesteps"<<timesteps<<"\n";
+  timesteps=3;
+
+  //---------------------------------WAKE------------------------------------
+  // A sleeping tile the collider is about to touch has to be simulated again. Pad by a
+  // particle spacing so it wakes a frame before contact rather than after.
+  float pad = _sphereRadius + m_spacing;
+  for(int t=0; t<numTiles(); ++t)
+  {
+    if(!m_tiles[t].asleep) continue;
+    glm::vec3 closest = glm::clamp(_sphereCentre, m_tiles[t].min, m_tiles[t].max);
+    glm::vec3 toSphere = closest - _sphereCentre;
+    if(glm::dot(toSphere,toSphere) < pad*pad) setAsleep(t, false);
+  }
+  // Likewise when the wind over it has changed by a good fraction of its mean speed
+  if(m_wind)
+  {
+    float change = 0.25f*glm::length(m_wind->parameters().velocity);
+    for(int t=0; t<numTiles(); ++t)
+    {
+      if(!m_tiles[t].asleep) continue;
+      glm::vec3 difference = m_wind->velocity(0.5f*(m_tiles[t].min + m_tiles[t].max)) - m_tiles[t].wind;
+      if(glm::dot(difference,difference) > change*change) setAsleep(t, false);
+    }
+  }
+  if(m_activeDirty) rebuildActive();
+
+  for(int p : m_activeParticles) m_stepStart[p] = vertexPositions[p];
+
+  //---------------------------------WIND------------------------------------
+  // Once a frame, the field itself only changes once a frame
+  computeWind(_whichIntegrator, timestepLength);
+
+  for(int n =0; n<timesteps; ++n)
+  {
+    for(int m = 0; m<5; ++m)
+    {
+      std::fill(m_forces.begin(), m_forces.end(), glm::vec3(0.0f,0.0f,0.0f));
+      //------------------------------SPRINGS---------------------------------
+      // Straight off the packed stream while everything is awake, otherwise off the
+      // copy of it that leaves out springs between two sleeping particles
+      const std::vector<CompactSpring> &springs = m_allAwake ? m_springStream.springs() : m_activeSprings;
+      for(int s=0; s<springs.size(); ++s)
+      {
+        int A, B;
+        float restingDistance, stiffness;
+        m_springStream.decode(springs[s], A, B, restingDistance, stiffness);
+        if(_whichIntegrator==EULER_FORCES)
+        {
+          float Kr = stiffness;
+          float Kd = 0.1f;
+          glm::vec3 L = vertexPositions[A] - vertexPositions[B];
+          float Lnorm = glm::length(L);
+          float R = restingDistance;
+          glm::vec3 vA = pointMasses[A].velocity;
+          glm::vec3 vB = pointMasses[B].velocity;
+
+          glm::vec3 ourForce = - Kr*(Lnorm - R)*(L/Lnorm) - Kd*(glm::dot(vA-vB,L)/Lnorm)*(L/Lnorm);
+          //if(A==0 || B==0) std::cout<<ourForce.x<<","<<ourForce.y<<","<<ourForce.z<<"\n";
+          m_forces[A] += ourForce;
+          m_forces[B] -= ourForce;
+        }
+        else
+        {
+          glm::vec3 differenceXYZ = vertexPositions[A] - vertexPositions[B];
+          float d = glm::length(differenceXYZ);
+
+          //-------------------------------------------------------------------
+
+          float im1 = m_invMass[A];
+          float im2 = m_invMass[B];
+
+          float scalarP1 = (im1 / (im1 + im2)) * stiffness;
+          float scalarP2 =  stiffness - scalarP1;
+
+          //-------------------------------------------------------------------
+
+          float differenceScalar = (restingDistance -d)/d;
+
+          glm::vec3 translationP1 = differenceXYZ*scalarP1*differenceScalar;
+          glm::vec3 translationP2 = differenceXYZ*scalarP2*differenceScalar;
+
+          vertexPositions[A] += translationP1;
+          vertexPositions[B] -= translationP2;
+        }
+      }
+
+      //------------------------------ANCHORS---------------------------------
+      // (a sleeping anchor stays where it fell asleep, so nothing moves behind our back)
+
+      for(const std::pair<int,glm::vec3> &pin : m_pins)
+      {
+        if(m_invMass[pin.first] > 0.0f) vertexPositions[pin.first] = pin.second;
+      }
+
+    }
+
+
+    //---------------------------SPHERE COLLISION------------------------------
+    for(int p : m_activeParticles)
+    {
+      glm::vec3 distance = vertexPositions[p] - _sphereCentre;
+      float d = glm::length(distance);
+
+      float radius = _sphereRadius;
+      if(d<radius)
+      {
+        vertexPositions[p]+=((radius-d)/radius)*distance;
+      }
+    }
+
+    //--------------------------VERLET/EULER INTEGRATION----------------------------
+    for(int p : m_activeParticles)
+    {
+      if(_whichIntegrator==VERLET)
+      {
+        pointMasses[p].velocity = vertexPositions[p] - pointMasses[p].prevPos;
+        pointMasses[p].prevPos = vertexPositions[p];
+
+        glm::vec3 acceleration = m_params.gravity + m_windAcceleration[p];
+        //glm::vec3 acceleration = glm::vec3(0.0f,0.0f,0.0f);
+
+        vertexPositions[p] = vertexPositions[p] + pointMasses[p].velocity + acceleration*timestepLength;
+      }
+      else if(_whichIntegrator==EULER)
+      {
+        glm::vec3 gravity = m_params.gravity;
+        //glm::vec3 gravity = glm::vec3(0.0f,0.0f,0.0f);
+        pointMasses[p].velocity = pointMasses[p].velocity + (gravity + m_windAcceleration[p])*timestepLength;
+        vertexPositions[p] = vertexPositions[p] + pointMasses[p].velocity*timestepLength;
+      }
+      else if(_whichIntegrator==EULER_FORCES)
+      {
+        // gravity
+        //m_forces[p] = m_forces[p] - glm::vec3(0.0f,0.98f,0.0f);
+
+        // acceleration
+        glm::vec3 an = m_forces[p] + m_params.gravity + m_windAcceleration[p];
+
+        // velocity
+        pointMasses[p].velocity = pointMasses[p].velocity + an*timestepLength;
+
+        // position
+        vertexPositions[p] = vertexPositions[p] + pointMasses[p].velocity*timestepLength;
+
+      }
+    }
+  }
+
+  //---------------------------------SLEEP-----------------------------------
+  for(Tile &tile : m_tiles)
+  {
+    tile.moved = !tile.asleep;
+    tile.energy = 0.0f;
+  }
+  std::fill(m_rowMoved.begin(), m_rowMoved.end(), 0);
+  for(int p : m_activeParticles)
+  {
+    glm::vec3 step = vertexPositions[p] - m_stepStart[p];
+    float &energy = m_tiles[m_particleTile[p]].energy;
+    energy = std::max(energy, glm::dot(step,step));
+    if(glm::dot(step,step) > 0.0f) m_rowMoved[p/m_rowLength] = 1;
+  }
+  int numRows = int(m_rowMoved.size());
+  for(int i=0; i<numRows; ++i)
+  {
+    if(m_isGrid)
+    {
+      m_rowChanged[i] = m_rowMoved[i] || (i>0 && m_rowMoved[i-1]) || (i<numRows-1 && m_rowMoved[i+1]);
+    }
+    else
+    {
+      m_rowChanged[i] = m_rowMoved[i];
+      for(int t : m_tileNeighbours[i]) m_rowChanged[i] = m_rowChanged[i] || m_rowMoved[t];
+    }
+  }
+
+  float quiet = m_params.sleepSpeed*m_params.sleepSpeed;
+  for(int t=0; t<numTiles(); ++t)
+  {
+    Tile &tile = m_tiles[t];
+    if(tile.asleep || !tile.moved) continue;
+    if(tile.energy < quiet)
+    {
+      if(++tile.quietFrames >= m_params.sleepFrames) setAsleep(t, true);
+    }
+    else
+    {
+      tile.quietFrames = 0;
+      // Moving well above the threshold disturbs whatever is asleep next door
+      if(tile.energy > 16.0f*quiet)
+      {
+        for(int n : m_tileNeighbours[t])
+          if(m_tiles[n].asleep) setAsleep(n, false);
+      }
+    }
+  }
+
+  // Normals read the neighbouring particles, so a tile's normals (and therefore its
+  // upload) change if it or any tile around it moved
+  for(int t=0; t<numTiles(); ++t)
+  {
+    bool changed = m_tiles[t].moved;
+    for(int n : m_tileNeighbours[t]) changed = changed || m_tiles[n].moved;
+    m_tiles[t].changed = changed;
+  }
+}
+
+void Cloth::setAsleep(int _tile, bool _asleep)
+{
+  Tile &tile = m_tiles[_tile];
+  tile.asleep = _asleep;
+  tile.quietFrames = 0;
+  m_activeDirty = true;
+
+  if(_asleep)
+  {
+    // Come to a complete stop so nothing is left over to integrate when we wake
+    tile.min = tile.max = vertexPositions[m_tileParticles[_tile][0]];
+    for(int p : m_tileParticles[_tile])
+    {
+      pointMasses[p].velocity = glm::vec3(0.0f);
+      pointMasses[p].prevPos = vertexPositions[p];
+      tile.min = glm::min(tile.min, vertexPositions[p]);
+      tile.max = glm::max(tile.max, vertexPositions[p]);
+    }
+    if(m_wind) tile.wind = m_wind->velocity(0.5f*(tile.min + tile.max));
+  }
+}
+
+void Cloth::setWind(const WindField *_wind)
+{
+  m_wind = _wind;
+  std::fill(m_windAcceleration.begin(), m_windAcceleration.end(), glm::vec3(0.0f));
+  // Whatever is asleep settled in different air
+  wake();
+}
+
+void Cloth::bounds(glm::vec3 &o_min, glm::vec3 &o_max) const
+{
+  o_min = o_max = vertexPositions.empty() ? glm::vec3(0.0f) : vertexPositions[0];
+  for(const glm::vec3 &p : vertexPositions)
+  {
+    o_min = glm::min(o_min, p);
+    o_max = glm::max(o_max, p);
+  }
+}
+
+void Cloth::computeWind(integrators _whichIntegrator, float _timestepLength)
+{
+  if(!m_wind) return;
+  std::fill(m_windAcceleration.begin(), m_windAcceleration.end(), glm::vec3(0.0f));
+
+  const WindParameters &params = m_wind->parameters();
+  float share = m_particlesPerArea/6.0f;
+  auto velocity = [&](int _p)
+  {
+    // Verlet only keeps the last step's displacement
+    if(_whichIntegrator == VERLET) return (vertexPositions[_p] - pointMasses[_p].prevPos)/_timestepLength;
+    return pointMasses[_p].velocity;
+  };
+  auto addTriangle = [&](int _a, int _b, int _c)
+  {
+    if(m_invMass[_a] == 0.0f && m_invMass[_b] == 0.0f && m_invMass[_c] == 0.0f) return;
+    glm::vec3 a = vertexPositions[_a], b = vertexPositions[_b], c = vertexPositions[_c];
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    float twiceArea = glm::length(normal);
+    if(twiceArea <= 0.0f) return;
+    normal /= twiceArea;
+
+    // The air as the triangle sees it, with the normal turned to face downwind
+    glm::vec3 air = m_wind->velocity((a + b + c)/3.0f) - (velocity(_a) + velocity(_b) + velocity(_c))/3.0f;
+    float speed = glm::length(air);
+    if(speed <= 0.0f) return;
+    glm::vec3 along = air/speed;
+    float facing = glm::dot(normal, along);
+    if(facing < 0.0f)
+    {
+      normal = -normal;
+      facing = -facing;
+    }
+
+    // Drag goes with the air and scales with the area it sees, lift pushes across the
+    // air along the normal and peaks when the triangle is at 45 degrees to it
+    glm::vec3 acceleration = params.drag*facing*speed*air + params.lift*facing*speed*speed*(normal - facing*along);
+    acceleration *= twiceArea*share;
+    m_windAcceleration[_a] += acceleration;
+    m_windAcceleration[_b] += acceleration;
+    m_windAcceleration[_c] += acceleration;
+  };
+
+  if(m_isGrid)
+  {
+    for(int i=0; i<res-1; ++i)
+    {
+      for(int j=0; j<res-1; ++j)
+      {
+        addTriangle(i*res+j, i*res+j+1, (i+1)*res+j);
+        addTriangle(i*res+j+1, (i+1)*res+j+1, (i+1)*res+j);
+      }
+    }
+  }
+  else
+  {
+    for(size_t t=0; t+2<m_triangles.size(); t+=3) addTriangle(int(m_triangles[t]), int(m_triangles[t+1]), int(m_triangles[t+2]));
+  }
+}
+
+void Cloth::rebuildActive()
+{
+  m_activeParticles.clear();
+  for(int p=0; p<int(vertexPositions.size()); ++p)
+  {
+    bool asleep = m_tiles[m_particleTile[p]].asleep;
+    m_invMass[p] = asleep ? 0.0f : 1.0f/pointMasses[p].mass;
+    if(!asleep) m_activeParticles.push_back(p);
+  }
+
+  // Keep the original order so the solve converges exactly as it did before
+  m_allAwake = int(m_activeParticles.size()) == int(vertexPositions.size());
+  m_activeSprings.clear();
+  if(!m_allAwake)
+  {
+    for(const CompactSpring &spring : m_springStream.springs())
+    {
+      int A, B;
+      float restingDistance, stiffness;
+      m_springStream.decode(spring, A, B, restingDistance, stiffness);
+      if(m_invMass[A] > 0.0f || m_invMass[B] > 0.0f) m_activeSprings.push_back(spring);
+    }
+  }
+  m_activeDirty = false;
+}
+
+void Cloth::wake()
+{
+  for(int t=0; t<numTiles(); ++t)
+  {
+    if(m_tiles[t].asleep) setAsleep(t, false);
+    m_tiles[t].changed = true;
+  }
+  std::fill(m_rowChanged.begin(), m_rowChanged.end(), 1);
+}
+
+int Cloth::numAwakeTiles() const
+{
+  int awake = 0;
+  for(const Tile &tile : m_tiles) awake += tile.asleep ? 0 : 1;
+  return awake;
+}
+
+void Cloth::changedRanges(std::vector<std::pair<int,int>> &o_ranges, size_t _maxRanges) const
+{
+  o_ranges.clear();
+  int count = int(vertexPositions.size());
+  for(int i=0; i<int(m_rowChanged.size()); ++i)
+  {
+    if(!m_rowChanged[i]) continue;
+    int first = i*m_rowLength, last = std::min(first + m_rowLength, count);
+    if(!o_ranges.empty() && o_ranges.back().second == first) o_ranges.back().second = last;
+    else o_ranges.push_back(std::make_pair(first, last));
+  }
+
+  // Too many little uploads cost more than sending a few unchanged rows, so close the
+  // smallest gaps first
+  while(o_ranges.size() > std::max<size_t>(_maxRanges,1))
+  {
+    size_t smallest = 0;
+    for(size_t r=1; r+1<o_ranges.size(); ++r)
+    {
+      if(o_ranges[r+1].first - o_ranges[r].second < o_ranges[smallest+1].first - o_ranges[smallest].second)
+        smallest = r;
+    }
+    o_ranges[smallest].second = o_ranges[smallest+1].second;
+    o_ranges.erase(o_ranges.begin() + smallest + 1);
+  }
+}
+
+bool Cloth::changed() const
+{
+  return std::find(m_rowChanged.begin(), m_rowChanged.end(), 1) != m_rowChanged.end();
+}
+
+void Cloth::updateNormals(const glm::vec3 *_positions)
+{
+  // Someone else's positions (a point cache frame) could have changed anywhere
+  bool ours = _positions == &vertexPositions[0];
+
+  if(!m_isGrid)
+  {
+    // Sum the area weighted normals of the triangles around each vertex we're redoing
+    int count = int(vertexPositions.size());
+    for(int p=0; p<count; ++p)
+    {
+      if(!ours || m_rowChanged[p/m_rowLength]) vertexNormals[p] = glm::vec3(0.0f);
+    }
+    for(size_t t=0; t<m_triangles.size(); t+=3)
+    {
+      unsigned int a = m_triangles[t], b = m_triangles[t+1], c = m_triangles[t+2];
+      bool doA = !ours || m_rowChanged[a/m_rowLength];
+      bool doB = !ours || m_rowChanged[b/m_rowLength];
+      bool doC = !ours || m_rowChanged[c/m_rowLength];
+      if(!doA && !doB && !doC) continue;
+      glm::vec3 n = glm::cross(_positions[b] - _positions[a], _positions[c] - _positions[a]);
+      if(doA) vertexNormals[a] += n;
+      if(doB) vertexNormals[b] += n;
+      if(doC) vertexNormals[c] += n;
+    }
+    for(int p=0; p<count; ++p)
+    {
+      if((!ours || m_rowChanged[p/m_rowLength]) && glm::dot(vertexNormals[p],vertexNormals[p]) > 0.0f)
+        vertexNormals[p] = glm::normalize(vertexNormals[p]);
+    }
+    return;
+  }
+
+  for(int i =0; i<res; ++i)
+  {
+    for(int j =0 ; j<res; ++j)
+    {
+      if(ours && (!m_rowChanged[i] || !m_tiles[m_particleTile[i*res + j]].changed)) continue;
+
+      // Central differences, clamped at the border so we never read outside the sheet
+      // (the positions may be a mapped point cache frame with nothing either side of it)
+      int left = j>0 ? j-1 : j;
+      int right = j<(res-1) ? j+1 : j;
+      int down = i>0 ? i-1 : i;
+      int up = i<(res-1) ? i+1 : i;
+
+      glm::vec3 U = _positions[i*res + right] - _positions[i*res + left];
+      glm::vec3 V = _positions[up*res + j] - _positions[down*res + j];
+
+      vertexNormals[i*res + j]=glm::normalize(glm::cross(V,U));
+    }
+  }
+}
@@ -0,0 +1,185 @@
+#ifndef Cloth_H
+#define Cloth_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <time.h>
+#include <utility>
+#include "SpringStream.h"
+
+class ClothTopology;
+class WindField;
+
+enum integrators {VERLET, EULER, EULER_FORCES};
+
+struct PointMass
+{
+  glm::vec3 velocity;
+  glm::vec3 prevPos;
+  float mass;
+  int index;
+};
+
+/// Everything that can differ between two cloths in the same world
+struct ClothParameters
+{
+  int res = 32;
+  float stiffness = 0.5f;
+  float damping = 0.5f;
+  glm::vec3 gravity = glm::vec3(0.0f,-0.0098f,0.0f);
+  /// A tile whose particles all move less than this per frame is quiet, 0 never sleeps
+  float sleepSpeed = 0.0003f;
+  /// How many quiet frames in a row before a tile goes to sleep
+  int sleepFrames = 30;
+};
+
+/// A res x res sheet of point masses joined by structural, bend and shear springs, or
+/// any triangle mesh with springs along its edges and across its adjacent triangles.
+/// This is just the solver state, drawing it is up to whoever owns it.
+///
+/// The cloth is split into tiles that fall asleep once they've stopped moving (square
+/// ones on the sheet, runs of consecutive particles on a mesh).
+/// Sleeping particles aren't solved, collided or integrated and springs between two of
+/// them are skipped; a spring from an awake particle to a sleeping one treats the
+/// sleeping end as pinned. A tile wakes when the collider comes near it, when a
+/// neighbouring tile moves enough to disturb it, or when the wind over it changes.
+/// Only VERLET settles: EULER keeps the velocity the springs take back out of the
+/// positions, so its tiles never go quiet enough to sleep.
+class Cloth
+{
+public:
+  explicit Cloth(const ClothParameters &_params = ClothParameters());
+
+  void initSpringsAndVerts();
+
+  /// Build from a mesh instead of the square sheet, with nothing pinned
+  void initFromTopology(const ClothTopology &_topology);
+
+  /// Hold a particle where it is now
+  void pin(int _particle);
+
+  /// Fill o_tris with the triangle indices of the sheet or mesh
+  void buildTriangles(std::vector<unsigned int> &o_tris) const;
+
+  /// Blow _wind over the cloth from the next step on, nullptr for still air. The field
+  /// belongs to the caller and has to be updated to cover bounds() each frame.
+  void setWind(const WindField *_wind);
+
+  /// Box around every particle
+  void bounds(glm::vec3 &o_min, glm::vec3 &o_max) const;
+
+  /// Step the solver one frame, colliding against a sphere
+  void updateSimulation(integrators _whichIntegrator, const glm::vec3 &_sphereCentre, float _sphereRadius);
+
+  /// Recompute vertex normals from _positions (ours, or a point cache frame). For our own
+  /// positions only the tiles that changed in the last step are redone.
+  void updateNormals(const glm::vec3 *_positions);
+
+  /// Wake every tile, e.g. after the parameters or the anchors change
+  void wake();
+
+  /// Side length of a sleep tile in particles
+  static const int s_tileSize = 8;
+
+  int numTiles() const {return int(m_tiles.size());}
+  int numAwakeTiles() const;
+  /// The particles whose positions or normals changed in the last step, as [first,last)
+  /// index ranges made of whole rows (runs of one tile's particles on a mesh). Close
+  /// ranges are merged until there are no more than _maxRanges, so the caller can upload
+  /// each one with a single glBufferSubData.
+  void changedRanges(std::vector<std::pair<int,int>> &o_ranges, size_t _maxRanges) const;
+  /// Whether anything at all changed in the last step
+  bool changed() const;
+
+  const ClothParameters &parameters() const {return m_params;}
+  /// Sheet resolution, 0 for a cloth built from a mesh
+  int resolution() const {return res;}
+  size_t numParticles() const {return vertexPositions.size();}
+
+  const std::vector<glm::vec3> &positions() const {return vertexPositions;}
+  const std::vector<glm::vec3> &normals() const {return vertexNormals;}
+
+private:
+  ClothParameters m_params;
+
+  int res = 32;
+
+  clock_t last_time;
+
+  float leftOvertime = 0.0f;
+
+  std::vector<glm::vec3> vertexPositions;
+  std::vector<glm::vec3> vertexNormals;
+  std::vector<glm::vec3> m_forces;
+  std::vector<PointMass> pointMasses;
+  /// The springs as they're built, packed into m_springStream once the cloth is set up
+  std::vector<Spring> m_springs;
+  SpringStream m_springStream;
+
+  /// Only kept for meshes, the sheet's triangles are generated on demand
+  bool m_isGrid = true;
+  std::vector<unsigned int> m_triangles;
+  /// Typical distance between neighbouring particles, 1/res on the sheet and the mean
+  /// spring rest length on a mesh
+  float m_spacing = 0.0f;
+  /// Particles held in place, and where
+  std::vector<std::pair<int,glm::vec3>> m_pins;
+
+  /// Per tile sleep state
+  struct Tile
+  {
+    bool asleep = false;
+    /// Consecutive frames this tile has been quiet
+    int quietFrames = 0;
+    /// Largest squared distance a particle moved in the last step
+    float energy = 0.0f;
+    /// Moved in the last step, and needs its normals and upload redone
+    bool moved = true;
+    bool changed = true;
+    /// Bounds of the particles, kept while asleep to test against the collider
+    glm::vec3 min;
+    glm::vec3 max;
+    /// Wind at the middle of the tile when it fell asleep
+    glm::vec3 wind;
+  };
+
+  /// Pack the springs and set up the tiles, called once the particles and springs exist
+  void initSolver();
+  /// Split the particles into tiles and rows, work out which tiles touch, and size
+  /// everything else that is per particle
+  void initTiles();
+  void setAsleep(int _tile, bool _asleep);
+  /// Drag and lift on every triangle with an awake corner, shared out to the corners as
+  /// accelerations in m_windAcceleration
+  void computeWind(integrators _whichIntegrator, float _timestepLength);
+  /// Rebuild the lists of awake particles and springs after tiles changed state
+  void rebuildActive();
+
+  std::vector<Tile> m_tiles;
+  std::vector<int> m_particleTile;
+  std::vector<std::vector<int>> m_tileParticles;
+  /// Tiles joined to each tile by at least one spring
+  std::vector<std::vector<int>> m_tileNeighbours;
+  bool m_activeDirty = true;
+  /// Inverse mass of each particle, zero while it sleeps so springs treat it as pinned
+  std::vector<float> m_invMass;
+  std::vector<int> m_activeParticles;
+  /// Packed springs with at least one awake end, only used while something is asleep
+  std::vector<CompactSpring> m_activeSprings;
+  bool m_allAwake = true;
+  /// Where the awake particles were at the start of the step
+  std::vector<glm::vec3> m_stepStart;
+  /// Rows with a particle that moved in the last step, and rows whose normals that
+  /// affected (one row either side on the sheet, the neighbouring tiles on a mesh)
+  int m_rowLength = 0;
+  std::vector<unsigned char> m_rowMoved;
+  std::vector<unsigned char> m_rowChanged;
+
+  /// Wind field if there is one, its pull on each particle this frame, and particles per
+  /// unit of rest area to turn force on a triangle into acceleration of its corners
+  const WindField *m_wind = nullptr;
+  std::vector<glm::vec3> m_windAcceleration;
+  float m_particlesPerArea = 0.0f;
+};
+
+#endif // Cloth_H
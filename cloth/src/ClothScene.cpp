@@ -1,15 +1,43 @@
 #include "ClothScene.h"
 
 #include <glm/gtc/type_ptr.hpp>
-#include <ngl/Obj.h>
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
-#include <ngl/ShaderLib.h>
 #include <math.h>
 #include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
 //#define _FORCES_
 
+/// The radius of the sphere the cloth collides with
+static const float s_sphereRadius = 0.2442f;
+
+/// Most glBufferSubData calls to split a frame's upload into
+static const size_t s_maxUploadRanges = 4;
+
+/// Simulated seconds per frame (the cloth takes three 16ms steps)
+static const float s_frameTime = 0.048f;
+
+/// How many point cache frames to ask the kernel to page in ahead of playback
+static const unsigned int s_cachePrefetchFrames = 8;
+
+/// The cloth and the collider can load side by side, so each parses on half the
+/// hardware threads rather than both starting a thread for every one of them
+static size_t loaderThreads()
+{
+  return std::max(1u, std::thread::hardware_concurrency()/2);
+}
+
+/// Whether a background load has finished, without waiting unless asked to
+static bool loadFinished(std::future<bool> &_load, bool _wait)
+{
+  if(!_load.valid()) return false;
+  if(_wait) return true;
+  return _load.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
 ClothScene::ClothScene() : Scene() {}
 
 /**
@@ -28,71 +56,120 @@ void ClothScene::initGL() noexcept {
     // enable multisampling for smoother drawing
     glEnable(GL_MULTISAMPLE);
 
-    // Create and compile all of our shaders
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-    shader->loadShader("GouraudProgram","../common/shaders/gouraud_vert.glsl","../common/shaders/gouraud_frag.glsl");
-    shader->loadShader("PhongProgram","shaders/phong_vert.glsl","shaders/phong_frag.glsl");
-    shader->loadShader("CookTorranceProgram","shaders/phong_vert.glsl","shaders/cooktorrance_frag.glsl");
-    shader->loadShader("ToonProgram","shaders/phong_vert.glsl","shaders/toon_frag.glsl");
-
-    glGenVertexArrays(1, &vertexArrayIdx);
-    glBindVertexArray(vertexArrayIdx);
-
-    initSpringsAndVerts();
-    initTriangles();
-    initVertexBuffers();
-
-    glBindVertexArray(0);
+    // Start the cloth and the collider loading on their own threads, then hand all of our
+    // shaders to the driver while they run. Phong goes first as it draws the first frame.
+    m_clothLoad = std::async(std::launch::async, [this]()
+    {
+      m_pendingCloth.initSpringsAndVerts();
+      return true;
+    });
+    m_sphereLoad = std::async(std::launch::async, [this]()
+    {
+      return m_sphere.load("models/sphere.obj", true, loaderThreads());
+    });
 
-    m_sphere.reset(new ngl::Obj("models/sphere.obj"));
-    m_sphere->createVAO();
+    // Programs that linked on an earlier run come straight back out of the binary cache
+    m_programs.init(".shadercache");
+    m_programs.request("PhongProgram","shaders/phong_vert.glsl","shaders/phong_frag.glsl");
+    m_programs.request("GouraudProgram","../common/shaders/gouraud_vert.glsl","../common/shaders/gouraud_frag.glsl");
+    m_programs.request("CookTorranceProgram","shaders/phong_vert.glsl","shaders/cooktorrance_frag.glsl");
+    m_programs.request("ToonProgram","shaders/phong_vert.glsl","shaders/toon_frag.glsl");
+    m_programs.request("InstancedProgram","shaders/instanced_vert.glsl","shaders/phong_frag.glsl");
 
-    last_time = clock();
+    glGenVertexArrays(1, &vertexArrayIdx);
 }
 
 void ClothScene::paintGL() noexcept {
+    // Bring in anything that finished loading or compiling since the last frame
+    pollLoads();
+    m_programs.update();
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Set up the viewport
     glViewport(0,0,m_width,m_height);
 
-    // Use our shader for this draw
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-    GLint pid;
-
     // Allow the user to select the current shader method
+    const char *program;
     switch(m_shaderMethod) {
     case SHADER_PHONG:
-        (*shader)["PhongProgram"]->use();
-        pid = shader->getProgramID("PhongProgram");
+        program = "PhongProgram";
         break;
     case SHADER_TOON:
-        (*shader)["ToonProgram"]->use();
-        pid = shader->getProgramID("ToonProgram");
+        program = "ToonProgram";
         break;
     case SHADER_COOKTORRANCE:
-        (*shader)["CookTorranceProgram"]->use();
-        pid = shader->getProgramID("CookTorranceProgram");
+        program = "CookTorranceProgram";
         break;
     default:
-        (*shader)["GouraudProgram"]->use();
-        pid = shader->getProgramID("GouraudProgram");
+        program = "GouraudProgram";
         break;
     }
 
+    // Use Phong while the chosen one is still compiling, and draw nothing at all until
+    // there's a cloth and a program to draw it with
+    if(!m_programs.ready(program)) program = "PhongProgram";
+    if(!m_clothReady || !m_programs.ready(program)) return;
+    GLint pid = GLint(m_programs.program(program));
+    if(pid == 0) return;
+    glUseProgram(GLuint(pid));
+
     loadMatricesToShader(pid,glm::vec3(0.0f,0.0f,0.0f));
 
-    updateSimulation(EULER);
+    // Positions either come from the solver or straight out of the mapped point cache
+    const glm::vec3 *positions = &m_cloth.positions()[0];
+    if(m_pointCache.isOpen())
+    {
+      positions = m_pointCache.frame(m_cacheFrame);
+      if(positions != nullptr && !m_exportOrder.empty())
+      {
+        // Caches are in the mesh file's order, the buffers are in ours
+        for(size_t i=0; i<m_exportOrder.size(); ++i) m_exportScratch[i] = positions[m_exportOrder[i]];
+        positions = &m_exportScratch[0];
+      }
+      if(m_cachePlaying) setCacheFrame(m_cacheFrame + 1 < m_pointCache.numFrames() ? m_cacheFrame + 1 : 0);
+    }
+    else
+    {
+      if(m_wind)
+      {
+        glm::vec3 lower, upper;
+        m_cloth.bounds(lower, upper);
+        m_wind->update(m_windTime, lower, upper);
+        m_windTime += s_frameTime;
+      }
+      m_cloth.updateSimulation(m_integrator, sphereTranslation, s_sphereRadius);
+      moveSphere();
+      if(m_pointCacheWriter.isOpen())
+      {
+        if(m_exportOrder.empty()) m_pointCacheWriter.writeFrame(positions);
+        else
+        {
+          for(size_t i=0; i<m_exportOrder.size(); ++i) m_exportScratch[m_exportOrder[i]] = positions[i];
+          m_pointCacheWriter.writeFrame(&m_exportScratch[0]);
+        }
+      }
+    }
 
-    updateNormals();
+    // A damaged cache frame uploads nothing, the last good one stays on screen
+    if(positions != nullptr) m_cloth.updateNormals(positions);
 
     glBindVertexArray(vertexArrayIdx);
 
-    glBindBuffer(GL_ARRAY_BUFFER, posIdx); // Bind it (all following operations apply)
-    glBufferSubData(GL_ARRAY_BUFFER,0,res*res*sizeof(glm::vec3),&vertexPositions[0]);
-    glBindBuffer(GL_ARRAY_BUFFER, normalsIdx); // Bind it (all following operations apply)
-    glBufferSubData(GL_ARRAY_BUFFER,0,res*res*sizeof(glm::vec3),&vertexNormals[0]);
+    // Only send the rows the solver touched, everything else is already on the GPU
+    std::vector<std::pair<int,int>> ranges(1, std::make_pair(0, int(m_cloth.numParticles())));
+    if(!m_pointCache.isOpen()) m_cloth.changedRanges(ranges, s_maxUploadRanges);
+    if(positions == nullptr) ranges.clear();
+    for(const std::pair<int,int> &range : ranges)
+    {
+      GLintptr offset = range.first*sizeof(glm::vec3);
+      GLsizeiptr bytes = (range.second-range.first)*sizeof(glm::vec3);
+      glBindBuffer(GL_ARRAY_BUFFER, posIdx); // Bind it (all following operations apply)
+      glBufferSubData(GL_ARRAY_BUFFER,offset,bytes,positions + range.first);
+      glBindBuffer(GL_ARRAY_BUFFER, normalsIdx); // Bind it (all following operations apply)
+      glBufferSubData(GL_ARRAY_BUFFER,offset,bytes,&m_cloth.normals()[range.first]);
+    }
 
     // Retrieve the attribute location from our currently bound shader, enable and
     // bind the vertex attrib pointer to our currently bound buffer
@@ -108,13 +185,12 @@ void ClothScene::paintGL() noexcept {
     glVertexAttribPointer(normAttribLoc, 3, GL_FLOAT, GL_TRUE, 0, 0);
 
     // Draw our elements (the element buffer should still be enabled from the previous call to initScene())
-    unsigned int num_tris = (res-1)*(res-1)*2;
-    unsigned int num_points = res * res;
+    unsigned int num_points = m_cloth.numParticles();
 
     //glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementsIdx);
-    glDrawElements(GL_TRIANGLES, num_tris*3, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
     glBindBuffer(GL_ARRAY_BUFFER, posIdx);
@@ -123,8 +199,28 @@ void ClothScene::paintGL() noexcept {
     glBindVertexArray(0);
 
 
-    loadMatricesToShader(pid,sphereTranslation);
-    m_sphere->draw();
+    // The collider turns up once its mesh has loaded
+    if(m_sphereVAO)
+    {
+      loadMatricesToShader(pid,sphereTranslation);
+      glBindVertexArray(m_sphereVAO);
+      glDrawElements(GL_TRIANGLES, GLsizei(m_sphere.numTriangles()*3), GL_UNSIGNED_INT, 0);
+      glBindVertexArray(0);
+    }
+
+    // The crowd always uses the instanced program
+    if(m_world)
+    {
+      m_world->setCollider(sphereTranslation, s_sphereRadius);
+      m_world->updateSimulation(m_integrator);
+      pid = m_programs.ready("InstancedProgram") ? GLint(m_programs.program("InstancedProgram")) : 0;
+      if(pid)
+      {
+        glUseProgram(GLuint(pid));
+        loadMatricesToShader(pid,glm::vec3(0.0f,0.0f,0.0f));
+        m_world->draw(pid);
+      }
+    }
 
     //ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
     //prim->draw("teapot");
@@ -135,314 +231,213 @@ void ClothScene::initVertexBuffers()
   // Create our GL buffers and bind them to CUDA
   glGenBuffers(1, &posIdx); // Generate the point buffer index
   glBindBuffer(GL_ARRAY_BUFFER, posIdx); // Bind it (all following operations apply)
-  glBufferData(GL_ARRAY_BUFFER, res*res*sizeof(glm::vec3), &vertexPositions[0], GL_DYNAMIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, m_cloth.numParticles()*sizeof(glm::vec3), &m_cloth.positions()[0], GL_DYNAMIC_DRAW);
   glBindBuffer(GL_ARRAY_BUFFER, 0); // Unbind our buffers
   // Now do the same for the normals
   glGenBuffers(1, &normalsIdx);
   glBindBuffer(GL_ARRAY_BUFFER, normalsIdx);
-  glBufferData(GL_ARRAY_BUFFER, res*res*sizeof(glm::vec3), &vertexNormals[0], GL_DYNAMIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, m_cloth.numParticles()*sizeof(glm::vec3), &m_cloth.normals()[0], GL_DYNAMIC_DRAW);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void ClothScene::initTriangles()
 {
   // Define some connectivity information for our sheet.
-  unsigned int num_tris = (res-1)*(res-1)*2;
-  GLuint *tris = new GLuint[num_tris*3];
-  int i, j, fidx = 0;
-  for (i=0; i < res - 1; ++i) {
-      for (j=0; j < res - 1; ++j) {
-          tris[fidx*3+0] = i*res+j; tris[fidx*3+1] = i*res+j+1; tris[fidx*3+2] = (i+1)*res+j;
-          fidx++;
-          tris[fidx*3+0] = i*res+j+1; tris[fidx*3+1] = (i+1)*res+j+1; tris[fidx*3+2] = (i+1)*res+j;
-          fidx++;
-      }
-  }
+  std::vector<unsigned int> tris;
+  m_cloth.buildTriangles(tris);
+  m_numIndices = GLsizei(tris.size());
 
   // Create our buffer to contain element data (we will use indexed arrays to draw this shape)
   glGenBuffers(1, &elementsIdx);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementsIdx);
 
   // Note that in this call we copy the data to the GPU from the tris array
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, 3*num_tris*sizeof(GLuint), tris, GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, tris.size()*sizeof(GLuint), &tris[0], GL_STATIC_DRAW);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-  delete [] tris; // We can delete this array - it has been copied to the GPU
 }
 
-void ClothScene::initSpringsAndVerts()
-{
-  vertexPositions.resize(res*res);
-  vertexNormals.resize(res*res);
-  pointMasses.resize(res*res);
-  m_forces.resize(res*res);
 
-  //--------------------------STRUCTURAL SPRINGS---------------
 
-  for(int i=0; i<res; ++i)
-  {
-    for(int j=0; j<res; ++j)
-    {
-      m_forces[i*res + j] = glm::vec3(0.0f);
-      // j is x
-      // i is y
-      vertexPositions[i*res + j]=glm::vec3(float(j)/float(res),float(i)/float(res),0.0f);
-
-      //if(i==0 && j==0) std::cout<<"0,0: "<<vertexPositions[i*res + j].x<<","<<vertexPositions[i*res + j].y<<","<<vertexPositions[i*res + j].z<<"\n";
-      //if(i==0 && j==res-1) std::cout<<"0,0: "<<vertexPositions[i*res + j].x<<","<<vertexPositions[i*res + j].y<<","<<vertexPositions[i*res + j].z<<"\n";
-
-      vertexNormals[i*res + j] = glm::vec3(0.0f,0.0f,1.0f);
-      PointMass newPoint;
-      newPoint.velocity = glm::vec3(0.0f);
-      newPoint.prevPos = glm::vec3(float(j)/float(res),float(i)/float(res),0.0f);
-      newPoint.index = i*res + j;
-      newPoint.mass = 1.0f;
-      pointMasses[i*res + j]=newPoint;
-      //-----------SETUP SPRINGS---------------
-      if(j!=(res-1) && i!=(res-1))
-      {
-        Spring newLink1;
-        newLink1.PointMassA = i*res+j;
-        newLink1.PointMassB = i*res+j+1;
-        newLink1.restingDistance=1.0f/float(res);
-        newLink1.stiffness=0.5f;
-        newLink1.damping=0.5f;
-        m_springs.push_back(newLink1);
-        Spring newLink2;
-        newLink2.PointMassA = i*res+j;
-        newLink2.PointMassB = (i+1)*res+j;
-        newLink2.restingDistance=1.0f/float(res);
-        newLink2.stiffness=0.5f;
-        newLink2.damping=0.5f;
-        m_springs.push_back(newLink2);
-      }
-      //-------------FAR LEFT-------------------
-      else if(j==(res-1) && i!=(res-1))
-      {
-        Spring newLink2;
-        newLink2.PointMassA = i*res+j;
-        newLink2.PointMassB = (i+1)*res+j;
-        newLink2.restingDistance=1.0f/float(res);
-        newLink2.stiffness=0.5f;
-        newLink2.damping=0.5f;
-        m_springs.push_back(newLink2);
-      }
-      //-------------TOP ROW------------------
-      else if(i==(res-1)&&j!=(res-1))
-      {
-        Spring newLink1;
-        newLink1.PointMassA = i*res+j;
-        newLink1.PointMassB = i*res+j+1;
-        newLink1.restingDistance=1.0f/float(res);
-
-        newLink1.stiffness=0.5f;
-        newLink1.damping=0.5f;
-        m_springs.push_back(newLink1);
-      }
-    }
-  }
 
-  //--------------BEND SPRINGS----------------------
 
-  for(int i =0 ; i<res; ++i)
-  {
-      for(int j =0; j<res; ++j)
-      {
-          if(i<(res-2) && j<(res-2))
-          {
-            Spring newBend;
-            newBend.PointMassA = i*res + j;
-            newBend.PointMassB = i*res + j + 2;
-            newBend.restingDistance = 2.0f/float(res);
-            newBend.stiffness=0.5f;
-            newBend.damping=0.5f;
-            m_springs.push_back(newBend);
-            Spring newBend2;
-            newBend2.PointMassA = i*res + j;
-            newBend2.PointMassB = (i+2)*res + j;
-            newBend2.restingDistance = 2.0f/float(res);
-            newBend2.stiffness=0.5f;
-            newBend2.damping=0.5f;
-            m_springs.push_back(newBend2);
-          }
-          else if(i>=(res-2) && j<(res-2))
-          {
-              Spring newBend;
-              newBend.PointMassA = i*res + j;
-              newBend.PointMassB = i*res + j + 2;
-              newBend.restingDistance = 2.0f/float(res);
-              newBend.stiffness=0.5f;
-              newBend.damping=0.5f;
-              m_springs.push_back(newBend);
-          }
-          else if(j>=(res-2) && i<(res-2))
-          {
-              Spring newBend2;
-              newBend2.PointMassA = i*res + j;
-              newBend2.PointMassB = (i+2)*res + j;
-              newBend2.restingDistance = 2.0f/float(res);
-              newBend2.stiffness=0.5f;
-              newBend2.damping=0.5f;
-              m_springs.push_back(newBend2);
-          }
-      }
-  }
-  //---------------SHEAR SPRINGS-----------------------
-  float normald = 1.0f/float(res);
-  float distance = sqrt(2*(normald*normald));
-  for(int i =0; i<res; ++i)
-  {
-      for(int j=0; j<res; ++j)
-      {
-          if(j!=(res-1) && i!=(res-1))
-          {
-            Spring newLink1;
-            newLink1.PointMassA = i*res+j;
-            newLink1.PointMassB = (i+1)*res+j+1;
-            newLink1.restingDistance=distance;
-            newLink1.stiffness=0.5f;
-            m_springs.push_back(newLink1);
-            Spring newLink2;
-            newLink2.PointMassA = i*res+j+1;
-            newLink2.PointMassB = (i+1)*res+j;
-            newLink2.restingDistance=distance;
-            newLink2.stiffness=0.5f;
-            m_springs.push_back(newLink2);
-          }
-      }
-  }
+void ClothScene::pollLoads(bool _waitForCloth)
+{
+  if(loadFinished(m_clothLoad, _waitForCloth) && m_clothLoad.get()) adoptCloth();
+  if(loadFinished(m_sphereLoad, false) && m_sphereLoad.get()) uploadSphere();
 }
 
-void ClothScene::updateSimulation(integrators _whichIntegrator)
+void ClothScene::adoptCloth()
 {
-  float deltaT = float(clock()-last_time)/CLOCKS_PER_SEC;
-  last_time = clock();
-
-  float timestepLength = 0.016f;
-  int timesteps = floor(float(deltaT+leftOvertime)/timestepLength);
-  leftOvertime=deltaT-timestepLength*timesteps;
-
-  //std::cout<<"deltaT: "<<deltaT<<"timesteps"<<timesteps<<"\n";
-  timesteps=3;
-  for(int n =0; n<timesteps; ++n)
-  {
-    for(int m = 0; m<5; ++m)
-    {
-      std::fill(m_forces.begin(), m_forces.end(), glm::vec3(0.0f,0.0f,0.0f));
-      //------------------------------SPRINGS---------------------------------
-      for(int i=0; i<m_springs.size(); ++i)
-      {
-        int A = m_springs[i].PointMassA;
-        int B = m_springs[i].PointMassB;
-        if(_whichIntegrator==EULER_FORCES)
-        {
-          float Kr = m_springs[i].stiffness;
-          float Kd = 0.1f;
-          glm::vec3 L = vertexPositions[A] - vertexPositions[B];
-          float Lnorm = glm::length(L);
-          float R = m_springs[i].restingDistance;
-          glm::vec3 vA = pointMasses[A].velocity;
-          glm::vec3 vB = pointMasses[B].velocity;
-
-          glm::vec3 ourForce = - Kr*(Lnorm - R)*(L/Lnorm) - Kd*(glm::dot(vA-vB,L)/Lnorm)*(L/Lnorm);
-          //if(A==0 || B==0) std::cout<<ourForce.x<<","<<ourForce.y<<","<<ourForce.z<<"\n";
-          m_forces[A] += ourForce;
-          m_forces[B] -= ourForce;
-        }
-        else
-        {
-          glm::vec3 differenceXYZ = vertexPositions[A] - vertexPositions[B];
-          float d = glm::length(differenceXYZ);
-
-          //-------------------------------------------------------------------
-
-          float im1 = 1.0f/pointMasses[A].mass;
-          float im2 = 1.0f/pointMasses[B].mass;
-
-          float scalarP1 = (im1 / (im1 + im2)) * m_springs[i].stiffness;
-          float scalarP2 =  m_springs[i].stiffness - scalarP1;
-
-          //-------------------------------------------------------------------
-
-          float differenceScalar = (m_springs[i].restingDistance -d)/d;
-
-          glm::vec3 translationP1 = differenceXYZ*scalarP1*differenceScalar;
-          glm::vec3 translationP2 = differenceXYZ*scalarP2*differenceScalar;
-
-          vertexPositions[A] += translationP1;
-          vertexPositions[B] -= translationP2;
-        }
-      }
+  m_cloth = std::move(m_pendingCloth);
+  m_pendingCloth = Cloth();
+  m_cloth.setWind(m_wind.get());
+  m_exportOrder.swap(m_pendingExportOrder);
+  m_pendingExportOrder.clear();
+  m_exportScratch.resize(m_exportOrder.size());
+
+  glDeleteBuffers(1, &posIdx);
+  glDeleteBuffers(1, &normalsIdx);
+  glDeleteBuffers(1, &elementsIdx);
+  glBindVertexArray(vertexArrayIdx);
+  initTriangles();
+  initVertexBuffers();
+  glBindVertexArray(0);
+  m_clothReady = true;
+}
 
-      //------------------------------ANCHORS---------------------------------
+bool ClothScene::initSphere(const std::string &_path)
+{
+  // A newer mesh wins over one still loading in the background
+  if(m_sphereLoad.valid()) m_sphereLoad.get();
+  if(!m_sphere.load(_path, true, loaderThreads())) return false;
+  uploadSphere();
+  return true;
+}
 
-      vertexPositions[(res-1)*res] = glm::vec3(0.0f,(float(res)-1.0f)/float(res),0.0f);
-      vertexPositions[(res-1)*res + res -1] = glm::vec3((float(res)-1.0f)/float(res),(float(res)-1.0f)/float(res),0.0f);
+void ClothScene::uploadSphere()
+{
+  if(!m_sphereVAO) glGenVertexArrays(1, &m_sphereVAO);
+  if(!m_sphereBuffers[0]) glGenBuffers(3, m_sphereBuffers);
+  glBindVertexArray(m_sphereVAO);
+
+  // Same attribute locations as the shaders declare (0 position, 2 normal)
+  size_t bytes = m_sphere.numVertices()*sizeof(glm::vec3);
+  glBindBuffer(GL_ARRAY_BUFFER, m_sphereBuffers[0]);
+  glBufferData(GL_ARRAY_BUFFER, bytes, m_sphere.positions(), GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, m_sphereBuffers[1]);
+  glBufferData(GL_ARRAY_BUFFER, bytes, m_sphere.normals(), GL_STATIC_DRAW);
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_sphereBuffers[2]);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_sphere.numTriangles()*3*sizeof(GLuint), m_sphere.triangles(), GL_STATIC_DRAW);
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
 
-    }
+void ClothScene::createWorld(size_t _count)
+{
+  m_world.reset(new ClothWorld);
 
+  // Lay them out on a grid behind the main cloth, with a spread of sizes and stiffnesses
+  size_t side = size_t(ceil(sqrt(double(_count))));
+  for(size_t i=0; i<_count; ++i)
+  {
+    ClothParameters params;
+    params.res = 16 + 8*int(i%3);
+    params.stiffness = 0.2f + 0.6f*float(i%7)/6.0f;
+    glm::vec3 offset(1.2f*float(i%side) - 0.6f*float(side), 0.0f, 1.5f + 1.2f*float(i/side));
+    m_world->addCloth(params, offset);
+  }
+  m_world->initGL();
+}
 
-    //---------------------------SPHERE COLLISION------------------------------
-    for(int i=0; i<res; ++i)
+bool ClothScene::loadClothMesh(const std::string &_path, ReorderMethod _reorder)
+{
+  // Only one cloth is built at a time, finish off whatever is in flight first
+  pollLoads(true);
+  m_clothLoad = std::async(std::launch::async, [this, _path, _reorder]()
+  {
+    ClothTopology topology;
+    if(!topology.load(_path, loaderThreads())) return false;
+    topology.reorder(_reorder);
+    m_pendingCloth.initFromTopology(topology);
+
+    // Remember how to get back to the file's vertex order for point caches
+    m_pendingExportOrder.clear();
+    if(_reorder != REORDER_NONE) m_pendingExportOrder = topology.originalIndices();
+
+    // Hang it from its top edge, like the two corners of the sheet
+    const std::vector<glm::vec3> &verts = topology.positions();
+    glm::vec3 lower = verts[0], upper = verts[0];
+    for(const glm::vec3 &v : verts)
     {
-      for(int j=0; j<res; ++j)
-      {
-        glm::vec3 distance = vertexPositions[i*res + j] - sphereTranslation;
-        float d = glm::length(distance);
-
-        float radius = 0.2442f;
-        if(d<radius)
-        {
-          vertexPositions[i*res + j]+=((radius-d)/radius)*distance;
-        }
-      }
+      lower = glm::min(lower, v);
+      upper = glm::max(upper, v);
     }
-
-    //--------------------------VERLET/EULER INTEGRATION----------------------------
-    for(int i=0; i<res; ++i)
+    float band = 0.01f*glm::length(upper - lower);
+    for(size_t i=0; i<verts.size(); ++i)
     {
-      for(int j=0; j<res; ++j)
-      {
-
-        if(_whichIntegrator==VERLET)
-        {
-          pointMasses[i*res + j].velocity = vertexPositions[i*res + j] - pointMasses[i*res + j].prevPos;
-          pointMasses[i*res + j].prevPos = vertexPositions[i*res + j];
-
-          glm::vec3 acceleration = glm::vec3(0.0f,-0.0098f,0.0f);
-          //glm::vec3 acceleration = glm::vec3(0.0f,0.0f,0.0f);
+      if(verts[i].y >= upper.y - band) m_pendingCloth.pin(int(i));
+    }
+    return true;
+  });
+  return true;
+}
 
-          vertexPositions[i*res + j] = vertexPositions[i*res + j] + pointMasses[i*res + j].velocity + acceleration*timestepLength;
-        }
-        else if(_whichIntegrator==EULER)
-        {
-          glm::vec3 gravity = glm::vec3(0.0f,-0.0098f,0.0f);
-          //glm::vec3 gravity = glm::vec3(0.0f,0.0f,0.0f);
-          pointMasses[i*res + j].velocity = pointMasses[i*res + j].velocity + gravity*timestepLength;
-          vertexPositions[i*res + j] = vertexPositions[i*res + j] + pointMasses[i*res + j].velocity*timestepLength;
-        }
-        else if(_whichIntegrator==EULER_FORCES)
-        {
-          // gravity
-          //m_forces[i*res + j] = m_forces[i*res + j] - glm::vec3(0.0f,0.98f,0.0f);
+void ClothScene::setWind(float _speed)
+{
+  if(_speed <= 0.0f)
+  {
+    m_wind.reset();
+  }
+  else
+  {
+    WindParameters params;
+    params.velocity = glm::vec3(0.0f,0.0f,_speed);
+    m_wind.reset(new WindField(params));
+  }
+  m_cloth.setWind(m_wind.get());
+}
 
-          // acceleration
-          glm::vec3 an = m_forces[i*res + j] - glm::vec3(0.0f,0.0098f,0.0f);
+bool ClothScene::loadPointCache(const std::string &_path)
+{
+  // The cache has to match the cloth, so that has to be here first
+  pollLoads(true);
+  if(!m_pointCache.open(_path)) return false;
+  if(m_pointCache.numPoints() != m_cloth.numParticles() || m_pointCache.numFrames() == 0)
+  {
+    std::cerr<<"ClothScene: "<<_path<<" has "<<m_pointCache.numPoints()<<" points, expected "<<m_cloth.numParticles()<<"\n";
+    m_pointCache.close();
+    return false;
+  }
+  setCacheFrame(0);
+  return true;
+}
 
-          // velocity
-          pointMasses[i*res + j].velocity = pointMasses[i*res + j].velocity + an*timestepLength;
+bool ClothScene::recordPointCache(const std::string &_path)
+{
+  pollLoads(true);
+  // Anything ending in .pcz is written with the quantising codec
+  if(_path.size() > 4 && _path.compare(_path.size()-4, 4, ".pcz") == 0)
+  {
+    PointCodecSettings settings;
+    return m_pointCacheWriter.open(_path, m_cloth.numParticles(), 60.0f, &settings);
+  }
+  return m_pointCacheWriter.open(_path, m_cloth.numParticles());
+}
 
-          // position
-          vertexPositions[i*res + j] = vertexPositions[i*res + j] + pointMasses[i*res + j].velocity*timestepLength;
+void ClothScene::setCacheFrame(unsigned int _frame)
+{
+  if(!m_pointCache.isOpen()) return;
+  if(_frame >= m_pointCache.numFrames()) _frame = m_pointCache.numFrames() - 1;
+  m_cacheFrame = _frame;
 
-        }
-      }
-    }
-  }
-  moveSphere();
+  // Page in what we're about to play and let go of what's well behind us
+  m_pointCache.prefetch(m_cacheFrame, s_cachePrefetchFrames);
+  if(m_cacheFrame > s_cachePrefetchFrames) m_pointCache.release(m_cacheFrame - s_cachePrefetchFrames);
 }
 
 void ClothScene::handleKey(int key, int action)
 {
+  if (action==GLFW_PRESS && m_pointCache.isOpen()) {
+      switch(key) {
+      case GLFW_KEY_SPACE:
+        m_cachePlaying = !m_cachePlaying;
+        break;
+      case GLFW_KEY_LEFT:
+        m_cachePlaying = false;
+        setCacheFrame(m_cacheFrame > 0 ? m_cacheFrame - 1 : 0);
+        break;
+      case GLFW_KEY_RIGHT:
+        m_cachePlaying = false;
+        setCacheFrame(m_cacheFrame + 1);
+        break;
+      }
+  }
   if (action==GLFW_PRESS) {
       switch(key) {
       case GLFW_KEY_W:
@@ -547,22 +542,4 @@ void ClothScene::loadMatricesToShader(GLint pid, glm::vec3 translation)
                      glm::value_ptr(N)); // a raw pointer to the data
 }
 
-void ClothScene::updateNormals()
-{
-  for(int i =0; i<res; ++i)
-  {
-    for(int j =0 ; j<res; ++j)
-    {
-      if(i!=0 && j!=0 && i!=(res-1) && j!=(res-1));
-      glm::vec3 A = vertexPositions[i*res + j] - vertexPositions[i*res + j +1];
-      glm::vec3 B = vertexPositions[i*res + j] - vertexPositions[(i+1)*res + j];
-      glm::vec3 C = vertexPositions[i*res + j] - vertexPositions[i*res + j -1];
-      glm::vec3 D = vertexPositions[i*res + j] - vertexPositions[(i-1)*res + j];
 
-      glm::vec3 vect1 = glm::cross(B,A);
-      glm::vec3 vect2 = glm::cross(D,C);
-
-      vertexNormals[i*res + j]=glm::normalize((vect1+vect2)/2.0f);
-    }
-  }
-}
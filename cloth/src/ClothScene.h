@@ -2,32 +2,19 @@
 #define ClothScene_H
 
 // The parent class for this scene
-#include <ngl/Obj.h>
 #include <GLFW/glfw3.h>
-#include <ngl/ShaderLib.h>
+#include <future>
 #include "scene.h"
+#include "ShaderPrograms.h"
+#include "PointCache.h"
+#include "Cloth.h"
+#include "ClothWorld.h"
+#include "ClothTopology.h"
+#include "MeshLoader.h"
+#include "WindField.h"
 
 enum sphere_directions {STATIONARY, SPHERE_UP, SPHERE_DOWN, SPHERE_LEFT, SPHERE_RIGHT, SPHERE_FORWARDS, SPHERE_BACKWARDS};
 
-enum integrators {VERLET, EULER, EULER_FORCES};
-
-struct PointMass
-{
-  glm::vec3 velocity;
-  glm::vec3 prevPos;
-  float mass;
-  int index;
-};
-
-struct Spring
-{
-  float restingDistance;
-  float stiffness;
-  float damping;
-  int PointMassA;
-  int PointMassB;
-};
-
 class ClothScene : public Scene
 {
 public:
@@ -54,47 +41,105 @@ public:
 
     void initTriangles();
 
-    void initSpringsAndVerts();
-
-    void updateSimulation(integrators _whichIntegrator);
-
     void handleKey(int key, int action);
 
     void loadMatricesToShader(GLint pid, glm::vec3 translation);
 
     void moveSphere();
 
-    void updateNormals();
+    /// Load the collider mesh and put it on the GPU
+    bool initSphere(const std::string &_path);
+
+    /// Add _count small cloths with varied parameters, simulated in parallel and drawn instanced
+    void createWorld(size_t _count);
+
+    /// Replace the sheet with a triangle mesh (OBJ or OFF) hanging from its highest vertices.
+    /// The particles are renumbered for the solver, point caches keep the file's order.
+    /// The mesh is loaded on another thread and swapped in by a later paintGL, the current
+    /// cloth keeps running until then.
+    bool loadClothMesh(const std::string &_path, ReorderMethod _reorder = REORDER_MORTON);
+
+    /// Blow a gusty wind of _speed units per second along z over the cloth, 0 for still air
+    void setWind(float _speed);
+
+    /// Step the cloth and the crowd with _integrator, EULER unless this is called. Tiles
+    /// only fall asleep under VERLET, EULER never lets the cloth come to rest.
+    void setIntegrator(integrators _integrator) {m_integrator = _integrator;}
+
+    /// Switch to playback of a point cache instead of running the solver
+    bool loadPointCache(const std::string &_path);
+
+    /// Write every simulated frame out to a point cache
+    bool recordPointCache(const std::string &_path);
+
+    /// Jump to any frame of the loaded point cache
+    void setCacheFrame(unsigned int _frame);
 
 private:
+    /// Pick up whatever the loading threads have finished, waiting for the cloth if asked
+    void pollLoads(bool _waitForCloth = false);
+
+    /// Swap in the cloth the loader built and put it on the GPU
+    void adoptCloth();
+
+    /// Send the loaded collider mesh to the GPU
+    void uploadSphere();
+
     /// Keep track of the currently active shader method
     ShaderMethod m_shaderMethod = SHADER_PHONG;
 
     GLuint posIdx = 0; // The positional array buffer index - dynamic
     GLuint normalsIdx = 0; // The normal array buffer index - dynamic
     GLuint elementsIdx = 0;
+    GLsizei m_numIndices = 0;
     GLuint vertexArrayIdx;
 
     bool firsttime = true;
 
-    clock_t last_time;
+    /// The cloth we're simulating
+    Cloth m_cloth;
 
-    float leftOvertime = 0.0f;
+    /// How the cloth and the crowd are stepped
+    integrators m_integrator = EULER;
 
-    int res = 32;
+    /// Optional crowd of extra cloths
+    std::unique_ptr<ClothWorld> m_world;
 
-    std::unique_ptr<ngl::Obj> m_sphere;
+    /// The collider's mesh and GL buffers (positions, normals, elements)
+    MeshLoader m_sphere;
+    GLuint m_sphereVAO = 0;
+    GLuint m_sphereBuffers[3] = {0,0,0};
     glm::vec3 sphereTranslation = glm::vec3(0.44f,0.33f,0.51f);
     sphere_directions m_sphereDirection;
 
 
-    std::vector<glm::vec3> vertexPositions;
-    std::vector<glm::vec3> vertexNormals;
-    std::vector<glm::vec3> m_forces;
-    std::vector<PointMass> pointMasses;
-    std::vector<Spring> m_springs;
+    /// Wind over the main cloth, resampled around it every frame, and the time it's at
+    std::unique_ptr<WindField> m_wind;
+    float m_windTime = 0.0f;
+
+    /// Point cache playback and recording
+    PointCache m_pointCache;
+    PointCacheWriter m_pointCacheWriter;
+    unsigned int m_cacheFrame = 0;
+    bool m_cachePlaying = true;
+
+    /// For a reordered mesh, the file index of each particle, and room to shuffle a frame
+    std::vector<unsigned int> m_exportOrder;
+    std::vector<glm::vec3> m_exportScratch;
+
+    /// Programs compile in the background from the start of initGL
+    ShaderPrograms m_programs;
 
+    /// What the cloth loader is building, with its export order, and whether m_cloth has
+    /// been set up yet. Only the loader touches these until its future is ready.
+    Cloth m_pendingCloth;
+    std::vector<unsigned int> m_pendingExportOrder;
+    bool m_clothReady = false;
 
+    /// Loads running on other threads. Declared last so they're waited for before
+    /// anything they write is destroyed.
+    std::future<bool> m_clothLoad;
+    std::future<bool> m_sphereLoad;
 };
 
 #endif // ClothScene_H
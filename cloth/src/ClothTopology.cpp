@@ -0,0 +1,295 @@
+#include "ClothTopology.h"
+#include "MeshLoader.h"
+
+#include <iostream>
+#include <stdint.h>
+#include <algorithm>
+#include <numeric>
+
+bool ClothTopology::load(const std::string &_path, size_t _numThreads)
+{
+  MeshLoader loader;
+  if(!loader.load(_path, true, _numThreads)) return false;
+  std::vector<glm::vec3> positions(loader.positions(), loader.positions() + loader.numVertices());
+  std::vector<unsigned int> triangles(loader.triangles(), loader.triangles() + 3*loader.numTriangles());
+  return build(positions, triangles);
+}
+
+namespace
+{
+  /// Open addressing table from a directed edge to the half-edge that runs along it
+  class EdgeTable
+  {
+  public:
+    explicit EdgeTable(size_t _count)
+    {
+      size_t capacity = 16;
+      while(capacity < _count*2) capacity *= 2;
+      Slot empty = {s_empty, -1};
+      m_slots.assign(capacity, empty);
+      m_mask = capacity - 1;
+    }
+
+    static uint64_t key(unsigned int _from, unsigned int _to) {return (uint64_t(_from)<<32) | _to;}
+
+    /// Returns false if the key is already there
+    bool insert(uint64_t _key, int _value)
+    {
+      for(size_t i = slot(_key);; i = (i+1) & m_mask)
+      {
+        if(m_slots[i].key == _key) return false;
+        if(m_slots[i].key == s_empty)
+        {
+          m_slots[i].key = _key;
+          m_slots[i].value = _value;
+          return true;
+        }
+      }
+    }
+
+    int find(uint64_t _key) const
+    {
+      for(size_t i = slot(_key);; i = (i+1) & m_mask)
+      {
+        if(m_slots[i].key == _key) return m_slots[i].value;
+        if(m_slots[i].key == s_empty) return -1;
+      }
+    }
+
+  private:
+    size_t slot(uint64_t _key) const {return size_t((_key * 0x9E3779B97F4A7C15ull) >> 20) & m_mask;}
+
+    /// Key and value side by side so a probe only touches one cache line
+    struct Slot
+    {
+      uint64_t key;
+      int value;
+    };
+
+    static const uint64_t s_empty = ~uint64_t(0);
+    std::vector<Slot> m_slots;
+    size_t m_mask;
+  };
+
+  const uint64_t EdgeTable::s_empty;
+}
+
+bool ClothTopology::build(const std::vector<glm::vec3> &_positions, const std::vector<unsigned int> &_triangles)
+{
+  m_positions.clear();
+  m_triangles.clear();
+  m_twins.clear();
+  if(_triangles.size()%3 != 0)
+  {
+    std::cerr<<"ClothTopology: index count isn't a multiple of 3\n";
+    return false;
+  }
+  for(unsigned int v : _triangles)
+  {
+    if(v >= _positions.size())
+    {
+      std::cerr<<"ClothTopology: index "<<v<<" out of range ("<<_positions.size()<<" vertices)\n";
+      return false;
+    }
+  }
+
+  int numHalfEdges = int(_triangles.size());
+  EdgeTable edges(_triangles.size());
+  for(int h=0; h<numHalfEdges; ++h)
+  {
+    unsigned int from = _triangles[h], to = _triangles[next(h)];
+    if(!edges.insert(EdgeTable::key(from, to), h))
+    {
+      std::cerr<<"ClothTopology: edge "<<from<<"-"<<to<<" is shared by more than two triangles or they're wound inconsistently\n";
+      return false;
+    }
+  }
+
+  m_twins.resize(numHalfEdges);
+  for(int h=0; h<numHalfEdges; ++h)
+  {
+    m_twins[h] = edges.find(EdgeTable::key(_triangles[next(h)], _triangles[h]));
+  }
+
+  m_positions = _positions;
+  m_triangles = _triangles;
+  m_originalIndices.resize(m_positions.size());
+  std::iota(m_originalIndices.begin(), m_originalIndices.end(), 0u);
+  return true;
+}
+
+namespace
+{
+  /// Spread the low 10 bits of _v out to every third bit
+  uint32_t spreadBits(uint32_t _v)
+  {
+    _v &= 0x3ff;
+    _v = (_v | (_v << 16)) & 0x030000ff;
+    _v = (_v | (_v << 8)) & 0x0300f00f;
+    _v = (_v | (_v << 4)) & 0x030c30c3;
+    _v = (_v | (_v << 2)) & 0x09249249;
+    return _v;
+  }
+
+  /// Breadth first from _start over the CSR graph, appending the vertices it reaches to
+  /// o_order, lowest degree neighbours first. Returns the last vertex reached.
+  unsigned int cuthillMcKee(unsigned int _start, const std::vector<unsigned int> &_offsets,
+                            const std::vector<unsigned int> &_adjacency, std::vector<char> &io_visited,
+                            std::vector<unsigned int> &o_order)
+  {
+    size_t head = o_order.size();
+    o_order.push_back(_start);
+    io_visited[_start] = 1;
+    while(head < o_order.size())
+    {
+      unsigned int v = o_order[head++];
+      size_t first = o_order.size();
+      for(unsigned int a=_offsets[v]; a<_offsets[v+1]; ++a)
+      {
+        unsigned int n = _adjacency[a];
+        if(io_visited[n]) continue;
+        io_visited[n] = 1;
+        o_order.push_back(n);
+      }
+      std::sort(o_order.begin() + first, o_order.end(), [&](unsigned int a, unsigned int b)
+      {
+        return _offsets[a+1] - _offsets[a] < _offsets[b+1] - _offsets[b];
+      });
+    }
+    return o_order.back();
+  }
+}
+
+void ClothTopology::reorder(ReorderMethod _method)
+{
+  size_t count = m_positions.size();
+  if(_method == REORDER_NONE || count == 0) return;
+
+  // order[new] = old
+  std::vector<unsigned int> order(count);
+  std::iota(order.begin(), order.end(), 0u);
+
+  if(_method == REORDER_MORTON)
+  {
+    glm::vec3 lower = m_positions[0], upper = m_positions[0];
+    for(const glm::vec3 &p : m_positions)
+    {
+      lower = glm::min(lower, p);
+      upper = glm::max(upper, p);
+    }
+    glm::vec3 extent = upper - lower;
+    float scale = 1023.0f/std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-20f));
+
+    std::vector<uint32_t> codes(count);
+    for(size_t i=0; i<count; ++i)
+    {
+      glm::vec3 q = (m_positions[i] - lower)*scale;
+      codes[i] = (spreadBits(uint32_t(q.x)) << 2) | (spreadBits(uint32_t(q.y)) << 1) | spreadBits(uint32_t(q.z));
+    }
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {return codes[a] < codes[b];});
+  }
+  else
+  {
+    // Undirected adjacency in CSR form, from the half-edges plus the missing direction
+    // of every boundary edge
+    std::vector<unsigned int> offsets(count + 1, 0);
+    for(size_t h=0; h<m_twins.size(); ++h)
+    {
+      ++offsets[source(int(h)) + 1];
+      if(m_twins[h] == -1) ++offsets[target(int(h)) + 1];
+    }
+    for(size_t v=0; v<count; ++v) offsets[v+1] += offsets[v];
+    std::vector<unsigned int> adjacency(offsets[count]);
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for(size_t h=0; h<m_twins.size(); ++h)
+    {
+      adjacency[fill[source(int(h))]++] = target(int(h));
+      if(m_twins[h] == -1) adjacency[fill[target(int(h))]++] = source(int(h));
+    }
+
+    // Each connected piece starts from a pseudo-peripheral vertex: the last one reached
+    // by a search from its lowest degree vertex
+    std::vector<unsigned int> byDegree(count);
+    std::iota(byDegree.begin(), byDegree.end(), 0u);
+    std::stable_sort(byDegree.begin(), byDegree.end(), [&](unsigned int a, unsigned int b)
+    {
+      return offsets[a+1] - offsets[a] < offsets[b+1] - offsets[b];
+    });
+
+    order.clear();
+    std::vector<char> visited(count, 0), scratchVisited(count, 0);
+    std::vector<unsigned int> scratch;
+    for(unsigned int start : byDegree)
+    {
+      if(visited[start]) continue;
+      scratch.clear();
+      unsigned int far = cuthillMcKee(start, offsets, adjacency, scratchVisited, scratch);
+      cuthillMcKee(far, offsets, adjacency, visited, order);
+    }
+    std::reverse(order.begin(), order.end());
+  }
+
+  std::vector<unsigned int> newIndex(count);
+  for(size_t i=0; i<count; ++i) newIndex[order[i]] = (unsigned int)i;
+
+  std::vector<glm::vec3> positions(count);
+  std::vector<unsigned int> original(count);
+  for(size_t i=0; i<count; ++i)
+  {
+    positions[i] = m_positions[order[i]];
+    original[i] = m_originalIndices[order[i]];
+  }
+
+  // Renumber the triangles and sort them by their lowest corner, keeping their winding
+  size_t numTris = m_triangles.size()/3;
+  std::vector<unsigned int> renumbered(m_triangles.size());
+  for(size_t i=0; i<m_triangles.size(); ++i) renumbered[i] = newIndex[m_triangles[i]];
+  std::vector<unsigned int> triOrder(numTris);
+  std::iota(triOrder.begin(), triOrder.end(), 0u);
+  std::vector<unsigned int> lowest(numTris);
+  for(size_t t=0; t<numTris; ++t)
+    lowest[t] = std::min(renumbered[3*t], std::min(renumbered[3*t+1], renumbered[3*t+2]));
+  std::stable_sort(triOrder.begin(), triOrder.end(), [&](unsigned int a, unsigned int b) {return lowest[a] < lowest[b];});
+  std::vector<unsigned int> triangles(m_triangles.size());
+  for(size_t t=0; t<numTris; ++t)
+    for(int k=0; k<3; ++k) triangles[3*t+k] = renumbered[3*triOrder[t]+k];
+
+  // Same mesh, so this can't fail, it just redoes the twins
+  build(positions, triangles);
+  m_originalIndices = original;
+}
+
+void ClothTopology::buildSprings(float _stiffness, float _damping, std::vector<Spring> &o_springs) const
+{
+  o_springs.clear();
+  o_springs.reserve(m_triangles.size()*2);
+
+  // Each edge is visited from the half-edge with the lower index, or its only one on the boundary
+  for(int h=0; h<int(m_twins.size()); ++h)
+  {
+    int t = m_twins[h];
+    if(t != -1 && t < h) continue;
+
+    Spring structural;
+    structural.PointMassA = int(source(h));
+    structural.PointMassB = int(target(h));
+    structural.restingDistance = glm::length(m_positions[source(h)] - m_positions[target(h)]);
+    structural.stiffness = _stiffness;
+    structural.damping = _damping;
+    o_springs.push_back(structural);
+
+    if(t == -1) continue;
+
+    // The corners opposite this edge in the two triangles either side of it
+    unsigned int a = source(prev(h));
+    unsigned int b = source(prev(t));
+    if(a == b) continue;
+    Spring bend;
+    bend.PointMassA = int(a);
+    bend.PointMassB = int(b);
+    bend.restingDistance = glm::length(m_positions[a] - m_positions[b]);
+    bend.stiffness = _stiffness;
+    bend.damping = _damping;
+    o_springs.push_back(bend);
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef ClothTopology_H
+#define ClothTopology_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include "SpringStream.h"
+
+/// How to renumber the particles of a mesh so neighbours sit close together in memory
+enum ReorderMethod {REORDER_NONE, REORDER_MORTON, REORDER_RCM};
+
+/// Connectivity of an arbitrary manifold triangle mesh, for cloth that isn't a square
+/// sheet. Half-edge h belongs to triangle h/3 and runs from corner h%3 to the next
+/// corner, so next, previous and face are implicit and only the twins are stored.
+/// Twins are matched through a hash of directed edges, so building is linear in the
+/// number of triangles.
+class ClothTopology
+{
+public:
+  /// Load an OBJ or OFF (picked by extension) through MeshLoader and build it, parsing
+  /// on _numThreads threads (0 for one per hardware thread)
+  bool load(const std::string &_path, size_t _numThreads = 0);
+
+  /// Build the half-edges of _triangles (3 indices each, consistently wound). Fails if
+  /// the mesh isn't an oriented manifold, i.e. some directed edge appears twice.
+  bool build(const std::vector<glm::vec3> &_positions, const std::vector<unsigned int> &_triangles);
+
+  /// Structural springs along every edge and bend springs across every interior edge
+  /// (between the two vertices opposite it), rest lengths taken from the positions
+  void buildSprings(float _stiffness, float _damping, std::vector<Spring> &o_springs) const;
+
+  /// Renumber the vertices, either along a Morton curve through the rest positions or by
+  /// reverse Cuthill-McKee on the edge graph, then sort the triangles by their lowest
+  /// vertex. Springs built afterwards follow the same order, so the solver walks memory
+  /// mostly forwards instead of jumping around the way the file happened to list things.
+  void reorder(ReorderMethod _method);
+
+  /// For each vertex, its index in the file it was loaded from (identity unless reordered),
+  /// so results can be written out in the original order
+  const std::vector<unsigned int> &originalIndices() const {return m_originalIndices;}
+
+  size_t numVertices() const {return m_positions.size();}
+  size_t numTriangles() const {return m_triangles.size()/3;}
+  const std::vector<glm::vec3> &positions() const {return m_positions;}
+  const std::vector<unsigned int> &triangles() const {return m_triangles;}
+
+  /// Half-edge navigation, -1 for a twin means the edge is on the boundary
+  static int next(int _h) {return _h - _h%3 + (_h%3 + 1)%3;}
+  static int prev(int _h) {return _h - _h%3 + (_h%3 + 2)%3;}
+  static int face(int _h) {return _h/3;}
+  int twin(int _h) const {return m_twins[_h];}
+  unsigned int source(int _h) const {return m_triangles[_h];}
+  unsigned int target(int _h) const {return m_triangles[next(_h)];}
+
+private:
+  std::vector<glm::vec3> m_positions;
+  std::vector<unsigned int> m_triangles;
+  std::vector<int> m_twins;
+  std::vector<unsigned int> m_originalIndices;
+};
+
+#endif // ClothTopology_H
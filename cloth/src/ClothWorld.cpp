@@ -0,0 +1,151 @@
+#include "ClothWorld.h"
+
+ClothWorld::ClothWorld(size_t _numThreads) : m_pool(_numThreads) {}
+
+size_t ClothWorld::addCloth(const ClothParameters &_params, const glm::vec3 &_offset)
+{
+  m_cloths.emplace_back(new Cloth(_params));
+  m_cloths.back()->initSpringsAndVerts();
+  m_offsets.push_back(_offset);
+  return m_cloths.size() - 1;
+}
+
+void ClothWorld::updateSimulation(integrators _whichIntegrator)
+{
+  // Particle count is a good enough estimate of how long a cloth takes to step
+  std::vector<size_t> costs(m_cloths.size());
+  for(size_t i=0; i<m_cloths.size(); ++i) costs[i] = m_cloths[i]->numParticles();
+
+  m_pool.run(costs, [&](size_t i)
+  {
+    Cloth &cloth = *m_cloths[i];
+    // Each cloth simulates in its own space, so bring the collider into it
+    cloth.updateSimulation(_whichIntegrator, m_colliderCentre - m_offsets[i], m_colliderRadius);
+    cloth.updateNormals(&cloth.positions()[0]);
+  });
+}
+
+void ClothWorld::initGL()
+{
+  destroyGL();
+
+  // Group the cloths by topology
+  for(size_t i=0; i<m_cloths.size(); ++i)
+  {
+    int res = m_cloths[i]->resolution();
+    size_t g = 0;
+    while(g < m_groups.size() && m_groups[g].res != res) ++g;
+    if(g == m_groups.size())
+    {
+      m_groups.push_back(InstanceGroup());
+      m_groups.back().res = res;
+    }
+    m_groups[g].members.push_back(i);
+  }
+
+  for(InstanceGroup &group : m_groups)
+  {
+    const Cloth &first = *m_cloths[group.members[0]];
+    size_t bytes = group.members.size() * first.numParticles() * sizeof(glm::vec3);
+
+    glGenVertexArrays(1, &group.vertexArrayIdx);
+    glBindVertexArray(group.vertexArrayIdx);
+
+    std::vector<unsigned int> tris;
+    first.buildTriangles(tris);
+    group.numIndices = GLsizei(tris.size());
+    glGenBuffers(1, &group.elementsIdx);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, group.elementsIdx);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, tris.size()*sizeof(GLuint), &tris[0], GL_STATIC_DRAW);
+
+    // One offset per instance, advanced once per instance rather than per vertex
+    std::vector<glm::vec3> offsets;
+    for(size_t i : group.members) offsets.push_back(m_offsets[i]);
+    glGenBuffers(1, &group.offsetsIdx);
+    glBindBuffer(GL_ARRAY_BUFFER, group.offsetsIdx);
+    glBufferData(GL_ARRAY_BUFFER, offsets.size()*sizeof(glm::vec3), &offsets[0], GL_STATIC_DRAW);
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glVertexAttribDivisor(3, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Positions and normals of every member back to back, read through texture buffers
+    glGenBuffers(1, &group.posIdx);
+    glBindBuffer(GL_TEXTURE_BUFFER, group.posIdx);
+    glBufferData(GL_TEXTURE_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &group.normalsIdx);
+    glBindBuffer(GL_TEXTURE_BUFFER, group.normalsIdx);
+    glBufferData(GL_TEXTURE_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &group.posTex);
+    glBindTexture(GL_TEXTURE_BUFFER, group.posTex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGB32F, group.posIdx);
+    glGenTextures(1, &group.normalsTex);
+    glBindTexture(GL_TEXTURE_BUFFER, group.normalsTex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGB32F, group.normalsIdx);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+  }
+}
+
+void ClothWorld::draw(GLint _pid)
+{
+  glUniform1i(glGetUniformLocation(_pid, "Positions"), 0);
+  glUniform1i(glGetUniformLocation(_pid, "Normals"), 1);
+  GLint vertsLoc = glGetUniformLocation(_pid, "VerticesPerInstance");
+
+  for(InstanceGroup &group : m_groups)
+  {
+    size_t numVerts = m_cloths[group.members[0]]->numParticles();
+    size_t bytes = numVerts * sizeof(glm::vec3);
+
+    // Only the rows each cloth changed, cloths that are entirely asleep send nothing
+    std::vector<std::pair<int,int>> ranges;
+    for(size_t m=0; m<group.members.size(); ++m)
+    {
+      const Cloth &cloth = *m_cloths[group.members[m]];
+      cloth.changedRanges(ranges, 2);
+      for(const std::pair<int,int> &range : ranges)
+      {
+        GLintptr offset = m*bytes + range.first*sizeof(glm::vec3);
+        GLsizeiptr size = (range.second-range.first)*sizeof(glm::vec3);
+        glBindBuffer(GL_TEXTURE_BUFFER, group.posIdx);
+        glBufferSubData(GL_TEXTURE_BUFFER, offset, size, &cloth.positions()[range.first]);
+        glBindBuffer(GL_TEXTURE_BUFFER, group.normalsIdx);
+        glBufferSubData(GL_TEXTURE_BUFFER, offset, size, &cloth.normals()[range.first]);
+      }
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, group.posTex);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, group.normalsTex);
+    glUniform1i(vertsLoc, GLint(numVerts));
+
+    glBindVertexArray(group.vertexArrayIdx);
+    glDrawElementsInstanced(GL_TRIANGLES, group.numIndices, GL_UNSIGNED_INT, 0, GLsizei(group.members.size()));
+    glBindVertexArray(0);
+  }
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClothWorld::destroyGL()
+{
+  for(InstanceGroup &group : m_groups)
+  {
+    glDeleteTextures(1, &group.posTex);
+    glDeleteTextures(1, &group.normalsTex);
+    glDeleteBuffers(1, &group.posIdx);
+    glDeleteBuffers(1, &group.normalsIdx);
+    glDeleteBuffers(1, &group.offsetsIdx);
+    glDeleteBuffers(1, &group.elementsIdx);
+    glDeleteVertexArrays(1, &group.vertexArrayIdx);
+  }
+  m_groups.clear();
+}
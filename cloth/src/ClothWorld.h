@@ -0,0 +1,67 @@
+#ifndef ClothWorld_H
+#define ClothWorld_H
+
+#include "glinclude.h"
+#include "Cloth.h"
+#include "workstealingpool.h"
+#include <memory>
+#include <vector>
+
+/// Owns many independent cloths (flags, capes, parameter sweeps). All of them are
+/// stepped in parallel on a work stealing pool balanced by particle count, and every
+/// group of cloths with the same resolution is drawn with a single instanced call.
+class ClothWorld
+{
+public:
+  /// 0 threads means one per hardware thread
+  explicit ClothWorld(size_t _numThreads = 0);
+
+  /// Add a cloth placed at _offset in world space, returns its index
+  size_t addCloth(const ClothParameters &_params, const glm::vec3 &_offset);
+
+  size_t size() const {return m_cloths.size();}
+  Cloth &cloth(size_t _i) {return *m_cloths[_i];}
+
+  /// A sphere (in world space) every cloth collides against
+  void setCollider(const glm::vec3 &_centre, float _radius) {m_colliderCentre = _centre; m_colliderRadius = _radius;}
+
+  /// Step every cloth one frame and recompute its normals
+  void updateSimulation(integrators _whichIntegrator);
+
+  /// Create the GL buffers, call once all cloths are added and a context is current
+  void initGL();
+
+  /// Upload this frame's positions and draw every group with the bound instanced program
+  void draw(GLint _pid);
+
+private:
+  /// Cloths sharing a topology share one index buffer and one draw call. Positions and
+  /// normals for every member sit back to back in texture buffers that the vertex shader
+  /// indexes with gl_InstanceID.
+  struct InstanceGroup
+  {
+    int res;
+    std::vector<size_t> members;
+    GLsizei numIndices = 0;
+    GLuint vertexArrayIdx = 0;
+    GLuint elementsIdx = 0;
+    GLuint offsetsIdx = 0;
+    GLuint posIdx = 0;
+    GLuint normalsIdx = 0;
+    GLuint posTex = 0;
+    GLuint normalsTex = 0;
+  };
+
+  /// Free the GL objects of every group (only valid while the context is alive)
+  void destroyGL();
+
+  WorkStealingPool m_pool;
+  std::vector<std::unique_ptr<Cloth>> m_cloths;
+  std::vector<glm::vec3> m_offsets;
+  std::vector<InstanceGroup> m_groups;
+
+  glm::vec3 m_colliderCentre = glm::vec3(0.0f);
+  float m_colliderRadius = 0.0f;
+};
+
+#endif // ClothWorld_H
@@ -0,0 +1,479 @@
+#include "MeshLoader.h"
+#include "workstealingpool.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+static const char s_meshCacheMagic[4] = {'M','S','H','C'};
+static const uint32_t s_meshCacheVersion = 1;
+
+/// OBJ indices that are relative to the vertices read so far get this bias added, so
+/// they can be told apart and fixed up once every chunk's vertex count is known
+static const int64_t s_relativeIndex = int64_t(1) << 62;
+
+namespace
+{
+  size_t align8(size_t _bytes) {return (_bytes + 7) & ~size_t(7);}
+
+  inline bool isSpace(char _c) {return _c == ' ' || _c == '\t' || _c == '\r';}
+
+  inline const char *skipSpaces(const char *_p, const char *_end)
+  {
+    while(_p < _end && isSpace(*_p)) ++_p;
+    return _p;
+  }
+
+  inline const char *nextLine(const char *_p, const char *_end)
+  {
+    const char *eol = static_cast<const char *>(memchr(_p, '\n', size_t(_end - _p)));
+    return eol ? eol + 1 : _end;
+  }
+
+  /// Parse a decimal float, returns nullptr if there isn't one. Up to 19 significant
+  /// digits go into an integer which is then scaled once by an exact power of ten, which
+  /// is plenty for single precision and several times faster than strtof.
+  const char *parseFloat(const char *_p, const char *_end, float &o_value)
+  {
+    static const double s_powers[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+                                      1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+    _p = skipSpaces(_p, _end);
+    bool negative = false;
+    if(_p < _end && (*_p == '-' || *_p == '+')) negative = *_p++ == '-';
+
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0, significant = 0;
+    for(; _p < _end && unsigned(*_p - '0') < 10; ++_p, ++digits)
+    {
+      if(significant < 19) {mantissa = mantissa*10 + unsigned(*_p - '0'); if(mantissa) ++significant;}
+      else ++exponent;
+    }
+    if(_p < _end && *_p == '.')
+    {
+      for(++_p; _p < _end && unsigned(*_p - '0') < 10; ++_p, ++digits)
+      {
+        if(significant < 19) {mantissa = mantissa*10 + unsigned(*_p - '0'); if(mantissa) ++significant; --exponent;}
+      }
+    }
+    if(digits == 0) return nullptr;
+    if(_p < _end && (*_p == 'e' || *_p == 'E'))
+    {
+      const char *e = _p + 1;
+      bool negativeExp = false;
+      if(e < _end && (*e == '-' || *e == '+')) negativeExp = *e++ == '-';
+      int value = 0;
+      const char *start = e;
+      for(; e < _end && unsigned(*e - '0') < 10; ++e) value = std::min(value*10 + int(*e - '0'), 10000);
+      if(e != start)
+      {
+        exponent += negativeExp ? -value : value;
+        _p = e;
+      }
+    }
+
+    double value = double(mantissa);
+    if(exponent < 0)
+      value = exponent >= -22 ? value/s_powers[-exponent] : value*pow(10.0, exponent);
+    else if(exponent > 0)
+      value = exponent <= 22 ? value*s_powers[exponent] : value*pow(10.0, exponent);
+    o_value = float(negative ? -value : value);
+    return _p;
+  }
+
+  /// Parse a decimal integer, returns nullptr if there isn't one
+  const char *parseInt(const char *_p, const char *_end, int64_t &o_value)
+  {
+    _p = skipSpaces(_p, _end);
+    bool negative = false;
+    if(_p < _end && (*_p == '-' || *_p == '+')) negative = *_p++ == '-';
+    const char *start = _p;
+    int64_t value = 0;
+    for(; _p < _end && unsigned(*_p - '0') < 10; ++_p) value = value*10 + (*_p - '0');
+    if(_p == start) return nullptr;
+    o_value = negative ? -value : value;
+    return _p;
+  }
+
+  /// Whatever one chunk of lines produced
+  struct Chunk
+  {
+    const char *begin;
+    const char *end;
+    std::vector<glm::vec3> positions;
+    /// Triangle corners, for OBJ as raw indices to be resolved once the chunks are merged
+    std::vector<int64_t> corners;
+    size_t firstLine = 0;
+    size_t numLines = 0;
+    bool ok = true;
+  };
+
+  /// Split [_begin,_end) into about _count pieces that each start on a new line
+  void splitLines(const char *_begin, const char *_end, size_t _count, std::vector<Chunk> &o_chunks)
+  {
+    o_chunks.clear();
+    size_t size = size_t(_end - _begin);
+    const char *p = _begin;
+    for(size_t c=0; c<_count && p < _end; ++c)
+    {
+      const char *stop = c+1 == _count ? _end : std::max(p, _begin + size*(c+1)/_count);
+      if(stop < _end) stop = nextLine(stop, _end);
+      if(stop == p) continue;
+      o_chunks.push_back(Chunk());
+      o_chunks.back().begin = p;
+      o_chunks.back().end = stop;
+      p = stop;
+    }
+  }
+
+  /// Add the triangles of a polygon fan to o_corners
+  template <typename T>
+  void fan(const std::vector<T> &_polygon, std::vector<int64_t> &o_corners)
+  {
+    for(size_t k=2; k<_polygon.size(); ++k)
+    {
+      o_corners.push_back(_polygon[0]);
+      o_corners.push_back(_polygon[k-1]);
+      o_corners.push_back(_polygon[k]);
+    }
+  }
+
+  void parseOBJChunk(Chunk &io_chunk)
+  {
+    std::vector<int64_t> polygon;
+    const char *end = io_chunk.end;
+    for(const char *p = io_chunk.begin; p < end && io_chunk.ok; p = nextLine(p, end))
+    {
+      p = skipSpaces(p, end);
+      if(end - p < 2 || !isSpace(p[1])) continue;
+      if(p[0] == 'v')
+      {
+        glm::vec3 v;
+        const char *q = parseFloat(p+1, end, v.x);
+        if(q) q = parseFloat(q, end, v.y);
+        if(q) q = parseFloat(q, end, v.z);
+        if(!q) io_chunk.ok = false;
+        io_chunk.positions.push_back(v);
+      }
+      else if(p[0] == 'f')
+      {
+        // v, v/vt, v//vn or v/vt/vn, only the first number matters
+        polygon.clear();
+        const char *q = p+1;
+        int64_t index;
+        while((q = parseInt(q, end, index)) != nullptr)
+        {
+          if(index > 0) polygon.push_back(index - 1);
+          else if(index < 0) polygon.push_back(s_relativeIndex + int64_t(io_chunk.positions.size()) + index);
+          else io_chunk.ok = false;
+          while(q < end && !isSpace(*q) && *q != '\n') ++q;
+        }
+        fan(polygon, io_chunk.corners);
+      }
+    }
+  }
+
+  /// Count the non blank lines, the OFF body has one vertex or face on each
+  void countOFFChunk(Chunk &io_chunk)
+  {
+    const char *end = io_chunk.end;
+    for(const char *p = io_chunk.begin; p < end; p = nextLine(p, end))
+    {
+      p = skipSpaces(p, end);
+      if(p < end && *p != '\n' && *p != '#') ++io_chunk.numLines;
+    }
+  }
+
+  void parseOFFChunk(Chunk &io_chunk, size_t _numVertices, glm::vec3 *o_positions)
+  {
+    std::vector<int64_t> polygon;
+    const char *end = io_chunk.end;
+    size_t line = io_chunk.firstLine;
+    for(const char *p = io_chunk.begin; p < end && io_chunk.ok; p = nextLine(p, end))
+    {
+      p = skipSpaces(p, end);
+      if(p >= end || *p == '\n' || *p == '#') continue;
+      if(line < _numVertices)
+      {
+        glm::vec3 &v = o_positions[line];
+        const char *q = parseFloat(p, end, v.x);
+        if(q) q = parseFloat(q, end, v.y);
+        if(q) q = parseFloat(q, end, v.z);
+        if(!q) io_chunk.ok = false;
+      }
+      else
+      {
+        int64_t corners = 0, index = 0;
+        const char *q = parseInt(p, end, corners);
+        polygon.clear();
+        for(int64_t k=0; q && k<corners; ++k)
+        {
+          q = parseInt(q, end, index);
+          polygon.push_back(index);
+        }
+        if(!q) io_chunk.ok = false;
+        fan(polygon, io_chunk.corners);
+      }
+      ++line;
+    }
+  }
+}
+
+MeshLoader::~MeshLoader()
+{
+  clear();
+}
+
+void MeshLoader::clear()
+{
+  if(m_map != nullptr) munmap(m_map, m_mapSize);
+  m_map = nullptr;
+  m_mapSize = 0;
+  std::vector<glm::vec3>().swap(m_ownPositions);
+  std::vector<glm::vec3>().swap(m_ownNormals);
+  std::vector<unsigned int>().swap(m_ownTriangles);
+  m_positions = m_normals = nullptr;
+  m_triangles = nullptr;
+  m_numVertices = m_numTriangles = 0;
+}
+
+bool MeshLoader::load(const std::string &_path, bool _useCache, size_t _numThreads)
+{
+  clear();
+
+  int fd = ::open(_path.c_str(), O_RDONLY);
+  struct stat st;
+  if(fd < 0 || fstat(fd, &st) != 0)
+  {
+    if(fd >= 0) ::close(fd);
+    std::cerr<<"MeshLoader: could not open "<<_path<<"\n";
+    return false;
+  }
+  uint64_t sourceSize = uint64_t(st.st_size);
+  int64_t sourceTime = int64_t(st.st_mtime);
+
+  std::string cachePath = _path + ".meshcache";
+  if(_useCache && mapCache(cachePath, sourceSize, sourceTime))
+  {
+    ::close(fd);
+    return true;
+  }
+
+  if(sourceSize == 0)
+  {
+    ::close(fd);
+    std::cerr<<"MeshLoader: "<<_path<<" is empty\n";
+    return false;
+  }
+  void *text = mmap(nullptr, sourceSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(text == MAP_FAILED)
+  {
+    std::cerr<<"MeshLoader: could not map "<<_path<<"\n";
+    return false;
+  }
+  // We read it front to back exactly once
+  madvise(text, sourceSize, MADV_SEQUENTIAL);
+
+  std::string ext = _path.size() > 4 ? _path.substr(_path.size()-4) : "";
+  for(char &c : ext) c = char(tolower(c));
+  bool ok = parse(static_cast<const char *>(text), sourceSize, ext == ".off", _numThreads);
+  munmap(text, sourceSize);
+  if(!ok)
+  {
+    std::cerr<<"MeshLoader: could not parse "<<_path<<"\n";
+    clear();
+    return false;
+  }
+
+  computeNormals();
+  if(_useCache) writeCache(cachePath, sourceSize, sourceTime);
+  return true;
+}
+
+bool MeshLoader::parse(const char *_text, size_t _size, bool _isOFF, size_t _numThreads)
+{
+  const char *begin = _text, *end = _text + _size;
+  size_t numVertices = 0, numFaces = 0;
+  if(_isOFF)
+  {
+    // "OFF", then the vertex, face and edge counts, possibly after comments
+    const char *p = skipSpaces(begin, end);
+    if(end - p < 3 || strncmp(p, "OFF", 3) != 0) return false;
+    p += 3;
+    int64_t counts[3];
+    for(int i=0; i<3; ++i)
+    {
+      while(p < end && (isSpace(*p) || *p == '\n' || *p == '#'))
+      {
+        if(*p == '#') p = nextLine(p, end);
+        else ++p;
+      }
+      if(!(p = parseInt(p, end, counts[i])) || counts[i] < 0) return false;
+    }
+    numVertices = size_t(counts[0]);
+    numFaces = size_t(counts[1]);
+    begin = nextLine(p, end);
+  }
+
+  WorkStealingPool pool(_numThreads);
+  std::vector<Chunk> chunks;
+  splitLines(begin, end, pool.numThreads()*4, chunks);
+
+  if(_isOFF)
+  {
+    // Which line each chunk starts on tells it whether it's reading vertices or faces
+    m_ownPositions.resize(numVertices);
+    pool.parallelFor(chunks.size(), [&](size_t c) {countOFFChunk(chunks[c]);});
+    size_t line = 0;
+    for(Chunk &chunk : chunks)
+    {
+      chunk.firstLine = line;
+      line += chunk.numLines;
+    }
+    if(line < numVertices + numFaces) return false;
+    pool.parallelFor(chunks.size(), [&](size_t c) {parseOFFChunk(chunks[c], numVertices, &m_ownPositions[0]);});
+  }
+  else
+  {
+    pool.parallelFor(chunks.size(), [&](size_t c) {parseOBJChunk(chunks[c]);});
+  }
+
+  // Stitch the chunks together. Each one's vertices and triangles start where the
+  // previous one's stopped.
+  std::vector<size_t> vertexStart(chunks.size()), cornerStart(chunks.size());
+  size_t vertices = _isOFF ? numVertices : 0, corners = 0;
+  for(size_t c=0; c<chunks.size(); ++c)
+  {
+    if(!chunks[c].ok) return false;
+    vertexStart[c] = vertices;
+    cornerStart[c] = corners;
+    vertices += chunks[c].positions.size();
+    corners += chunks[c].corners.size();
+  }
+  if(!_isOFF) m_ownPositions.resize(vertices);
+  m_ownTriangles.resize(corners);
+
+  std::atomic<bool> inRange(true);
+  pool.parallelFor(chunks.size(), [&](size_t c)
+  {
+    Chunk &chunk = chunks[c];
+    if(!chunk.positions.empty())
+      memcpy(&m_ownPositions[vertexStart[c]], &chunk.positions[0], chunk.positions.size()*sizeof(glm::vec3));
+    for(size_t i=0; i<chunk.corners.size(); ++i)
+    {
+      int64_t index = chunk.corners[i];
+      if(index >= s_relativeIndex/2) index = index - s_relativeIndex + int64_t(vertexStart[c]);
+      if(index < 0 || index >= int64_t(vertices)) inRange = false;
+      m_ownTriangles[cornerStart[c] + i] = (unsigned int)index;
+    }
+    std::vector<glm::vec3>().swap(chunk.positions);
+    std::vector<int64_t>().swap(chunk.corners);
+  });
+  if(!inRange) return false;
+
+  m_positions = m_ownPositions.empty() ? nullptr : &m_ownPositions[0];
+  m_triangles = m_ownTriangles.empty() ? nullptr : &m_ownTriangles[0];
+  m_numVertices = m_ownPositions.size();
+  m_numTriangles = m_ownTriangles.size()/3;
+  return true;
+}
+
+void MeshLoader::computeNormals()
+{
+  m_ownNormals.assign(m_numVertices, glm::vec3(0.0f));
+  for(size_t t=0; t<m_numTriangles; ++t)
+  {
+    const unsigned int *tri = m_triangles + 3*t;
+    glm::vec3 n = glm::cross(m_positions[tri[1]] - m_positions[tri[0]], m_positions[tri[2]] - m_positions[tri[0]]);
+    m_ownNormals[tri[0]] += n;
+    m_ownNormals[tri[1]] += n;
+    m_ownNormals[tri[2]] += n;
+  }
+  for(glm::vec3 &n : m_ownNormals)
+  {
+    if(glm::dot(n,n) > 0.0f) n = glm::normalize(n);
+  }
+  m_normals = m_ownNormals.empty() ? nullptr : &m_ownNormals[0];
+}
+
+bool MeshLoader::mapCache(const std::string &_cachePath, uint64_t _sourceSize, int64_t _sourceTime)
+{
+  int fd = ::open(_cachePath.c_str(), O_RDONLY);
+  if(fd < 0) return false;
+  struct stat st;
+  if(fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(MeshCacheHeader))
+  {
+    ::close(fd);
+    return false;
+  }
+  size_t size = size_t(st.st_size);
+  void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(map == MAP_FAILED) return false;
+
+  // Anything stale or odd and we just parse the source again
+  const MeshCacheHeader *header = static_cast<const MeshCacheHeader *>(map);
+  size_t positionsAt = align8(sizeof(MeshCacheHeader));
+  size_t normalsAt = positionsAt + align8(size_t(header->numVertices)*sizeof(glm::vec3));
+  size_t trianglesAt = normalsAt + align8(size_t(header->numVertices)*sizeof(glm::vec3));
+  size_t expected = trianglesAt + size_t(header->numTriangles)*3*sizeof(uint32_t);
+  if(memcmp(header->magic, s_meshCacheMagic, 4) != 0 || header->version != s_meshCacheVersion ||
+     header->sourceSize != _sourceSize || header->sourceTime != _sourceTime || size != expected)
+  {
+    munmap(map, size);
+    return false;
+  }
+
+  m_map = map;
+  m_mapSize = size;
+  const char *base = static_cast<const char *>(map);
+  m_numVertices = header->numVertices;
+  m_numTriangles = header->numTriangles;
+  m_positions = reinterpret_cast<const glm::vec3 *>(base + positionsAt);
+  m_normals = reinterpret_cast<const glm::vec3 *>(base + normalsAt);
+  m_triangles = reinterpret_cast<const unsigned int *>(base + trianglesAt);
+  return true;
+}
+
+void MeshLoader::writeCache(const std::string &_cachePath, uint64_t _sourceSize, int64_t _sourceTime) const
+{
+  MeshCacheHeader header;
+  memset(&header, 0, sizeof(MeshCacheHeader));
+  memcpy(header.magic, s_meshCacheMagic, 4);
+  header.version = s_meshCacheVersion;
+  header.sourceSize = _sourceSize;
+  header.sourceTime = _sourceTime;
+  header.numVertices = uint32_t(m_numVertices);
+  header.numTriangles = uint32_t(m_numTriangles);
+
+  // Write it under another name first so a reader never maps half a cache
+  std::string tmpPath = _cachePath + ".tmp";
+  FILE *file = fopen(tmpPath.c_str(), "wb");
+  if(file == nullptr)
+  {
+    std::cerr<<"MeshLoader: could not write "<<_cachePath<<", the mesh will be parsed again next time\n";
+    return;
+  }
+  static const char s_padding[8] = {0};
+  size_t vertexBytes = m_numVertices*sizeof(glm::vec3);
+  bool ok = fwrite(&header, sizeof(MeshCacheHeader), 1, file) == 1;
+  ok = ok && fwrite(s_padding, 1, align8(sizeof(MeshCacheHeader)) - sizeof(MeshCacheHeader), file) == align8(sizeof(MeshCacheHeader)) - sizeof(MeshCacheHeader);
+  ok = ok && fwrite(m_positions, 1, vertexBytes, file) == vertexBytes;
+  ok = ok && fwrite(s_padding, 1, align8(vertexBytes) - vertexBytes, file) == align8(vertexBytes) - vertexBytes;
+  ok = ok && fwrite(m_normals, 1, vertexBytes, file) == vertexBytes;
+  ok = ok && fwrite(s_padding, 1, align8(vertexBytes) - vertexBytes, file) == align8(vertexBytes) - vertexBytes;
+  ok = ok && fwrite(m_triangles, sizeof(uint32_t), m_numTriangles*3, file) == m_numTriangles*3;
+  ok = fclose(file) == 0 && ok;
+  if(!ok || rename(tmpPath.c_str(), _cachePath.c_str()) != 0)
+  {
+    std::cerr<<"MeshLoader: could not write "<<_cachePath<<", the mesh will be parsed again next time\n";
+    unlink(tmpPath.c_str());
+  }
+}
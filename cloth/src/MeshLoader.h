@@ -0,0 +1,73 @@
+#ifndef MeshLoader_H
+#define MeshLoader_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+/// Layout of a .meshcache sidecar: this header, then positions and normals (3 floats per
+/// vertex) and then triangles (3 uint32 per triangle), each block 8 byte aligned
+struct MeshCacheHeader
+{
+  char magic[4];
+  uint32_t version;
+  /// Size and modification time of the source the cache was made from
+  uint64_t sourceSize;
+  int64_t sourceTime;
+  uint32_t numVertices;
+  uint32_t numTriangles;
+};
+
+/// Loads OFF and OBJ triangle meshes (polygons are fanned). The text is memory mapped and
+/// split into chunks of whole lines that are parsed in parallel with a hand rolled float
+/// parser. The result is written next to the source as a .meshcache file which later
+/// loads map directly, so only the pages that are touched are ever read.
+///
+/// Only positions and faces are read. Normals are always smoothed from the triangles.
+class MeshLoader
+{
+public:
+  MeshLoader() = default;
+  ~MeshLoader();
+  MeshLoader(const MeshLoader &) = delete;
+  MeshLoader &operator=(const MeshLoader &) = delete;
+
+  /// Load _path, through its .meshcache if that is up to date (and _useCache is set).
+  /// The text is parsed on _numThreads threads, 0 means one per hardware thread.
+  bool load(const std::string &_path, bool _useCache = true, size_t _numThreads = 0);
+
+  /// Drop the mesh and unmap any cache
+  void clear();
+
+  size_t numVertices() const {return m_numVertices;}
+  size_t numTriangles() const {return m_numTriangles;}
+  /// These point either into our own arrays or straight into the mapped cache
+  const glm::vec3 *positions() const {return m_positions;}
+  const glm::vec3 *normals() const {return m_normals;}
+  const unsigned int *triangles() const {return m_triangles;}
+
+  /// Whether the last load came out of the cache
+  bool fromCache() const {return m_map != nullptr;}
+
+private:
+  bool parse(const char *_text, size_t _size, bool _isOFF, size_t _numThreads);
+  bool mapCache(const std::string &_cachePath, uint64_t _sourceSize, int64_t _sourceTime);
+  void writeCache(const std::string &_cachePath, uint64_t _sourceSize, int64_t _sourceTime) const;
+  void computeNormals();
+
+  std::vector<glm::vec3> m_ownPositions;
+  std::vector<glm::vec3> m_ownNormals;
+  std::vector<unsigned int> m_ownTriangles;
+
+  void *m_map = nullptr;
+  size_t m_mapSize = 0;
+
+  const glm::vec3 *m_positions = nullptr;
+  const glm::vec3 *m_normals = nullptr;
+  const unsigned int *m_triangles = nullptr;
+  size_t m_numVertices = 0;
+  size_t m_numTriangles = 0;
+};
+
+#endif // MeshLoader_H
@@ -0,0 +1,172 @@
+#include "PointCache.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <iostream>
+
+static const char s_pointCacheMagic[4] = {'C','P','C','1'};
+static const unsigned int s_pointCacheVersion = 1;
+
+PointCacheWriter::~PointCacheWriter()
+{
+  close();
+}
+
+bool PointCacheWriter::open(const std::string &_path, unsigned int _numPoints, float _frameRate,
+                            const PointCodecSettings *_compression)
+{
+  close();
+  if(_compression != nullptr)
+  {
+    m_encoder.reset(new PointCacheEncoder);
+    if(!m_encoder->open(_path, _numPoints, _frameRate, *_compression)) m_encoder.reset();
+    return bool(m_encoder);
+  }
+  m_file = fopen(_path.c_str(), "wb");
+  if(m_file == nullptr)
+  {
+    std::cerr<<"PointCacheWriter: could not open "<<_path<<" for writing\n";
+    return false;
+  }
+  memset(&m_header, 0, sizeof(PointCacheHeader));
+  memcpy(m_header.magic, s_pointCacheMagic, 4);
+  m_header.version = s_pointCacheVersion;
+  m_header.numPoints = _numPoints;
+  m_header.numFrames = 0;
+  m_header.frameRate = _frameRate;
+  return fwrite(&m_header, sizeof(PointCacheHeader), 1, m_file) == 1;
+}
+
+bool PointCacheWriter::writeFrame(const glm::vec3 *_positions)
+{
+  if(m_encoder) return m_encoder->writeFrame(_positions);
+  if(m_file == nullptr) return false;
+  if(fwrite(_positions, sizeof(glm::vec3), m_header.numPoints, m_file) != m_header.numPoints) return false;
+  ++m_header.numFrames;
+  return true;
+}
+
+void PointCacheWriter::close()
+{
+  m_encoder.reset();
+  if(m_file == nullptr) return;
+  // The frame count is only known now, so go back and fix up the header
+  fseek(m_file, 0, SEEK_SET);
+  fwrite(&m_header, sizeof(PointCacheHeader), 1, m_file);
+  fclose(m_file);
+  m_file = nullptr;
+}
+
+PointCache::~PointCache()
+{
+  close();
+}
+
+bool PointCache::open(const std::string &_path)
+{
+  close();
+  int fd = ::open(_path.c_str(), O_RDONLY);
+  if(fd < 0)
+  {
+    std::cerr<<"PointCache: could not open "<<_path<<"\n";
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(PointCacheHeader))
+  {
+    std::cerr<<"PointCache: "<<_path<<" is too small to be a point cache\n";
+    ::close(fd);
+    return false;
+  }
+  m_size = size_t(st.st_size);
+  void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping holds its own reference to the file
+  ::close(fd);
+  if(data == MAP_FAILED)
+  {
+    std::cerr<<"PointCache: mmap of "<<_path<<" failed\n";
+    return false;
+  }
+  m_data = static_cast<char*>(data);
+  m_pageSize = size_t(sysconf(_SC_PAGESIZE));
+  memcpy(&m_header, m_data, sizeof(PointCacheHeader));
+
+  // Compressed caches carry their own header, let the decoder validate it
+  std::unique_ptr<PointCacheDecoder> decoder(new PointCacheDecoder);
+  if(decoder->open(m_data, m_size))
+  {
+    m_decoder = std::move(decoder);
+    return true;
+  }
+
+  // Divide rather than multiply, a header claiming huge counts mustn't wrap around
+  m_frameSize = size_t(m_header.numPoints) * sizeof(glm::vec3);
+  if(memcmp(m_header.magic, s_pointCacheMagic, 4) != 0 ||
+     m_header.version != s_pointCacheVersion ||
+     (m_frameSize > 0 && m_header.numFrames > (m_size - sizeof(PointCacheHeader)) / m_frameSize))
+  {
+    std::cerr<<"PointCache: "<<_path<<" is not a valid point cache\n";
+    close();
+    return false;
+  }
+  return true;
+}
+
+void PointCache::close()
+{
+  if(m_data == nullptr) return;
+  m_decoder.reset();
+  munmap(m_data, m_size);
+  m_data = nullptr;
+  m_size = 0;
+}
+
+const glm::vec3 *PointCache::frame(unsigned int _frame)
+{
+  if(m_decoder) return m_decoder->decode(_frame);
+  if(m_data == nullptr || m_header.numFrames == 0) return nullptr;
+  if(_frame >= m_header.numFrames) _frame = m_header.numFrames - 1;
+  return reinterpret_cast<const glm::vec3*>(m_data + sizeof(PointCacheHeader) + m_frameSize * _frame);
+}
+
+void PointCache::pageRange(unsigned int _first, unsigned int _count, char *&o_start, size_t &o_length) const
+{
+  size_t begin, end;
+  if(m_decoder)
+  {
+    m_decoder->byteRange(_first, _count, begin, end);
+  }
+  else
+  {
+    begin = sizeof(PointCacheHeader) + m_frameSize * _first;
+    end = begin + m_frameSize * _count;
+  }
+  if(end > m_size) end = m_size;
+  // madvise wants a page aligned start address
+  size_t alignedBegin = begin - (begin % m_pageSize);
+  o_start = m_data + alignedBegin;
+  o_length = end > alignedBegin ? end - alignedBegin : 0;
+}
+
+void PointCache::prefetch(unsigned int _first, unsigned int _count) const
+{
+  if(m_data == nullptr || _first >= numFrames()) return;
+  if(_first + _count > numFrames()) _count = numFrames() - _first;
+  char *start; size_t length;
+  pageRange(_first, _count, start, length);
+  if(length) madvise(start, length, MADV_WILLNEED);
+}
+
+void PointCache::release(unsigned int _frame) const
+{
+  if(m_data == nullptr || _frame == 0) return;
+  if(_frame > numFrames()) _frame = numFrames();
+  char *start; size_t length;
+  pageRange(0, _frame, start, length);
+  // Only drop whole pages that lie entirely before the requested frame
+  length -= length % m_pageSize;
+  if(length) madvise(start, length, MADV_DONTNEED);
+}
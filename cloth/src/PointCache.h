@@ -0,0 +1,92 @@
+#ifndef PointCache_H
+#define PointCache_H
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <stdio.h>
+#include "PointCacheCodec.h"
+
+/// A point cache is a flat binary file: a PointCacheHeader followed by numFrames
+/// tightly packed arrays of numPoints glm::vec3 positions. The fixed layout means
+/// a frame is found by arithmetic alone, so playback never has to parse anything.
+struct PointCacheHeader
+{
+  char magic[4];
+  unsigned int version;
+  unsigned int numPoints;
+  unsigned int numFrames;
+  float frameRate;
+  unsigned int reserved[3];
+};
+
+/// Appends simulated frames to a point cache on disk, either raw or compressed
+class PointCacheWriter
+{
+public:
+  PointCacheWriter() {}
+  ~PointCacheWriter();
+
+  /// Create the file and write a header with no frames in it yet. Passing codec
+  /// settings writes a compressed cache instead of raw positions.
+  bool open(const std::string &_path, unsigned int _numPoints, float _frameRate = 60.0f,
+            const PointCodecSettings *_compression = nullptr);
+
+  /// Append one frame of numPoints positions
+  bool writeFrame(const glm::vec3 *_positions);
+
+  /// Patch the frame count into the header and close the file
+  void close();
+
+  bool isOpen() const {return m_file != nullptr || m_encoder;}
+
+private:
+  FILE *m_file = nullptr;
+  PointCacheHeader m_header;
+  std::unique_ptr<PointCacheEncoder> m_encoder;
+};
+
+/// Read only, memory mapped view of a point cache. Raw frames are handed out as
+/// pointers straight into the mapping so they can go to glBufferSubData as is,
+/// compressed frames are decoded into a buffer owned by the cache.
+class PointCache
+{
+public:
+  PointCache() {}
+  ~PointCache();
+
+  /// Map the file into memory, returns false if it isn't a valid cache
+  bool open(const std::string &_path);
+
+  /// Unmap the file
+  void close();
+
+  bool isOpen() const {return m_data != nullptr;}
+
+  unsigned int numFrames() const {return m_decoder ? m_decoder->numFrames() : m_header.numFrames;}
+  unsigned int numPoints() const {return m_decoder ? m_decoder->numPoints() : m_header.numPoints;}
+  float frameRate() const {return m_decoder ? m_decoder->frameRate() : m_header.frameRate;}
+
+  /// Pointer to the positions of frame _frame (clamped to the last frame), null if a
+  /// compressed frame is damaged
+  const glm::vec3 *frame(unsigned int _frame);
+
+  /// Ask the kernel to start paging in _count frames from _first onwards
+  void prefetch(unsigned int _first, unsigned int _count) const;
+
+  /// Tell the kernel frames before _frame aren't needed any more
+  void release(unsigned int _frame) const;
+
+private:
+  /// Byte range of _count frames from _first, widened to whole pages
+  void pageRange(unsigned int _first, unsigned int _count, char *&o_start, size_t &o_length) const;
+
+  PointCacheHeader m_header;
+  std::unique_ptr<PointCacheDecoder> m_decoder;
+  char *m_data = nullptr;
+  size_t m_size = 0;
+  size_t m_frameSize = 0;
+  size_t m_pageSize = 4096;
+};
+
+#endif // PointCache_H
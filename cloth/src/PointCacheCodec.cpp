@@ -0,0 +1,578 @@
+#include "PointCacheCodec.h"
+
+#include <string.h>
+#include <math.h>
+#include <iostream>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const char s_codecMagic[4] = {'C','P','Z','1'};
+static const uint32_t s_codecVersion = 2;
+
+/// Residuals are Rice coded in blocks of this many values, each with its own parameter
+static const unsigned int s_riceBlock = 64;
+
+/// Quotients this long or longer are escaped and the value is written raw
+static const unsigned int s_riceEscape = 24;
+
+//------------------------------ BIT STREAMS ---------------------------------
+
+class BitWriter
+{
+public:
+  explicit BitWriter(std::vector<uint8_t> &_bytes) : m_bytes(_bytes) {}
+
+  /// Append the low _n (<=32) bits of _value, least significant first
+  void put(uint32_t _value, unsigned int _n)
+  {
+    m_acc |= uint64_t(_value) << m_count;
+    m_count += _n;
+    while(m_count >= 8)
+    {
+      m_bytes.push_back(uint8_t(m_acc & 0xff));
+      m_acc >>= 8;
+      m_count -= 8;
+    }
+  }
+
+  void putOnes(unsigned int _n)
+  {
+    while(_n > 0)
+    {
+      unsigned int c = _n < 24 ? _n : 24;
+      put((1u << c) - 1, c);
+      _n -= c;
+    }
+  }
+
+  /// Flush the partial byte and pad so the reader can always refill 64 bits
+  void finish()
+  {
+    if(m_count) m_bytes.push_back(uint8_t(m_acc & 0xff));
+    m_acc = 0; m_count = 0;
+    m_bytes.insert(m_bytes.end(), 8, 0);
+  }
+
+private:
+  std::vector<uint8_t> &m_bytes;
+  uint64_t m_acc = 0;
+  unsigned int m_count = 0;
+};
+
+/// Reads a stream by absolute bit position. Every read is a single unaligned 64 bit
+/// load, so reads don't depend on each other and a block's worth of them can all be
+/// in flight at once. The stream is little endian and the writer's padding keeps the
+/// loads of a valid stream in bounds; anything read from the file has to check
+/// fits() first.
+class BitReader
+{
+public:
+  BitReader(const uint8_t *_data, size_t _bytes) : m_data(_data), m_bytes(_bytes) {}
+
+  /// Whether the window at _pos, and every one before it, is inside the stream
+  bool fits(size_t _pos) const {return (_pos >> 3) + sizeof(uint64_t) <= m_bytes;}
+
+  /// At least 57 bits starting at _pos
+  uint64_t window(size_t _pos) const
+  {
+    uint64_t word;
+    memcpy(&word, m_data + (_pos >> 3), sizeof(uint64_t));
+    return word >> (_pos & 7);
+  }
+
+  /// _n (<=32) bits starting at _pos
+  uint32_t get(size_t _pos, unsigned int _n) const
+  {
+    return uint32_t(window(_pos) & ((uint64_t(1) << _n) - 1));
+  }
+
+private:
+  const uint8_t *m_data;
+  size_t m_bytes;
+};
+
+static inline uint32_t zigzag(int32_t _v) {return (uint32_t(_v) << 1) ^ uint32_t(_v >> 31);}
+static inline int32_t unzigzag(uint32_t _v) {return int32_t(_v >> 1) ^ -int32_t(_v & 1);}
+
+// A block of up to s_riceBlock residuals is laid out as its 5 bit parameter k, then
+// the unary quotients of every residual (q ones and a zero, q == s_riceEscape for an
+// escape), then the low k bits of every residual, then the high bits of the escaped
+// ones in _rawBits - k bits each. Keeping the fixed width remainders apart from the
+// variable length quotients lets the decoder find all the quotients with one pass of
+// bit scans and then pull out every remainder independently.
+
+static void riceEncode(const int32_t *_residuals, size_t _n, unsigned int _rawBits, std::vector<uint8_t> &o_bytes)
+{
+  BitWriter writer(o_bytes);
+  uint32_t zz[s_riceBlock];
+  for(size_t start = 0; start < _n; start += s_riceBlock)
+  {
+    size_t count = _n - start < s_riceBlock ? _n - start : s_riceBlock;
+    for(size_t i = 0; i < count; ++i) zz[i] = zigzag(_residuals[start + i]);
+
+    // Pick the parameter that gives the shortest block
+    unsigned int bestK = 0;
+    size_t bestCost = ~size_t(0);
+    for(unsigned int k = 0; k <= _rawBits; ++k)
+    {
+      size_t cost = 0;
+      for(size_t i = 0; i < count; ++i)
+      {
+        uint32_t q = zz[i] >> k;
+        cost += q < s_riceEscape ? q + 1 + k : s_riceEscape + 1 + _rawBits;
+      }
+      if(cost < bestCost) {bestCost = cost; bestK = k;}
+    }
+
+    writer.put(bestK, 5);
+    for(size_t i = 0; i < count; ++i)
+    {
+      uint32_t q = zz[i] >> bestK;
+      q = q < s_riceEscape ? q : s_riceEscape;
+      writer.put((1u << q) - 1, q + 1);
+    }
+    for(size_t i = 0; i < count; ++i) writer.put(zz[i] & ((1u << bestK) - 1), bestK);
+    for(size_t i = 0; i < count; ++i)
+    {
+      if((zz[i] >> bestK) >= s_riceEscape) writer.put(zz[i] >> bestK, _rawBits - bestK);
+    }
+  }
+  writer.finish();
+}
+
+/// For every byte, the positions of its zero bits (padded with anything), and how many
+/// there are. The quotients are read a byte at a time through these.
+struct ZeroBitTable
+{
+  uint8_t positions[256][8];
+  uint8_t count[256];
+
+  ZeroBitTable()
+  {
+    for(unsigned int byte = 0; byte < 256; ++byte)
+    {
+      count[byte] = 0;
+      for(unsigned int bit = 0; bit < 8; ++bit)
+      {
+        positions[byte][bit] = 0;
+        if(!(byte & (1u << bit))) positions[byte][count[byte]++] = uint8_t(bit);
+      }
+    }
+  }
+};
+static const ZeroBitTable s_zeroBits;
+
+/// Write the positions of the zero bits of _byte, offset by _base, to o_positions and
+/// return how many there are. Always writes 8, whatever is past the count is garbage.
+static inline unsigned int zeroBitPositions(unsigned int _byte, uint32_t _base, uint32_t *o_positions)
+{
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(s_zeroBits.positions[_byte]));
+  __m128i words = _mm_unpacklo_epi8(bytes, zero);
+  __m128i base = _mm_set1_epi32(int(_base));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(o_positions), _mm_add_epi32(_mm_unpacklo_epi16(words, zero), base));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(o_positions + 4), _mm_add_epi32(_mm_unpackhi_epi16(words, zero), base));
+#else
+  for(int i = 0; i < 8; ++i) o_positions[i] = _base + s_zeroBits.positions[_byte][i];
+#endif
+  return s_zeroBits.count[_byte];
+}
+
+/// Decode _n residuals, a whole number of blocks unless they run to the end of the
+/// frame, from the _bytes long stream at _data starting at bit io_pos, and move
+/// io_pos past them. Returns false without reading past the stream if it's corrupt.
+static bool riceDecode(const uint8_t *_data, size_t _bytes, size_t &io_pos, size_t _n, unsigned int _rawBits, int32_t *o_residuals)
+{
+  BitReader reader(_data, _bytes);
+  size_t pos = io_pos;
+  // The zeros are stored from 1, with a zero just before the block at 0. There is
+  // room for a whole window of zeros past the last code and the 8 wide writes.
+  uint32_t zeros[s_riceBlock + 72];
+  uint32_t v[s_riceBlock + 1];
+  zeros[0] = ~uint32_t(0);
+  for(size_t start = 0; start < _n; start += s_riceBlock)
+  {
+    size_t count = _n - start < s_riceBlock ? _n - start : s_riceBlock;
+    if(!reader.fits(pos)) return false;
+    unsigned int k = reader.get(pos, 5);
+    pos += 5;
+    // The encoder never picks more than the raw width, which is at most 21 bits
+    if(k > _rawBits) return false;
+
+    // Each zero in the stream ends a quotient, so the quotients are the gaps between
+    // zeros. Find the zeros a byte at a time without branching on the codes, until
+    // there is one for every residual. A valid stream always has them before its end,
+    // quotients never run past s_riceEscape.
+    size_t found = 0;
+    for(uint32_t scan = 0; found < count; scan += 56)
+    {
+      if(!reader.fits(pos + scan)) return false;
+      uint64_t window = reader.window(pos + scan);
+      for(unsigned int b = 0; b < 56; b += 8) found += zeroBitPositions(unsigned(window >> b) & 0xff, scan + b, zeros + 1 + found);
+    }
+    pos += zeros[count] + 1;
+
+    // Every remainder sits at a known position, so the loads are all independent.
+    // Two remainders always fit in one load, k being at most 21.
+    if(!reader.fits(pos + count*k)) return false;
+    uint32_t remainder[s_riceBlock + 1];
+    const uint32_t mask = (uint32_t(1) << k) - 1;
+    for(size_t i = 0; i < count; i += 2)
+    {
+      uint64_t window = reader.window(pos + i*k);
+      remainder[i] = uint32_t(window) & mask;
+      remainder[i+1] = uint32_t(window >> k) & mask;
+    }
+    pos += count*k;
+
+    // Put the quotients and remainders back together
+    size_t i = 0;
+    bool escaped = false;
+#if defined(__SSE2__)
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i escape = _mm_set1_epi32(int(s_riceEscape) - 1);
+    const __m128i shift = _mm_cvtsi32_si128(int(k));
+    __m128i anyEscaped = _mm_setzero_si128();
+    for(; i + 4 <= count; i += 4)
+    {
+      __m128i q = _mm_sub_epi32(_mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(zeros + i + 1)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(zeros + i))), one);
+      anyEscaped = _mm_or_si128(anyEscaped, _mm_cmpgt_epi32(q, escape));
+      __m128i zz = _mm_or_si128(_mm_sll_epi32(q, shift), _mm_loadu_si128(reinterpret_cast<const __m128i*>(remainder + i)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i), zz);
+    }
+    escaped = _mm_movemask_epi8(anyEscaped) != 0;
+#endif
+    for(; i < count; ++i)
+    {
+      uint32_t q = zeros[i+1] - zeros[i] - 1;
+      escaped |= q >= s_riceEscape;
+      v[i] = (q << k) | remainder[i];
+    }
+
+    if(escaped)
+    {
+      unsigned int highBits = _rawBits - k;
+      for(i = 0; i < count; ++i)
+      {
+        if((v[i] >> k) < s_riceEscape) continue;
+        if(!reader.fits(pos)) return false;
+        v[i] = (reader.get(pos, highBits) << k) | (v[i] & mask);
+        pos += highBits;
+      }
+    }
+
+    int32_t *out = o_residuals + start;
+    i = 0;
+#if defined(__SSE2__)
+    for(; i + 4 <= count; i += 4)
+    {
+      __m128i zz = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+      __m128i sign = _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(zz, one));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(_mm_srli_epi32(zz, 1), sign));
+    }
+#endif
+    for(; i < count; ++i) out[i] = unzigzag(v[i]);
+  }
+  io_pos = pos;
+  return true;
+}
+
+//------------------------------ QUANTISATION --------------------------------
+// The encoder and decoder must agree bit for bit on the predicted values, so both
+// go through these two functions. The SSE and scalar paths do the same IEEE
+// operations in the same order and round to nearest even, so they agree too.
+
+/// Quantise the predicted frame (previous frame, or Verlet extrapolation of the last two)
+/// onto the current frame's grid
+static void predictQuantized(const float *_p1, const float *_p0, size_t _n, const FrameQuantization &_fq,
+                             int32_t _maxQ, bool _verlet, int32_t *o_q)
+{
+  size_t k = 0;
+  const float maxQ = float(_maxQ);
+#if defined(__SSE2__)
+  // xyz repeats every 3 floats, so walk 12 floats (3 registers) at a time
+  const __m128 lower[3] = {_mm_setr_ps(_fq.lower[0],_fq.lower[1],_fq.lower[2],_fq.lower[0]),
+                           _mm_setr_ps(_fq.lower[1],_fq.lower[2],_fq.lower[0],_fq.lower[1]),
+                           _mm_setr_ps(_fq.lower[2],_fq.lower[0],_fq.lower[1],_fq.lower[2])};
+  const __m128 inv[3] = {_mm_setr_ps(_fq.invStep[0],_fq.invStep[1],_fq.invStep[2],_fq.invStep[0]),
+                         _mm_setr_ps(_fq.invStep[1],_fq.invStep[2],_fq.invStep[0],_fq.invStep[1]),
+                         _mm_setr_ps(_fq.invStep[2],_fq.invStep[0],_fq.invStep[1],_fq.invStep[2])};
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 top = _mm_set1_ps(maxQ);
+  for(; k + 12 <= _n; k += 12)
+  {
+    for(int j = 0; j < 3; ++j)
+    {
+      __m128 pred = _mm_loadu_ps(_p1 + k + 4*j);
+      if(_verlet) pred = _mm_add_ps(pred, _mm_sub_ps(pred, _mm_loadu_ps(_p0 + k + 4*j)));
+      __m128 t = _mm_mul_ps(_mm_sub_ps(pred, lower[j]), inv[j]);
+      t = _mm_min_ps(_mm_max_ps(t, zero), top);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(o_q + k + 4*j), _mm_cvtps_epi32(t));
+    }
+  }
+#endif
+  for(; k < _n; ++k)
+  {
+    size_t c = k % 3;
+    float pred = _p1[k];
+    if(_verlet) pred = pred + (pred - _p0[k]);
+    float t = (pred - _fq.lower[c]) * _fq.invStep[c];
+    t = t > 0.0f ? t : 0.0f;
+    t = t < maxQ ? t : maxQ;
+    o_q[k] = int32_t(lrintf(t));
+  }
+}
+
+/// Map quantised values back to positions
+static void dequantize(const int32_t *_q, size_t _n, const FrameQuantization &_fq, float *o_p)
+{
+  size_t k = 0;
+#if defined(__SSE2__)
+  const __m128 lower[3] = {_mm_setr_ps(_fq.lower[0],_fq.lower[1],_fq.lower[2],_fq.lower[0]),
+                           _mm_setr_ps(_fq.lower[1],_fq.lower[2],_fq.lower[0],_fq.lower[1]),
+                           _mm_setr_ps(_fq.lower[2],_fq.lower[0],_fq.lower[1],_fq.lower[2])};
+  const __m128 step[3] = {_mm_setr_ps(_fq.step[0],_fq.step[1],_fq.step[2],_fq.step[0]),
+                          _mm_setr_ps(_fq.step[1],_fq.step[2],_fq.step[0],_fq.step[1]),
+                          _mm_setr_ps(_fq.step[2],_fq.step[0],_fq.step[1],_fq.step[2])};
+  for(; k + 12 <= _n; k += 12)
+  {
+    for(int j = 0; j < 3; ++j)
+    {
+      __m128 q = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(_q + k + 4*j)));
+      _mm_storeu_ps(o_p + k + 4*j, _mm_add_ps(lower[j], _mm_mul_ps(q, step[j])));
+    }
+  }
+#endif
+  for(; k < _n; ++k)
+  {
+    size_t c = k % 3;
+    o_p[k] = _fq.lower[c] + float(_q[k]) * _fq.step[c];
+  }
+}
+
+//------------------------------ ENCODER -------------------------------------
+
+PointCacheEncoder::~PointCacheEncoder()
+{
+  close();
+}
+
+bool PointCacheEncoder::open(const std::string &_path, unsigned int _numPoints, float _frameRate, const PointCodecSettings &_settings)
+{
+  close();
+  if(_settings.bits < 1 || _settings.bits > 20 || _settings.keyInterval < 1)
+  {
+    std::cerr<<"PointCacheEncoder: unsupported settings ("<<_settings.bits<<" bits, key interval "<<_settings.keyInterval<<")\n";
+    return false;
+  }
+  m_file = fopen(_path.c_str(), "wb");
+  if(m_file == nullptr)
+  {
+    std::cerr<<"PointCacheEncoder: could not open "<<_path<<" for writing\n";
+    return false;
+  }
+  memset(&m_header, 0, sizeof(CompressedPointCacheHeader));
+  memcpy(m_header.magic, s_codecMagic, 4);
+  m_header.version = s_codecVersion;
+  m_header.numPoints = _numPoints;
+  m_header.frameRate = _frameRate;
+  m_header.bits = _settings.bits;
+  m_header.predictor = _settings.predictor;
+  m_header.keyInterval = _settings.keyInterval;
+
+  size_t n = size_t(_numPoints) * 3;
+  m_history[0].assign(n, 0.0f);
+  m_history[1].assign(n, 0.0f);
+  m_quantized.resize(n);
+  m_predicted.resize(n);
+  m_residuals.resize(n);
+  m_offsets.clear();
+
+  m_position = sizeof(CompressedPointCacheHeader);
+  return fwrite(&m_header, sizeof(CompressedPointCacheHeader), 1, m_file) == 1;
+}
+
+bool PointCacheEncoder::writeFrame(const glm::vec3 *_positions)
+{
+  if(m_file == nullptr) return false;
+  const float *p = reinterpret_cast<const float*>(_positions);
+  size_t n = size_t(m_header.numPoints) * 3;
+  int32_t maxQ = (int32_t(1) << m_header.bits) - 1;
+
+  //---------------------- QUANTISE TO THIS FRAME'S BOX ------------------------
+  FrameQuantization fq;
+  for(size_t c = 0; c < 3; ++c)
+  {
+    float lo = n ? p[c] : 0.0f, hi = lo;
+    for(size_t k = c; k < n; k += 3)
+    {
+      lo = p[k] < lo ? p[k] : lo;
+      hi = p[k] > hi ? p[k] : hi;
+    }
+    float range = hi - lo;
+    fq.lower[c] = lo;
+    fq.step[c] = range > 0.0f ? range / float(maxQ) : 1.0f;
+    fq.invStep[c] = range > 0.0f ? float(maxQ) / range : 0.0f;
+  }
+  for(size_t k = 0; k < n; ++k)
+  {
+    size_t c = k % 3;
+    long q = lrintf((p[k] - fq.lower[c]) * fq.invStep[c]);
+    m_quantized[k] = int32_t(q < 0 ? 0 : (q > maxQ ? maxQ : q));
+  }
+
+  //---------------------- PREDICT AND TAKE RESIDUALS --------------------------
+  unsigned int sinceKey = m_header.numFrames % m_header.keyInterval;
+  fq.isKey = sinceKey == 0;
+  if(fq.isKey)
+  {
+    for(size_t k = 0; k < n; ++k) m_residuals[k] = m_quantized[k] - (k >= 3 ? m_quantized[k-3] : 0);
+  }
+  else
+  {
+    bool verlet = m_header.predictor == PREDICT_VERLET && sinceKey >= 2;
+    predictQuantized(&m_history[0][0], &m_history[1][0], n, fq, maxQ, verlet, &m_predicted[0]);
+    for(size_t k = 0; k < n; ++k) m_residuals[k] = m_quantized[k] - m_predicted[k];
+  }
+
+  m_bytes.clear();
+  riceEncode(&m_residuals[0], n, m_header.bits + 1, m_bytes);
+
+  m_offsets.push_back(m_position);
+  if(fwrite(&fq, sizeof(FrameQuantization), 1, m_file) != 1) return false;
+  if(fwrite(&m_bytes[0], 1, m_bytes.size(), m_file) != m_bytes.size()) return false;
+  m_position += sizeof(FrameQuantization) + m_bytes.size();
+  ++m_header.numFrames;
+
+  // Predict the next frame from what the decoder will see, not from the originals
+  m_history[0].swap(m_history[1]);
+  dequantize(&m_quantized[0], n, fq, &m_history[0][0]);
+  return true;
+}
+
+void PointCacheEncoder::close()
+{
+  if(m_file == nullptr) return;
+
+  // Keep the offset table 8 byte aligned so it can be read in place from a mapping
+  static const char padding[8] = {0};
+  size_t pad = (8 - m_position % 8) % 8;
+  fwrite(padding, 1, pad, m_file);
+  m_position += pad;
+
+  m_header.tableOffset = m_position;
+  m_offsets.push_back(m_position);
+  fwrite(&m_offsets[0], sizeof(uint64_t), m_offsets.size(), m_file);
+
+  fseek(m_file, 0, SEEK_SET);
+  fwrite(&m_header, sizeof(CompressedPointCacheHeader), 1, m_file);
+  fclose(m_file);
+  m_file = nullptr;
+}
+
+//------------------------------ DECODER -------------------------------------
+
+bool PointCacheDecoder::open(const char *_data, size_t _size)
+{
+  m_data = nullptr;
+  m_lastFrame = ~0u;
+  if(_size < sizeof(CompressedPointCacheHeader)) return false;
+  memcpy(&m_header, _data, sizeof(CompressedPointCacheHeader));
+  if(memcmp(m_header.magic, s_codecMagic, 4) != 0 || m_header.version != s_codecVersion) return false;
+  if(m_header.bits < 1 || m_header.bits > 20 || m_header.keyInterval < 1) return false;
+  if(m_header.tableOffset % 8 != 0 ||
+     m_header.tableOffset + (uint64_t(m_header.numFrames) + 1) * sizeof(uint64_t) > _size) return false;
+
+  m_offsets = reinterpret_cast<const uint64_t*>(_data + m_header.tableOffset);
+  for(unsigned int f = 0; f < m_header.numFrames; ++f)
+  {
+    if(m_offsets[f] + sizeof(FrameQuantization) > m_offsets[f+1] || m_offsets[f+1] > m_header.tableOffset) return false;
+  }
+
+  m_data = _data;
+  m_size = _size;
+  size_t n = size_t(m_header.numPoints) * 3;
+  m_history[0].assign(n, 0.0f);
+  m_history[1].assign(n, 0.0f);
+  return true;
+}
+
+const glm::vec3 *PointCacheDecoder::decode(unsigned int _frame)
+{
+  if(m_data == nullptr || m_header.numFrames == 0) return nullptr;
+  if(_frame >= m_header.numFrames) _frame = m_header.numFrames - 1;
+  if(_frame != m_lastFrame)
+  {
+    // Carry on from the last frame if we can, otherwise restart at the keyframe
+    unsigned int key = _frame - _frame % m_header.keyInterval;
+    unsigned int start = (m_lastFrame != ~0u && m_lastFrame >= key && m_lastFrame < _frame) ? m_lastFrame + 1 : key;
+    for(unsigned int f = start; f <= _frame; ++f)
+    {
+      if(!decodeFrame(f))
+      {
+        std::cerr<<"PointCacheDecoder: frame "<<f<<" is damaged\n";
+        m_lastFrame = ~0u;
+        return nullptr;
+      }
+    }
+    m_lastFrame = _frame;
+  }
+  return reinterpret_cast<const glm::vec3*>(&m_history[0][0]);
+}
+
+bool PointCacheDecoder::decodeFrame(unsigned int _frame)
+{
+  size_t n = size_t(m_header.numPoints) * 3;
+  int32_t maxQ = (int32_t(1) << m_header.bits) - 1;
+  FrameQuantization fq;
+  memcpy(&fq, m_data + m_offsets[_frame], sizeof(FrameQuantization));
+  // open() checked the offsets, so the stream runs up to the next frame (or the table)
+  const uint8_t *bits = reinterpret_cast<const uint8_t*>(m_data + m_offsets[_frame] + sizeof(FrameQuantization));
+  size_t bytes = size_t(m_offsets[_frame+1] - m_offsets[_frame]) - sizeof(FrameQuantization);
+
+  // Decode, predict and dequantise a few blocks at a time so the residuals never leave
+  // the cache. Chunks are whole points so the SSE kernels always start on an x.
+  static const size_t s_chunk = 3*s_riceBlock;
+  int32_t residuals[s_chunk];
+  int32_t predicted[s_chunk];
+  unsigned int sinceKey = _frame % m_header.keyInterval;
+  bool verlet = m_header.predictor == PREDICT_VERLET && sinceKey >= 2;
+  const float *p1 = &m_history[0][0];
+  const float *p0 = &m_history[1][0];
+  // The new frame replaces the oldest one, each chunk once its prediction has read it
+  float *out = &m_history[1][0];
+  size_t pos = 0;
+  int32_t previous[3] = {0, 0, 0};
+  for(size_t start = 0; start < n; start += s_chunk)
+  {
+    size_t count = n - start < s_chunk ? n - start : s_chunk;
+    // Half a frame in the oldest history is harmless, the next decode restarts at a key
+    if(!riceDecode(bits, bytes, pos, count, m_header.bits + 1, residuals)) return false;
+    if(fq.isKey)
+    {
+      for(size_t k = 0; k < 3; ++k) residuals[k] += previous[k];
+      for(size_t k = 3; k < count; ++k) residuals[k] += residuals[k-3];
+      for(size_t k = 0; k < 3; ++k) previous[k] = residuals[count - 3 + k];
+    }
+    else
+    {
+      predictQuantized(p1 + start, p0 + start, count, fq, maxQ, verlet, predicted);
+      for(size_t k = 0; k < count; ++k) residuals[k] += predicted[k];
+    }
+    dequantize(residuals, count, fq, out + start);
+  }
+  m_history[0].swap(m_history[1]);
+  return true;
+}
+
+void PointCacheDecoder::byteRange(unsigned int _first, unsigned int _count, size_t &o_begin, size_t &o_end) const
+{
+  o_begin = o_end = 0;
+  if(m_data == nullptr || _first >= m_header.numFrames) return;
+  unsigned int last = _first + _count < m_header.numFrames ? _first + _count : m_header.numFrames;
+  o_begin = size_t(m_offsets[_first]);
+  o_end = size_t(m_offsets[last]);
+}
@@ -0,0 +1,114 @@
+#ifndef PointCacheCodec_H
+#define PointCacheCodec_H
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/// How a frame is predicted from the frames decoded before it. Keyframes are
+/// always predicted from the previous point in the same frame so playback can
+/// start from them without any history.
+enum PointCachePredictor {PREDICT_PREVIOUS, PREDICT_VERLET};
+
+/// User facing knobs for compressed point caches
+struct PointCodecSettings
+{
+  /// Quantisation bits per component, relative to the frame's bounding box (1-20)
+  unsigned int bits = 16;
+  PointCachePredictor predictor = PREDICT_VERLET;
+  /// Every keyInterval frames a frame is coded without temporal prediction so
+  /// scrubbing never has to decode more than this many frames
+  unsigned int keyInterval = 30;
+};
+
+/// Header of a compressed point cache. The frame offset table (numFrames+1
+/// uint64s, the last being the table itself) lives at tableOffset.
+struct CompressedPointCacheHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t numPoints;
+  uint32_t numFrames;
+  float frameRate;
+  uint32_t bits;
+  uint32_t predictor;
+  uint32_t keyInterval;
+  uint64_t tableOffset;
+};
+
+/// Per frame, per axis quantisation grid. Both the step and its inverse are
+/// stored so the encoder and decoder do bit identical arithmetic.
+struct FrameQuantization
+{
+  float lower[3];
+  float step[3];
+  float invStep[3];
+  uint32_t isKey;
+};
+
+/// Writes compressed point caches: each frame is quantised to its own bounding
+/// box, predicted from the reconstructed previous frame(s) and the residuals
+/// are Rice coded in blocks with an adaptive parameter.
+class PointCacheEncoder
+{
+public:
+  PointCacheEncoder() {}
+  ~PointCacheEncoder();
+
+  bool open(const std::string &_path, unsigned int _numPoints, float _frameRate, const PointCodecSettings &_settings);
+  bool writeFrame(const glm::vec3 *_positions);
+  void close();
+
+  bool isOpen() const {return m_file != nullptr;}
+
+private:
+  FILE *m_file = nullptr;
+  CompressedPointCacheHeader m_header;
+  std::vector<uint64_t> m_offsets;
+  uint64_t m_position = 0;
+
+  /// Reconstructed (not original) positions of the last two frames, newest first
+  std::vector<float> m_history[2];
+  std::vector<int32_t> m_quantized;
+  std::vector<int32_t> m_predicted;
+  std::vector<int32_t> m_residuals;
+  std::vector<uint8_t> m_bytes;
+};
+
+/// Decodes frames from a compressed point cache held in memory (normally a mmap).
+/// Sequential playback decodes one frame per call, a random jump decodes from
+/// the keyframe before it.
+class PointCacheDecoder
+{
+public:
+  /// Check the header and offset table, returns false if the data isn't a valid cache
+  bool open(const char *_data, size_t _size);
+
+  unsigned int numFrames() const {return m_header.numFrames;}
+  unsigned int numPoints() const {return m_header.numPoints;}
+  float frameRate() const {return m_header.frameRate;}
+
+  /// Decode frame _frame, the pointer stays valid until the next call. Null if the
+  /// frame, or one it's predicted from, is damaged.
+  const glm::vec3 *decode(unsigned int _frame);
+
+  /// Byte range in the file covering _count frames from _first
+  void byteRange(unsigned int _first, unsigned int _count, size_t &o_begin, size_t &o_end) const;
+
+private:
+  /// Decode _frame on top of the history, false if its stream is corrupt
+  bool decodeFrame(unsigned int _frame);
+
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+  CompressedPointCacheHeader m_header;
+  const uint64_t *m_offsets = nullptr;
+
+  /// The last decoded frame, or ~0 if none
+  unsigned int m_lastFrame = ~0u;
+  std::vector<float> m_history[2];
+};
+
+#endif // PointCacheCodec_H
@@ -0,0 +1,262 @@
+#include "ShaderPrograms.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+// Same value for the KHR and ARB flavours of the extension
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+static const char s_programCacheMagic[4] = {'P','R','G','B'};
+static const uint32_t s_programCacheVersion = 1;
+
+namespace
+{
+  /// 64 bit FNV-1a, chained through _hash
+  uint64_t hashBytes(const std::string &_bytes, uint64_t _hash = 14695981039346656037ULL)
+  {
+    for(char c : _bytes)
+    {
+      _hash ^= uint64_t(uint8_t(c));
+      _hash *= 1099511628211ULL;
+    }
+    return _hash;
+  }
+
+  std::string glString(GLenum _name)
+  {
+    const char *string = reinterpret_cast<const char *>(glGetString(_name));
+    return string ? std::string(string) : std::string();
+  }
+
+  bool readFile(const std::string &_path, std::string &o_text)
+  {
+    std::ifstream file(_path.c_str());
+    if(!file)
+    {
+      std::cerr<<"ShaderPrograms: can't open "<<_path<<"\n";
+      return false;
+    }
+    std::stringstream text;
+    text<<file.rdbuf();
+    o_text = text.str();
+    return true;
+  }
+
+  GLuint compile(GLenum _type, const std::string &_source)
+  {
+    GLuint shader = glCreateShader(_type);
+    const GLchar *source = _source.c_str();
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    return shader;
+  }
+
+  void printLog(const std::string &_what, GLuint _id, bool _isProgram)
+  {
+    GLint length = 0;
+    if(_isProgram) glGetProgramiv(_id, GL_INFO_LOG_LENGTH, &length);
+    else glGetShaderiv(_id, GL_INFO_LOG_LENGTH, &length);
+    std::string log(size_t(length > 0 ? length : 1), '\0');
+    if(_isProgram) glGetProgramInfoLog(_id, GLsizei(log.size()), nullptr, &log[0]);
+    else glGetShaderInfoLog(_id, GLsizei(log.size()), nullptr, &log[0]);
+    std::cerr<<"ShaderPrograms: "<<_what<<" failed\n"<<log.c_str()<<"\n";
+  }
+}
+
+void ShaderPrograms::init(const std::string &_cacheDirectory)
+{
+  // The thread count defaults to the driver's maximum, so finding it is all there is to do
+  m_parallel = false;
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for(GLint i=0; i<count; ++i)
+  {
+    const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+    if(extension && (strcmp(extension, "GL_KHR_parallel_shader_compile") == 0 ||
+                     strcmp(extension, "GL_ARB_parallel_shader_compile") == 0)) m_parallel = true;
+  }
+
+  // A driver with no binary formats can't give us anything worth keeping
+  m_cacheDirectory.clear();
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if(_cacheDirectory.empty() || formats <= 0) return;
+  if(mkdir(_cacheDirectory.c_str(), 0755) != 0 && access(_cacheDirectory.c_str(), W_OK) != 0)
+  {
+    std::cerr<<"ShaderPrograms: can't use "<<_cacheDirectory<<", shaders will be compiled every run\n";
+    return;
+  }
+  m_cacheDirectory = _cacheDirectory;
+  m_driver = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+}
+
+bool ShaderPrograms::request(const std::string &_name, const std::string &_vertPath, const std::string &_fragPath)
+{
+  std::string vertex, fragment;
+  if(!readFile(_vertPath, vertex) || !readFile(_fragPath, fragment)) return false;
+
+  Program program;
+  program.name = _name;
+  program.id = glCreateProgram();
+  program.shaders[0] = program.shaders[1] = 0;
+  program.checked = false;
+  program.linked = false;
+  program.key = hashBytes(fragment, hashBytes(vertex + '\0', hashBytes(m_driver + '\0')));
+  if(loadBinary(program))
+  {
+    program.checked = true;
+    program.linked = true;
+    m_programs.push_back(program);
+    return true;
+  }
+
+  // No status queries here, any of them would make the driver finish the compile first
+  program.shaders[0] = compile(GL_VERTEX_SHADER, vertex);
+  program.shaders[1] = compile(GL_FRAGMENT_SHADER, fragment);
+  glAttachShader(program.id, program.shaders[0]);
+  glAttachShader(program.id, program.shaders[1]);
+  if(!m_cacheDirectory.empty()) glProgramParameteri(program.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glLinkProgram(program.id);
+  m_programs.push_back(program);
+  return true;
+}
+
+bool ShaderPrograms::ready(const std::string &_name) const
+{
+  int index = find(_name);
+  if(index < 0) return false;
+  const Program *program = &m_programs[size_t(index)];
+  if(program->checked || !m_parallel) return true;
+  GLint done = GL_FALSE;
+  glGetProgramiv(program->id, GL_COMPLETION_STATUS_KHR, &done);
+  return done == GL_TRUE;
+}
+
+GLuint ShaderPrograms::program(const std::string &_name)
+{
+  int index = find(_name);
+  if(index < 0) return 0;
+  Program &program = m_programs[size_t(index)];
+  if(!program.checked) finish(program);
+  return program.linked ? program.id : 0;
+}
+
+void ShaderPrograms::update()
+{
+  if(!m_parallel) return;
+  for(Program &program : m_programs)
+  {
+    if(program.checked) continue;
+    GLint done = GL_FALSE;
+    glGetProgramiv(program.id, GL_COMPLETION_STATUS_KHR, &done);
+    if(done == GL_TRUE) finish(program);
+  }
+}
+
+void ShaderPrograms::finish(Program &_program)
+{
+  const char *stages[2] = {"vertex shader", "fragment shader"};
+  for(int i=0; i<2; ++i)
+  {
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(_program.shaders[i], GL_COMPILE_STATUS, &compiled);
+    if(compiled != GL_TRUE) printLog(_program.name + " " + stages[i], _program.shaders[i], false);
+  }
+  GLint linked = GL_FALSE;
+  glGetProgramiv(_program.id, GL_LINK_STATUS, &linked);
+  if(linked != GL_TRUE) printLog(_program.name + " link", _program.id, true);
+
+  for(int i=0; i<2; ++i)
+  {
+    glDetachShader(_program.id, _program.shaders[i]);
+    glDeleteShader(_program.shaders[i]);
+  }
+  _program.linked = linked == GL_TRUE;
+  _program.checked = true;
+  // Programs loaded from the cache are checked already and never get here
+  if(_program.linked && !m_cacheDirectory.empty()) saveBinary(_program);
+}
+
+bool ShaderPrograms::loadBinary(Program &_program) const
+{
+  if(m_cacheDirectory.empty()) return false;
+  FILE *file = fopen(cachePath(_program).c_str(), "rb");
+  if(file == nullptr) return false;
+
+  ProgramCacheHeader header;
+  std::vector<char> binary;
+  bool ok = fread(&header, sizeof(ProgramCacheHeader), 1, file) == 1 &&
+            memcmp(header.magic, s_programCacheMagic, 4) == 0 &&
+            header.version == s_programCacheVersion && header.key == _program.key;
+  if(ok)
+  {
+    binary.resize(header.length);
+    ok = header.length > 0 && fread(&binary[0], 1, binary.size(), file) == binary.size();
+  }
+  fclose(file);
+  if(!ok) return false;
+
+  // The driver can still turn it down, after an update that kept its version string say
+  glProgramBinary(_program.id, GLenum(header.format), &binary[0], GLsizei(binary.size()));
+  GLint linked = GL_FALSE;
+  glGetProgramiv(_program.id, GL_LINK_STATUS, &linked);
+  return linked == GL_TRUE;
+}
+
+void ShaderPrograms::saveBinary(const Program &_program) const
+{
+  GLint length = 0;
+  glGetProgramiv(_program.id, GL_PROGRAM_BINARY_LENGTH, &length);
+  if(length <= 0) return;
+  std::vector<char> binary(size_t(length), 0);
+  GLenum format = 0;
+  glGetProgramBinary(_program.id, length, &length, &format, &binary[0]);
+  if(length <= 0) return;
+
+  ProgramCacheHeader header;
+  memset(&header, 0, sizeof(ProgramCacheHeader));
+  memcpy(header.magic, s_programCacheMagic, 4);
+  header.version = s_programCacheVersion;
+  header.key = _program.key;
+  header.format = uint32_t(format);
+  header.length = uint32_t(length);
+
+  // Write it under another name first so a reader never sees half a binary
+  std::string path = cachePath(_program);
+  std::string tmpPath = path + ".tmp";
+  FILE *file = fopen(tmpPath.c_str(), "wb");
+  if(file == nullptr)
+  {
+    std::cerr<<"ShaderPrograms: could not write "<<path<<", "<<_program.name<<" will be compiled again next time\n";
+    return;
+  }
+  bool ok = fwrite(&header, sizeof(ProgramCacheHeader), 1, file) == 1;
+  ok = ok && fwrite(&binary[0], 1, size_t(length), file) == size_t(length);
+  ok = fclose(file) == 0 && ok;
+  if(!ok || rename(tmpPath.c_str(), path.c_str()) != 0)
+  {
+    std::cerr<<"ShaderPrograms: could not write "<<path<<", "<<_program.name<<" will be compiled again next time\n";
+    unlink(tmpPath.c_str());
+  }
+}
+
+std::string ShaderPrograms::cachePath(const Program &_program) const
+{
+  return m_cacheDirectory + "/" + _program.name + ".bin";
+}
+
+int ShaderPrograms::find(const std::string &_name) const
+{
+  for(size_t i=0; i<m_programs.size(); ++i)
+  {
+    if(m_programs[i].name == _name) return int(i);
+  }
+  return -1;
+}
@@ -0,0 +1,86 @@
+#ifndef ShaderPrograms_H
+#define ShaderPrograms_H
+
+#include "glinclude.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/// Start of each program binary in the cache directory, followed by length bytes of
+/// the driver's own format
+struct ProgramCacheHeader
+{
+  char magic[4];
+  uint32_t version;
+  /// Hash of the sources and the driver's vendor, renderer and version strings
+  uint64_t key;
+  uint32_t format;
+  uint32_t length;
+};
+
+/// The scene's GLSL programs, compiled without stalling on the driver. request() hands
+/// the sources over and links straight away, and nothing asks for a status until the
+/// program is first used. With GL_KHR_parallel_shader_compile the driver builds them
+/// all on its own threads and ready() can be polled each frame without blocking.
+///
+/// Linked programs can also be kept on disk as driver binaries, so later runs skip the
+/// compile altogether. A binary is only used if its key matches and the driver takes it,
+/// otherwise the program is compiled from source and the binary written again.
+///
+/// Programs live as long as the context, there's nothing to delete at exit.
+class ShaderPrograms
+{
+public:
+  /// Look for parallel compiling and binary support, call once with the context current
+  /// and before any request(). Binaries are cached in _cacheDirectory unless it's empty.
+  void init(const std::string &_cacheDirectory = "");
+
+  /// Start compiling and linking _name from a vertex and a fragment shader file
+  bool request(const std::string &_name, const std::string &_vertPath, const std::string &_fragPath);
+
+  /// Whether _name has finished compiling (successfully or not). Without the extension
+  /// this is always true and the wait happens in program() instead.
+  bool ready(const std::string &_name) const;
+
+  /// The linked program, or 0 if it failed or was never requested. Blocks until the
+  /// driver is done with it, the first call also reports any compile errors.
+  GLuint program(const std::string &_name);
+
+  /// Check on programs the driver has finished with and cache their binaries. Never
+  /// blocks, so does nothing without parallel compiling. Call once a frame.
+  void update();
+
+  /// Whether the driver compiles in the background
+  bool parallel() const {return m_parallel;}
+
+private:
+  struct Program
+  {
+    std::string name;
+    GLuint id;
+    GLuint shaders[2];
+    /// Set once the status has been read back and the shaders let go
+    bool checked;
+    bool linked;
+    /// Key for the binary cache
+    uint64_t key;
+  };
+
+  /// Read back the status of a program, report errors and cache its binary
+  void finish(Program &_program);
+  /// Try the cached binary for _program, false if there isn't a usable one
+  bool loadBinary(Program &_program) const;
+  void saveBinary(const Program &_program) const;
+  std::string cachePath(const Program &_program) const;
+
+  /// Index of _name in m_programs, or -1
+  int find(const std::string &_name) const;
+
+  std::vector<Program> m_programs;
+  bool m_parallel = false;
+  std::string m_cacheDirectory;
+  /// Vendor, renderer and version, part of every cache key
+  std::string m_driver;
+};
+
+#endif // ShaderPrograms_H
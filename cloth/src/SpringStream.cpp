@@ -0,0 +1,74 @@
+#include "SpringStream.h"
+
+#include <algorithm>
+#include <math.h>
+
+void SpringStream::encode(const std::vector<Spring> &_springs)
+{
+  m_springs.clear();
+  m_materials.clear();
+  m_overflow.clear();
+
+  // Lower particle first, then sort so the solver walks the particles forwards
+  std::vector<Spring> sorted(_springs);
+  for(Spring &spring : sorted)
+  {
+    if(spring.PointMassB < spring.PointMassA) std::swap(spring.PointMassA, spring.PointMassB);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(), [](const Spring &a, const Spring &b)
+  {
+    return a.PointMassA < b.PointMassA || (a.PointMassA == b.PointMassA && a.PointMassB < b.PointMassB);
+  });
+
+  // One material per distinct stiffness and damping, the step comes from the longest
+  // spring using it. Past 255 materials the rest go to the overflow list.
+  std::vector<int> materialOf(sorted.size(), int(s_overflow));
+  for(size_t i=0; i<sorted.size(); ++i)
+  {
+    size_t m = 0;
+    while(m < m_materials.size() &&
+          (m_materials[m].stiffness != sorted[i].stiffness || m_materials[m].damping != sorted[i].damping)) ++m;
+    if(m == m_materials.size())
+    {
+      if(m_materials.size() == s_overflow) continue;
+      SpringMaterial material;
+      material.stiffness = sorted[i].stiffness;
+      material.damping = sorted[i].damping;
+      material.restStep = 0.0f;
+      m_materials.push_back(material);
+    }
+    m_materials[m].restStep = std::max(m_materials[m].restStep, sorted[i].restingDistance);
+    materialOf[i] = int(m);
+  }
+  for(SpringMaterial &material : m_materials) material.restStep /= 65535.0f;
+
+  m_springs.resize(sorted.size());
+  for(size_t i=0; i<sorted.size(); ++i)
+  {
+    const Spring &spring = sorted[i];
+    CompactSpring &compact = m_springs[i];
+    int delta = spring.PointMassB - spring.PointMassA;
+    int material = materialOf[i];
+    if(material != int(s_overflow) && spring.PointMassA < (1<<24) && delta <= 0xffff)
+    {
+      float step = m_materials[material].restStep;
+      float rest = step > 0.0f ? floorf(spring.restingDistance/step + 0.5f) : 0.0f;
+      compact.firstAndMaterial = (uint32_t(spring.PointMassA) << 8) | uint32_t(material);
+      compact.delta = uint16_t(delta);
+      compact.rest = uint16_t(std::min(rest, 65535.0f));
+    }
+    else
+    {
+      compact.firstAndMaterial = (uint32_t(m_overflow.size()) << 8) | s_overflow;
+      compact.delta = 0;
+      compact.rest = 0;
+      m_overflow.push_back(spring);
+    }
+  }
+}
+
+size_t SpringStream::bytes() const
+{
+  return m_springs.size()*sizeof(CompactSpring) + m_overflow.size()*sizeof(Spring) +
+         m_materials.size()*sizeof(SpringMaterial);
+}
@@ -0,0 +1,80 @@
+#ifndef SpringStream_H
+#define SpringStream_H
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+struct Spring
+{
+  float restingDistance;
+  float stiffness;
+  float damping;
+  int PointMassA;
+  int PointMassB;
+};
+
+/// Parameters shared by many springs. Rest lengths are stored per spring as a 16 bit
+/// multiple of restStep, which is the material's longest rest length / 65535.
+struct SpringMaterial
+{
+  float stiffness;
+  float damping;
+  float restStep;
+};
+
+/// One spring in 8 bytes instead of 20: the first particle and material id packed into
+/// one word, then the distance to the second particle and the quantised rest length.
+struct CompactSpring
+{
+  uint32_t firstAndMaterial;
+  uint16_t delta;
+  uint16_t rest;
+};
+
+/// The springs of a cloth sorted by their lower particle, in compact form. Anything that
+/// doesn't fit (a particle past 2^24, a second particle more than 65535 away, or more
+/// than 255 materials) is kept whole in an overflow list and referenced from the stream,
+/// so the stream order is still the order they're solved in.
+class SpringStream
+{
+public:
+  /// Sort and pack _springs, rest lengths lose at most restStep/2
+  void encode(const std::vector<Spring> &_springs);
+
+  size_t size() const {return m_springs.size();}
+  const std::vector<CompactSpring> &springs() const {return m_springs;}
+  size_t numMaterials() const {return m_materials.size();}
+  size_t numOverflow() const {return m_overflow.size();}
+  /// Bytes the solver streams through per pass, overflow and material table included
+  size_t bytes() const;
+
+  /// Unpack one spring of the stream (or a copy of one)
+  inline void decode(const CompactSpring &_spring, int &o_A, int &o_B, float &o_restingDistance, float &o_stiffness) const
+  {
+    uint32_t material = _spring.firstAndMaterial & 0xff;
+    if(material == s_overflow)
+    {
+      const Spring &spring = m_overflow[_spring.firstAndMaterial >> 8];
+      o_A = spring.PointMassA;
+      o_B = spring.PointMassB;
+      o_restingDistance = spring.restingDistance;
+      o_stiffness = spring.stiffness;
+      return;
+    }
+    o_A = int(_spring.firstAndMaterial >> 8);
+    o_B = o_A + _spring.delta;
+    o_restingDistance = float(_spring.rest)*m_materials[material].restStep;
+    o_stiffness = m_materials[material].stiffness;
+  }
+
+  /// Material id that marks a reference into the overflow list
+  static const uint32_t s_overflow = 255;
+
+private:
+  std::vector<CompactSpring> m_springs;
+  std::vector<SpringMaterial> m_materials;
+  std::vector<Spring> m_overflow;
+};
+
+#endif // SpringStream_H
@@ -0,0 +1,81 @@
+#include "WindField.h"
+
+#include <algorithm>
+
+WindField::WindField(const WindParameters &_params)
+{
+  setParameters(_params);
+}
+
+void WindField::setParameters(const WindParameters &_params)
+{
+  m_params = _params;
+  m_params.gridSize = std::max(m_params.gridSize, 4);
+  for(int i=0; i<3; ++i)
+  {
+    // A few octaves is plenty at this resolution, the grid smooths out the rest
+    m_noise[i].SetSeed(i);
+    m_noise[i].SetFrequency(m_params.frequency);
+    m_noise[i].SetOctaveCount(3);
+    // Gusts don't need double precision, and single precision is quicker
+    m_noise[i].SetNoisePrecision(noise::PRECISION_SINGLE);
+  }
+  m_samples.clear();
+}
+
+void WindField::update(float _time, const glm::vec3 &_min, const glm::vec3 &_max)
+{
+  int n = m_params.gridSize;
+  glm::vec3 cell = glm::max((_max - _min)/float(n - 3), glm::vec3(1e-3f));
+  m_origin = _min - cell;
+  m_cellsPerUnit = 1.0f/cell;
+  m_samples.resize(size_t(n*n*n));
+
+  // Gusts are frozen in the air and blown along with it
+  glm::vec3 drift = m_params.velocity*_time;
+  float gust = m_params.gustiness*glm::length(m_params.velocity);
+  size_t count = m_samples.size();
+  std::vector<float> xs(count), ys(count), zs(count), noise[3];
+  size_t s = 0;
+  for(int k=0; k<n; ++k)
+  {
+    for(int j=0; j<n; ++j)
+    {
+      for(int i=0; i<n; ++i, ++s)
+      {
+        glm::vec3 p = m_origin + cell*glm::vec3(float(i), float(j), float(k)) - drift;
+        xs[s] = p.x;
+        ys[s] = p.y;
+        zs[s] = p.z;
+      }
+    }
+  }
+  // The whole grid at once per component, so libnoise can run its block kernels
+  for(int c=0; c<3; ++c)
+  {
+    noise[c].resize(count);
+    m_noise[c].GetValues(&xs[0], &ys[0], &zs[0], &noise[c][0], count);
+  }
+  for(s=0; s<count; ++s)
+  {
+    m_samples[s] = m_params.velocity + gust*glm::vec3(noise[0][s], noise[1][s], noise[2][s]);
+  }
+}
+
+glm::vec3 WindField::velocity(const glm::vec3 &_p) const
+{
+  if(m_samples.empty()) return m_params.velocity;
+
+  int n = m_params.gridSize;
+  glm::vec3 g = glm::clamp((_p - m_origin)*m_cellsPerUnit, glm::vec3(0.0f), glm::vec3(float(n - 1)));
+  int i = std::min(int(g.x), n - 2), j = std::min(int(g.y), n - 2), k = std::min(int(g.z), n - 2);
+  glm::vec3 f = g - glm::vec3(float(i), float(j), float(k));
+
+  const glm::vec3 *c = &m_samples[size_t((k*n + j)*n + i)];
+  size_t dy = size_t(n), dz = size_t(n*n);
+  glm::vec3 x00 = glm::mix(c[0], c[1], f.x);
+  glm::vec3 x10 = glm::mix(c[dy], c[dy + 1], f.x);
+  glm::vec3 x01 = glm::mix(c[dz], c[dz + 1], f.x);
+  glm::vec3 x11 = glm::mix(c[dz + dy], c[dz + dy + 1], f.x);
+  return glm::mix(glm::mix(x00, x10, f.y), glm::mix(x01, x11, f.y), f.z);
+}
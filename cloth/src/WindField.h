@@ -0,0 +1,53 @@
+#ifndef WindField_H
+#define WindField_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <noise.h>
+
+/// How the wind blows and how hard it pushes on cloth
+struct WindParameters
+{
+  /// Mean wind velocity in units per second
+  glm::vec3 velocity = glm::vec3(0.0f,0.0f,1.0f);
+  /// Size of the gusts as a fraction of the mean speed
+  float gustiness = 0.6f;
+  /// Gusts per unit length
+  float frequency = 1.5f;
+  /// Acceleration (in the units of ClothParameters::gravity) on cloth square on to a wind
+  /// of speed 1, along the wind for drag and across it for lift
+  float drag = 0.01f;
+  float lift = 0.01f;
+  /// Samples along each side of the grid, at least 4
+  int gridSize = 8;
+};
+
+/// A time varying wind velocity field. Each component is its own Perlin noise carried
+/// along with the mean wind, so gusts travel across the cloth rather than flicker in
+/// place. The noise is only evaluated on a coarse grid over the cloth once per update(),
+/// every lookup after that is a trilinear blend of the grid.
+class WindField
+{
+public:
+  explicit WindField(const WindParameters &_params = WindParameters());
+
+  /// Sample the field at _time (seconds) over the box _min to _max, padded by a cell
+  void update(float _time, const glm::vec3 &_min, const glm::vec3 &_max);
+
+  /// Wind velocity at _p, anything outside the box gets the nearest face of it
+  glm::vec3 velocity(const glm::vec3 &_p) const;
+
+  const WindParameters &parameters() const {return m_params;}
+  void setParameters(const WindParameters &_params);
+
+private:
+  WindParameters m_params;
+  noise::module::Perlin m_noise[3];
+
+  /// The grid's corner, and its cells per unit along each axis
+  glm::vec3 m_origin = glm::vec3(0.0f);
+  glm::vec3 m_cellsPerUnit = glm::vec3(0.0f);
+  std::vector<glm::vec3> m_samples;
+};
+
+#endif // WindField_H
@@ -57,7 +57,7 @@ void resize_callback(GLFWwindow */*window*/, int width, int height) {
     g_scene.resizeGL(width,height);
 }
 
-int main() {
+int main(int argc, char **argv) {
     if (!glfwInit()) {
         // Initialisation failed
         glfwTerminate();
@@ -118,6 +118,29 @@ int main() {
     // Initialise our OpenGL scene
     g_scene.initGL();
 
+    // Optionally drape a mesh instead of the sheet (--mesh file, before any cache options,
+    // renumbered by --reorder none|morton|rcm), play back (--play file) or record
+    // (--record file) a point cache, add a crowd of extra cloths (--world count) or blow
+    // wind over the cloth (--wind speed). The solver steps with --integrator
+    // euler|verlet|forces, euler by default.
+    ReorderMethod reorder = REORDER_MORTON;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg(argv[i]);
+        if (arg == "--reorder") {
+            std::string method(argv[i+1]);
+            reorder = method == "rcm" ? REORDER_RCM : method == "none" ? REORDER_NONE : REORDER_MORTON;
+        }
+        else if (arg == "--mesh") g_scene.loadClothMesh(argv[i+1], reorder);
+        else if (arg == "--play") g_scene.loadPointCache(argv[i+1]);
+        else if (arg == "--record") g_scene.recordPointCache(argv[i+1]);
+        else if (arg == "--world") g_scene.createWorld(size_t(atoi(argv[i+1])));
+        else if (arg == "--wind") g_scene.setWind(float(atof(argv[i+1])));
+        else if (arg == "--integrator") {
+            std::string integrator(argv[i+1]);
+            g_scene.setIntegrator(integrator == "verlet" ? VERLET : integrator == "forces" ? EULER_FORCES : EULER);
+        }
+    }
+
     // Set the window resize callback and call it once
     glfwSetFramebufferSizeCallback(window, resize_callback);
     resize_callback(window, width, height);
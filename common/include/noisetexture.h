@@ -22,9 +22,24 @@
 #ifndef NOISETEXTURE_H
 #define NOISETEXTURE_H
 
-#include <GL/gl.h>
+#include "glinclude.h"
 #include <iostream>
 #include <array>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "workstealingpool.h"
 
 /**
  * @brief The NoiseTexture class
@@ -45,15 +60,53 @@ public:
     /// dtor - must remove memory associated with bound texture
     virtual ~NoiseTexture();
 
-    /// Create the texture. This must be called within a GL context. You might want to do this in parallel.
+    /// Create the texture. This must be called within a GL context. The texels are filled
+    /// in parallel by fill() and uploaded from the calling thread once they're all done.
     virtual void generate();
 
-    /// Bind this texture to the current rendering context.
+    /// Fill _data with the RGB texels of the texture, m_res^DIM of them with the first
+    /// coordinate changing fastest. The texture is split into bricks that each fit in
+    /// cache, which are shared out over a thread pool. No GL calls are made, so this can
+    /// be called from any thread.
+    void fill(GLfloat */*data*/);
+
+    /// Create the texture without waiting for it. This must be called within a GL context.
+    /// The texels are generated on a background thread straight into pixel unpack buffers,
+    /// a slab of bricks at a time, and update() copies each finished slab into the texture.
+    /// Until the last one is in, bind() binds a low resolution placeholder instead. Mipmaps
+    /// are left to glGenerateMipmap() here, as the slabs are never all on the CPU at once.
+    void generateAsync();
+
+    /// Copy up to _maxSlabs slabs that have finished generating into the texture. Call this
+    /// once a frame from the GL context after generateAsync(). Returns ready().
+    bool update(size_t /*maxSlabs*/ = 2);
+
+    /// Whether the whole texture has been generated and uploaded
+    bool ready() const {return m_isInit && m_slabBuffers.empty();}
+
+    /// Bind this texture to the current rendering context, or its placeholder if it isn't ready.
     void bind() const;
 
     /// Return the id of this texture
     GLuint getID() const {return m_texID;}
 
+    /// Set the internal format of the texture before it's generated. GL_RGB (the default)
+    /// and GL_RGB32F keep full floats, GL_RGB16F and GL_R16F halve them and GL_R8 stores
+    /// just the first channel in a byte, remapped so that [lower,upper] samples as [0,1].
+    void setInternalFormat(GLenum _format) {m_internalFormat = _format;}
+
+    /// Whether the texture gets a full mip chain, built on the CPU when it's generated
+    void setMipmaps(bool _mipmaps) {m_mipmaps = _mipmaps;}
+
+    /// The bounds of the noise values, needed to undo the remapping of a GL_R8 texture
+    float getLower() const {return m_lower;}
+    float getUpper() const {return m_upper;}
+
+    /// Keep generated texels in _directory, named by a hash of everything that affects
+    /// them, so that generate() can map and upload them next time instead. An empty
+    /// directory (the default) turns the cache off.
+    void setCacheDirectory(const std::string &_directory) {m_cacheDirectory = _directory;}
+
     /// Delete this texture off the GPU
     void destroy();
 
@@ -63,12 +116,91 @@ protected:
     /// Function to copy the raw data onto the GPU as texture
     void copyTextureDataToGPU(GLfloat */*data*/);
 
-    /// Recursively generate the data
-    virtual void generate_recurse(const size_t &/*dim*/, const CoordinateArray &/*coord*/, GLfloat */*data*/);
+    /// Create a texture _res texels along each side from _data (which may be null) and return
+    /// its id. The texels are remapped in place first if the internal format needs it.
+    GLuint uploadTexture(size_t /*res*/, GLfloat */*data*/);
+
+    /// Upload one mip level of the bound texture
+    void uploadLevel(GLint /*level*/, size_t /*res*/, const GLfloat */*data*/);
+
+    /// Remap _count RGB texels in place to suit the internal format
+    void remapTexels(GLfloat */*data*/, size_t /*count*/) const;
+
+    /// Box filter a level _res along each side down to the next, which is half that (at
+    /// least one) along each side, sharing the rows out over _pool
+    void downsample(WorkStealingPool &/*pool*/, size_t /*res*/, const GLfloat */*src*/, GLfloat */*dst*/) const;
+
+    /// Generate one brick of texels of a texture _res along each side, _brick counting along
+    /// the first coordinate fastest. _data holds the texels from _firstTexel onwards.
+    void fillBrick(size_t /*res*/, size_t /*brick*/, size_t /*firstTexel*/, GLfloat */*data*/);
+
+    /// Generate one slab of bricks, the ones sharing a position along the last coordinate,
+    /// into _data, which holds just that slab's texels, sharing the bricks out over _pool
+    void fillSlab(WorkStealingPool &/*pool*/, size_t /*res*/, size_t /*slab*/, GLfloat */*data*/);
+
+    /// Number of slabs and the number of texels in one of them for a texture _res along each side
+    size_t numSlabs(size_t /*res*/) const;
+    size_t slabTexels(size_t /*res*/, size_t /*slab*/) const;
+
+    /// Stop any background generation and wait for it. Anything that overrides the generator
+    /// functions must call this in its destructor, while they can still be called.
+    void stopGenerating();
 
     /// A generator function to make the process of building noise easy
     virtual inline GLfloat generator_func(const CoordinateArrayf &) = 0;
 
+    /// Generate _count values at once, the coordinates past DIM are zero. By default this
+    /// calls generator_func() for each one, override it to evaluate a whole batch at once.
+    virtual void generator_batch(const GLfloat */*x*/,
+                                 const GLfloat */*y*/,
+                                 const GLfloat */*z*/,
+                                 GLfloat */*out*/,
+                                 size_t /*count*/);
+
+    /// Whether generator_batch() can be called from several threads at once. If not the
+    /// bricks are generated one after another on the calling thread.
+    virtual bool isThreadSafe() const {return true;}
+
+    /// Describe the generator and all its settings for the disk cache. Two textures that
+    /// return the same key must generate the same texels. The default of an empty key
+    /// means the texels can't be cached.
+    virtual std::string cacheKey() const {return std::string();}
+
+    /// The generator key followed by the texture's own settings, or an empty string if
+    /// the texture can't be cached
+    std::string fullCacheKey() const;
+
+    /// The cache file for a key from fullCacheKey(), or an empty string if there's none
+    std::string cachePath(const std::string &/*key*/) const;
+
+    /// Upload the texture straight from its cache file if there's a valid one
+    bool uploadFromCache(const std::string &/*path*/, const std::string &/*key*/);
+
+    /// Start writing a cache file under a temporary name, returning null if it can't be
+    /// opened. The texels are written to it in order then finishCache() puts it in place.
+    FILE *startCache(const std::string &/*path*/, const std::string &/*key*/) const;
+    void finishCache(const std::string &/*path*/, FILE */*file*/, bool /*ok*/) const;
+
+    /// Header at the start of a cache file, followed by the key (padded to 8 bytes so
+    /// the texels stay aligned) and then the texels
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t keyLength;
+        uint64_t dimensions;
+        uint64_t resolution;
+    };
+
+    /// Where cache files go, empty if there's no cache
+    std::string m_cacheDirectory;
+
+    /// Bytes the key takes up in a cache file
+    static size_t cacheKeyBytes(size_t length) {return (length + 7) & ~size_t(7);}
+
+    /// The internal format of the texture and whether it has mipmaps
+    GLenum m_internalFormat = GL_RGB;
+    bool m_mipmaps = false;
+
     /// Keep track of whether the texture has been initialised
     bool m_isInit;
 
@@ -96,6 +228,27 @@ protected:
     }
     const GLuint m_target = target();
 
+    /// Texels along each side of a brick, about 4096 texels (48KB of RGB floats) in all
+    static constexpr size_t brickSide() {
+        return (DIM == 1) ? 4096 : ((DIM == 2) ? 64 : 16);
+    }
+
+    /// The placeholder bound until an asynchronous texture is ready, and its resolution
+    GLuint m_placeholderID = 0;
+    size_t placeholderRes() const {return std::min(m_res, std::max(size_t(2), m_res / 16));}
+
+    /// One pixel unpack buffer per slab, and where each is mapped, until update() has copied it
+    std::vector<GLuint> m_slabBuffers;
+    std::vector<GLfloat*> m_slabData;
+
+    /// Slabs the background thread has finished and update() has copied
+    std::atomic<size_t> m_slabsFilled;
+    size_t m_slabsUploaded = 0;
+
+    /// Tells the background thread to stop after the slab it's on
+    std::atomic<bool> m_stop;
+    std::future<void> m_generation;
+
 private:
     /// Precompute the inverse of the resolution
     float m_inv_resf;
@@ -111,7 +264,9 @@ NoiseTexture<DIM>::NoiseTexture(float _lower,
     : m_isInit(false),
       m_res(_resolution),
       m_lower(_lower),
-      m_upper(_upper)
+      m_upper(_upper),
+      m_slabsFilled(0),
+      m_stop(false)
 {
     m_inv_resf = 1.0f / float(m_res-1);
 }
@@ -125,12 +280,39 @@ NoiseTexture<DIM>::~NoiseTexture() {
  */
 template <size_t DIM>
 void NoiseTexture<DIM>::destroy() {
+    stopGenerating();
+    if (!m_slabBuffers.empty()) {
+        for (size_t i=m_slabsUploaded; i<m_slabBuffers.size(); ++i) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_slabBuffers[i]);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(GLsizei(m_slabBuffers.size() - m_slabsUploaded), &m_slabBuffers[m_slabsUploaded]);
+        m_slabBuffers.clear();
+        m_slabData.clear();
+    }
+    if (m_placeholderID) {
+        glDeleteTextures(1, &m_placeholderID);
+        m_placeholderID = 0;
+    }
     if (m_isInit) {
         glDeleteTextures(1, &m_texID);
         m_isInit = false;
     }
 }
 
+/**
+ * @brief NoiseTexture::stopGenerating
+ */
+template <size_t DIM>
+void NoiseTexture<DIM>::stopGenerating() {
+    if (m_generation.valid()) {
+        m_stop = true;
+        m_generation.wait();
+        m_stop = false;
+    }
+}
+
 
 /**
  * Note: I could have implemented this with template specialisations. It would have resulted in
@@ -138,8 +320,10 @@ void NoiseTexture<DIM>::destroy() {
  */
 template <size_t DIM>
 void NoiseTexture<DIM>::bind() const {
-    if (m_isInit) {
+    if (ready()) {
         glBindTexture(m_target, m_texID);
+    } else if (m_placeholderID) {
+        glBindTexture(m_target, m_placeholderID);
     }
 }
 
@@ -151,26 +335,70 @@ void NoiseTexture<DIM>::bind() const {
  */
 template <size_t DIM>
 void NoiseTexture<DIM>::copyTextureDataToGPU(GLfloat *data) {
+    m_texID = uploadTexture(m_res, data);
+}
+
+/**
+ * @brief NoiseTexture::uploadTexture
+ * @param res The number of texels along each side
+ * @param data The texels, or null to leave them undefined
+ * @return The id of the new texture, which is left bound
+ */
+template <size_t DIM>
+GLuint NoiseTexture<DIM>::uploadTexture(size_t res, GLfloat *data) {
     // Transfer this data to our texture
-    glGenTextures(1, &m_texID);
-    glBindTexture(m_target, m_texID);
+    GLuint texID;
+    glGenTextures(1, &texID);
+    glBindTexture(m_target, texID);
 
     // Repeat the texture for coordinates <0 or >1
     glTexParameteri(m_target, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(m_target, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(m_target, GL_TEXTURE_WRAP_R, GL_REPEAT);
 
-    // Use blending when texels are bigger or smaller than pixels
+    // Use blending when texels are bigger or smaller than pixels, between mip levels too if there are any
     glTexParameteri(m_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(m_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(m_target, GL_TEXTURE_MIN_FILTER, m_mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 
     // Upload the texture data to the GPU
+    size_t numTexels = 1;
+    for (size_t d=0; d<DIM; ++d) numTexels *= res;
+    if (data != NULL) remapTexels(data, numTexels);
+    uploadLevel(0, res, data);
+    if (!m_mipmaps || data == NULL) return texID;
+
+    // Each level is filtered from the one above, in parallel, and uploaded before the next
+    WorkStealingPool pool;
+    std::vector<GLfloat> src, dst;
+    const GLfloat *level = data;
+    for (GLint l=1; res > 1; ++l) {
+        const size_t next = std::max(size_t(1), res / 2);
+        numTexels = 1;
+        for (size_t d=0; d<DIM; ++d) numTexels *= next;
+        dst.resize(numTexels * 3);
+        downsample(pool, res, level, &dst[0]);
+        uploadLevel(l, next, &dst[0]);
+        src.swap(dst);
+        level = &src[0];
+        res = next;
+    }
+    return texID;
+}
+
+/**
+ * @brief NoiseTexture::uploadLevel
+ * @param level The mip level
+ * @param res The number of texels along each side of the level
+ * @param data The RGB float texels, or null to leave them undefined
+ */
+template <size_t DIM>
+void NoiseTexture<DIM>::uploadLevel(GLint level, size_t res, const GLfloat *data) {
     switch(DIM) {
     case 1:
         glTexImage1D(m_target,      // Target
-                     0,             // Level
-                     GL_RGB,        // Internal Format
-                     m_res,         // width
+                     level,         // Level
+                     m_internalFormat, // Internal Format
+                     res,           // width
                      0,             // border
                      GL_RGB,        // format
                      GL_FLOAT,      // type
@@ -178,10 +406,10 @@ void NoiseTexture<DIM>::copyTextureDataToGPU(GLfloat *data) {
         break;
     case 2:
         glTexImage2D(m_target,      // Target
-                     0,             // Level
-                     GL_RGB,        // Internal Format
-                     m_res,         // width
-                     m_res,         // height
+                     level,         // Level
+                     m_internalFormat, // Internal Format
+                     res,           // width
+                     res,           // height
                      0,             // border
                      GL_RGB,        // format
                      GL_FLOAT,      // type
@@ -189,11 +417,11 @@ void NoiseTexture<DIM>::copyTextureDataToGPU(GLfloat *data) {
         break;
     case 3:
         glTexImage3D(m_target,      // Target
-                     0,             // Layer
-                     GL_RGB,        // Input format
-                     m_res,         // Width
-                     m_res,         // Height
-                     m_res,         // Depth
+                     level,         // Layer
+                     m_internalFormat, // Input format
+                     res,           // Width
+                     res,           // Height
+                     res,           // Depth
                      0,             // border
                      GL_RGB,        // Storage format
                      GL_FLOAT,      // Storage type
@@ -203,45 +431,333 @@ void NoiseTexture<DIM>::copyTextureDataToGPU(GLfloat *data) {
 }
 
 /**
- * @brief NoiseTexture<DIM>::generate_recurse Generates a block of noise texture using
+ * @brief NoiseTexture::remapTexels
+ * GL_R8 can only hold [0,1], so the noise bounds are mapped onto that. The GL converts
+ * floats to the other formats itself, dropping the channels they don't have.
+ * @param data The RGB texels
+ * @param count The number of texels
+ */
+template <size_t DIM>
+void NoiseTexture<DIM>::remapTexels(GLfloat *data, size_t count) const {
+    if (m_internalFormat != GL_R8 || m_upper == m_lower) return;
+    const float scale = 1.0f / (m_upper - m_lower);
+    for (size_t i=0; i<count * 3; ++i) {
+        data[i] = (data[i] - m_lower) * scale;
+    }
+}
+
+/**
+ * @brief NoiseTexture::downsample
+ * Each texel of the smaller level averages the 2^DIM texels it covers. Odd sized levels
+ * lose their last row, as the GL's own level sizes round down.
+ * @param pool The pool to share the rows out over
+ * @param res The number of texels along each side of src
+ * @param src The RGB texels of the larger level
+ * @param dst The RGB texels of the smaller level
+ */
+template <size_t DIM>
+void NoiseTexture<DIM>::downsample(WorkStealingPool &pool, size_t res, const GLfloat *src, GLfloat *dst) const {
+    const size_t next = std::max(size_t(1), res / 2);
+    size_t rowTexels = 1;
+    for (size_t d=1; d<DIM; ++d) rowTexels *= next;
+    const float weight = 1.0f / float(1 << DIM);
+
+    // A row is every texel sharing a position along the last coordinate
+    pool.parallelFor(next, [&](size_t row) {
+        for (size_t i=0; i<rowTexels; ++i) {
+            CoordinateArray coord;
+            size_t index = i;
+            for (size_t d=0; d+1<DIM; ++d) {
+                coord[d] = index % next;
+                index /= next;
+            }
+            coord[DIM-1] = row;
+
+            float sum[3] = {0.0f, 0.0f, 0.0f};
+            for (size_t corner=0; corner < (size_t(1) << DIM); ++corner) {
+                size_t pos = 0, dim_length = 1;
+                for (size_t d=0; d<DIM; ++d) {
+                    pos += std::min(2 * coord[d] + ((corner >> d) & 1), res - 1) * dim_length;
+                    dim_length *= res;
+                }
+                for (size_t c=0; c<3; ++c) sum[c] += src[pos * 3 + c];
+            }
+            GLfloat *out = dst + (row * rowTexels + i) * 3;
+            for (size_t c=0; c<3; ++c) out[c] = sum[c] * weight;
+        }
+    });
+}
+
+/**
+ * @brief NoiseTexture<DIM>::generator_batch Generates a batch of values with generator_func()
+ * @param x,y,z The coordinates of each value, those past DIM are ignored
+ * @param out Where to write the values
+ * @param count The number of values
+ */
+template <size_t DIM>
+void NoiseTexture<DIM>::generator_batch(const GLfloat *x,
+                                        const GLfloat *y,
+                                        const GLfloat *z,
+                                        GLfloat *out,
+                                        size_t count) {
+    const GLfloat *coords[3] = {x, y, z};
+    CoordinateArrayf coordf;
+    for (size_t i=0; i<count; ++i) {
+        for (size_t d=0; d<DIM; ++d) coordf[d] = coords[d][i];
+        out[i] = generator_func(coordf);
+    }
+}
+
+/**
+ * @brief NoiseTexture<DIM>::fillBrick Generates one brick of the noise texture
  *
- * @param d The current dimension you're looping over (starts at DIM and ticks down to 0)
- * @param coord The array used to build the current index of your sample (dimension DIM)
+ * @param res The number of texels along each side of the texture
+ * @param brick The index of the brick, counting along the first coordinate fastest
+ * @param firstTexel The texel data[0] belongs to
  * @param data The data which we are writing to.
  */
 template <size_t DIM>
-void NoiseTexture<DIM>::generate_recurse(const size_t &d,
-                                         const CoordinateArray& coord,
-                                         GLfloat *data) {
-    size_t dim_length = 1, data_pos = 0, i;
-    CoordinateArrayf coordf, tmp;
-    CoordinateArray ncoord;
-    switch(d) {
-    case 0:
-        // At the end of the recursion chain we can evaluate the noise function
-        for (i=0; i<DIM; ++i) {
-            data_pos += coord[i] * dim_length;
-            dim_length *= m_res;
-            coordf[i] = m_inv_resf * float(coord[i]);
+void NoiseTexture<DIM>::fillBrick(size_t res, size_t brick, size_t firstTexel, GLfloat *data) {
+    const size_t side = std::min(brickSide(), res);
+    const size_t bricksPerSide = (res + side - 1) / side;
+    const float inv_resf = (res == m_res) ? m_inv_resf : 1.0f / float(res-1);
+
+    // Where the brick starts and how far it goes along each dimension, the last brick
+    // along a side may be cut short
+    CoordinateArray start, size;
+    size_t numTexels = 1, i, d;
+    for (d=0; d<DIM; ++d) {
+        start[d] = (brick % bricksPerSide) * side;
+        brick /= bricksPerSide;
+        size[d] = std::min(side, res - start[d]);
+        numTexels *= size[d];
+    }
+
+    // The coordinates and data position of every texel in the brick
+    std::vector<GLfloat> base(numTexels * 3, 0.0f), coords(numTexels * 3, 0.0f), values(numTexels);
+    std::vector<size_t> dataPos(numTexels);
+    CoordinateArray coord = start;
+    for (i=0; i<numTexels; ++i) {
+        size_t pos = 0, dim_length = 1;
+        for (d=0; d<DIM; ++d) {
+            pos += coord[d] * dim_length;
+            dim_length *= res;
+            base[d * numTexels + i] = inv_resf * float(coord[d]);
         }
-        data_pos *= 3;
+        dataPos[i] = (pos - firstTexel) * 3;
 
-        // Fill up the data with data defined by the generator_func()
-        for (i=0; i<3; ++i) {
-            tmp = coordf; coordf[i] += 1.0f;
-            data[data_pos + i] = generator_func(coordf);
+        // Step to the next texel, carrying into the next dimension at the end of a row
+        for (d=0; d<DIM; ++d) {
+            if (++coord[d] < start[d] + size[d]) break;
+            coord[d] = start[d];
         }
-        break;
-    default:
-        // For the rest of the dimensions we recursively call all the remaining coordinates
-        ncoord = coord;
-        for (i=0; i<m_res; ++i) {
-            ncoord[d-1] = i;
-            generate_recurse(d-1, ncoord, data);
+    }
+
+    // Each channel is offset by one more unit than the last, along one more dimension,
+    // as the channels always have been
+    for (size_t channel=0; channel<3; ++channel) {
+        for (d=0; d<DIM; ++d) {
+            const float offset = (d <= channel) ? 1.0f : 0.0f;
+            for (i=0; i<numTexels; ++i) {
+                coords[d * numTexels + i] = base[d * numTexels + i] + offset;
+            }
+        }
+        generator_batch(&coords[0], &coords[numTexels], &coords[2 * numTexels], &values[0], numTexels);
+        for (i=0; i<numTexels; ++i) {
+            data[dataPos[i] + channel] = values[i];
         }
     }
 }
 
+/**
+ * @brief NoiseTexture<DIM>::numSlabs
+ * @param res The number of texels along each side of the texture
+ * @return The number of bricks along the last dimension
+ */
+template <size_t DIM>
+size_t NoiseTexture<DIM>::numSlabs(size_t res) const {
+    const size_t side = std::min(brickSide(), res);
+    return (res + side - 1) / side;
+}
+
+/**
+ * @brief NoiseTexture<DIM>::slabTexels
+ * @param res The number of texels along each side of the texture
+ * @param slab The index of the slab
+ * @return The number of texels in the slab, which are contiguous in the texture
+ */
+template <size_t DIM>
+size_t NoiseTexture<DIM>::slabTexels(size_t res, size_t slab) const {
+    const size_t side = std::min(brickSide(), res);
+    size_t numTexels = std::min(side, res - slab * side);
+    for (size_t d=1; d<DIM; ++d) numTexels *= res;
+    return numTexels;
+}
+
+/**
+ * @brief NoiseTexture<DIM>::fillSlab Generates the bricks of one slab of the noise texture
+ * @param pool The threads to generate the bricks on, made once for all the slabs
+ * @param res The number of texels along each side of the texture
+ * @param slab The index of the slab
+ * @param data The data which we are writing to, starting at the first texel of the slab
+ */
+template <size_t DIM>
+void NoiseTexture<DIM>::fillSlab(WorkStealingPool &pool, size_t res, size_t slab, GLfloat *data) {
+    const size_t side = std::min(brickSide(), res);
+    const size_t bricksPerSide = numSlabs(res);
+    size_t bricksPerSlab = 1, firstTexel = slab * side;
+    for (size_t d=1; d<DIM; ++d) {
+        bricksPerSlab *= bricksPerSide;
+        firstTexel *= res;
+    }
+
+    const size_t firstBrick = slab * bricksPerSlab;
+    if (isThreadSafe() && bricksPerSlab > 1) {
+        pool.parallelFor(bricksPerSlab, [&](size_t b) {fillBrick(res, firstBrick + b, firstTexel, data);});
+    } else {
+        for (size_t b=0; b<bricksPerSlab; ++b) fillBrick(res, firstBrick + b, firstTexel, data);
+    }
+}
+
+/**
+ * @brief NoiseTexture<DIM>::fill Generates every brick of the noise texture
+ * @param data The data which we are writing to, 3 floats per texel
+ */
+template <size_t DIM>
+void NoiseTexture<DIM>::fill(GLfloat *data) {
+    const size_t bricksPerSide = numSlabs(m_res);
+    size_t numBricks = 1;
+    for (size_t d=0; d<DIM; ++d) numBricks *= bricksPerSide;
+
+    if (isThreadSafe()) {
+        WorkStealingPool pool;
+        pool.parallelFor(numBricks, [&](size_t b) {fillBrick(m_res, b, 0, data);});
+    } else {
+        for (size_t b=0; b<numBricks; ++b) fillBrick(m_res, b, 0, data);
+    }
+}
+
+/**
+ * @brief NoiseTexture<DIM>::fullCacheKey
+ * @return Everything the texels depend on, or an empty string if there's no cache
+ */
+template <size_t DIM>
+std::string NoiseTexture<DIM>::fullCacheKey() const {
+    const std::string generator = cacheKey();
+    if (m_cacheDirectory.empty() || generator.empty()) return std::string();
+
+    std::ostringstream key;
+    key << std::setprecision(17) << generator << '\0' << DIM << ' ' << m_res << ' ' << m_lower << ' ' << m_upper;
+    return key.str();
+}
+
+/**
+ * @brief NoiseTexture<DIM>::cachePath
+ * @param key The key from fullCacheKey()
+ * @return The cache file, named by a 64 bit FNV-1a hash of the key, or an empty string
+ * if there's no cache
+ */
+template <size_t DIM>
+std::string NoiseTexture<DIM>::cachePath(const std::string &key) const {
+    if (key.empty()) return std::string();
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : key) {
+        hash ^= uint64_t(uint8_t(c));
+        hash *= 1099511628211ULL;
+    }
+
+    std::ostringstream path;
+    path << m_cacheDirectory << "/noise" << DIM << "d_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".tex";
+    return path.str();
+}
+
+/**
+ * @brief NoiseTexture<DIM>::uploadFromCache
+ * @param path The cache file
+ * @param key The key from fullCacheKey(), which the file has to have been written with
+ * @return Whether the file was valid and the texture has been created from it
+ */
+template <size_t DIM>
+bool NoiseTexture<DIM>::uploadFromCache(const std::string &path, const std::string &key) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(CacheHeader)) {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = size_t(st.st_size);
+    // Private and writable, so the texels can be remapped for upload without touching the file
+    void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+
+    // The file name is only a hash, so check it really is this texture before using it
+    const CacheHeader *header = static_cast<const CacheHeader *>(map);
+    const char *keyData = static_cast<const char *>(map) + sizeof(CacheHeader);
+    const size_t keyBytes = cacheKeyBytes(key.size());
+    size_t numTexels = 1;
+    for (size_t d=0; d<DIM; ++d) numTexels *= m_res;
+    const bool valid = memcmp(header->magic, "NTEX", 4) == 0 && header->version == 2 &&
+                       header->dimensions == DIM && header->resolution == m_res &&
+                       header->keyLength == key.size() &&
+                       size == sizeof(CacheHeader) + keyBytes + numTexels * 3 * sizeof(GLfloat) &&
+                       memcmp(keyData, key.data(), key.size()) == 0;
+    if (valid) {
+        copyTextureDataToGPU((GLfloat *) (keyData + keyBytes));
+    }
+    munmap(map, size);
+    return valid;
+}
+
+/**
+ * @brief NoiseTexture<DIM>::startCache
+ * @param path The cache file
+ * @param key The key from fullCacheKey(), stored after the header
+ * @return The temporary file with the header and key written, or null
+ */
+template <size_t DIM>
+FILE *NoiseTexture<DIM>::startCache(const std::string &path, const std::string &key) const {
+    CacheHeader header;
+    memset(&header, 0, sizeof(CacheHeader));
+    memcpy(header.magic, "NTEX", 4);
+    header.version = 2;
+    header.keyLength = key.size();
+    header.dimensions = DIM;
+    header.resolution = m_res;
+    std::string keyData = key;
+    keyData.resize(cacheKeyBytes(key.size()), '\0');
+
+    // Write it under another name first so a reader never maps half a file
+    FILE *file = fopen((path + ".tmp").c_str(), "wb");
+    if (file != nullptr && (fwrite(&header, sizeof(CacheHeader), 1, file) != 1 ||
+                            fwrite(keyData.data(), 1, keyData.size(), file) != keyData.size())) {
+        finishCache(path, file, false);
+        return nullptr;
+    }
+    if (file == nullptr) {
+        std::cerr << "NoiseTexture: could not write " << path << ", the texture will be generated again next time\n";
+    }
+    return file;
+}
+
+/**
+ * @brief NoiseTexture<DIM>::finishCache
+ * @param path The cache file
+ * @param file The temporary file from startCache()
+ * @param ok Whether all the texels were written, otherwise the file is thrown away
+ */
+template <size_t DIM>
+void NoiseTexture<DIM>::finishCache(const std::string &path, FILE *file, bool ok) const {
+    const std::string tmpPath = path + ".tmp";
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "NoiseTexture: could not write " << path << ", the texture will be generated again next time\n";
+        unlink(tmpPath.c_str());
+    }
+}
+
 /**
  * @brief SimplexNoiseTexture::generate
  * Set up the noise texture using the parameters specified. Assume the appropriate
@@ -251,20 +767,154 @@ template <size_t DIM>
 void NoiseTexture<DIM>::generate() {
     if (m_isInit) return;
 
+    // A texture generated on an earlier run goes straight from the file to the GPU
+    const std::string key = fullCacheKey();
+    const std::string path = cachePath(key);
+    if (!path.empty() && uploadFromCache(path, key)) {
+        m_isInit = true;
+        return;
+    }
+
     // Allocate a slab of data for the stuffing
-    GLfloat *data = (GLfloat*) malloc(sizeof(GLfloat) * pow(m_res,DIM) * 3);
+    size_t numTexels = 1;
+    for (size_t d=0; d<DIM; ++d) numTexels *= m_res;
+    std::vector<GLfloat> data(numTexels * 3);
+
+    // Fill it in parallel
+    fill(&data[0]);
 
-    // Use the recursive function to generate the data recursively
-    CoordinateArray coord;
-    generate_recurse(DIM, coord, data);
+    // Cache the texels before the upload remaps them
+    FILE *file = path.empty() ? nullptr : startCache(path, key);
+    if (file != nullptr) {
+        finishCache(path, file, fwrite(&data[0], sizeof(GLfloat), data.size(), file) == data.size());
+    }
 
     // Copy our data over to the GPU
-    copyTextureDataToGPU(data);
+    copyTextureDataToGPU(&data[0]);
 
-    // Delete our data - it's been copied onto the GPU right?
-    free(data);
+    m_isInit = true;
+}
+
+/**
+ * @brief NoiseTexture<DIM>::generateAsync
+ * Set up the placeholder, the empty texture and a mapped pixel unpack buffer for each
+ * slab, then start filling the buffers in the background. Assume the appropriate
+ * texture unit has been activated.
+ */
+template <size_t DIM>
+void NoiseTexture<DIM>::generateAsync() {
+    if (m_isInit) return;
 
+    // A cached texture is quicker to upload than to show a placeholder for
+    const std::string key = fullCacheKey();
+    const std::string path = cachePath(key);
+    if (!path.empty() && uploadFromCache(path, key)) {
+        m_isInit = true;
+        return;
+    }
+
+    // The placeholder is small enough to generate straight away
+    const size_t res = placeholderRes();
+    size_t numTexels = 1;
+    for (size_t d=0; d<DIM; ++d) numTexels *= res;
+    std::vector<GLfloat> data(numTexels * 3);
+    {
+        WorkStealingPool pool(isThreadSafe() ? 0 : 1);
+        for (size_t slab=0, first=0; slab<numSlabs(res); ++slab) {
+            fillSlab(pool, res, slab, &data[first * 3]);
+            first += slabTexels(res, slab);
+        }
+    }
+    m_placeholderID = uploadTexture(res, &data[0]);
+
+    // Leave the full texture undefined until its slabs arrive
+    copyTextureDataToGPU(NULL);
+
+    // Map a buffer for every slab up front, as the worker can't make GL calls
+    const size_t slabs = numSlabs(m_res);
+    m_slabBuffers.resize(slabs);
+    m_slabData.resize(slabs);
+    glGenBuffers(GLsizei(slabs), &m_slabBuffers[0]);
+    for (size_t slab=0; slab<slabs; ++slab) {
+        const GLsizeiptr bytes = slabTexels(m_res, slab) * 3 * sizeof(GLfloat);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_slabBuffers[slab]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        m_slabData[slab] = (GLfloat*) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_slabsFilled = 0;
+    m_slabsUploaded = 0;
     m_isInit = true;
+
+    // Each slab is written to the cache, if there is one, while it's still mapped
+    m_generation = std::async(std::launch::async, [this, slabs, path, key]() {
+        FILE *file = path.empty() ? nullptr : startCache(path, key);
+        // One set of threads for the whole texture, not one per slab
+        WorkStealingPool pool(isThreadSafe() ? 0 : 1);
+        bool ok = true;
+        for (size_t slab=0; slab<slabs && !m_stop; ++slab) {
+            fillSlab(pool, m_res, slab, m_slabData[slab]);
+            if (file != nullptr) {
+                const size_t count = slabTexels(m_res, slab) * 3;
+                ok = ok && fwrite(m_slabData[slab], sizeof(GLfloat), count, file) == count;
+            }
+            remapTexels(m_slabData[slab], slabTexels(m_res, slab));
+            ++m_slabsFilled;
+        }
+        if (file != nullptr && m_slabsFilled == slabs) {
+            finishCache(path, file, ok);
+        } else if (file != nullptr) {
+            fclose(file);
+            unlink((path + ".tmp").c_str());
+        }
+    });
+}
+
+/**
+ * @brief NoiseTexture<DIM>::update
+ * Copy the slabs the worker has finished from their buffers into the texture, leaving
+ * the texture bound.
+ * @param maxSlabs The most slabs to copy this call
+ * @return Whether the texture is complete
+ */
+template <size_t DIM>
+bool NoiseTexture<DIM>::update(size_t maxSlabs) {
+    if (ready() || !m_isInit) return ready();
+
+    const size_t side = std::min(brickSide(), m_res);
+    const size_t filled = std::min(size_t(m_slabsFilled), m_slabsUploaded + maxSlabs);
+    if (filled > m_slabsUploaded) glBindTexture(m_target, m_texID);
+    for (; m_slabsUploaded < filled; ++m_slabsUploaded) {
+        const GLint offset = GLint(m_slabsUploaded * side);
+        const GLsizei depth = GLsizei(std::min(side, m_res - offset));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_slabBuffers[m_slabsUploaded]);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        switch(DIM) {
+        case 1:
+            glTexSubImage1D(m_target, 0, offset, depth, GL_RGB, GL_FLOAT, NULL);
+            break;
+        case 2:
+            glTexSubImage2D(m_target, 0, 0, offset, m_res, depth, GL_RGB, GL_FLOAT, NULL);
+            break;
+        case 3:
+            glTexSubImage3D(m_target, 0, 0, 0, offset, m_res, m_res, depth, GL_RGB, GL_FLOAT, NULL);
+            break;
+        }
+        glDeleteBuffers(1, &m_slabBuffers[m_slabsUploaded]);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (m_slabsUploaded == m_slabBuffers.size()) {
+        // The slabs only fill the top level, the GL has to build the rest
+        if (m_mipmaps) glGenerateMipmap(m_target);
+        m_generation.get();
+        m_slabBuffers.clear();
+        m_slabData.clear();
+        glDeleteTextures(1, &m_placeholderID);
+        m_placeholderID = 0;
+    }
+    return ready();
 }
 
 #endif // NOISETEXTURE_H
@@ -16,15 +16,25 @@ public:
                                 size_t /*resolution*/ = 64);
 
     /// Dtor
-    ~PerlinNoiseTexture() {}
+    ~PerlinNoiseTexture() {this->stopGenerating();}
 
 protected:
     /// Generates the data using simplex noise
     inline GLfloat generator_func(const typename NoiseTexture<DIM>::CoordinateArrayf &);
 
+    /// Generates a whole batch through libnoise's batched evaluation
+    void generator_batch(const GLfloat */*x*/,
+                         const GLfloat */*y*/,
+                         const GLfloat */*z*/,
+                         GLfloat */*out*/,
+                         size_t /*count*/);
+
     /// Precompute the inverse resolution for the purposes of coordinate generation
     float m_inv_resf;
 
+    /// The module settings, for the disk cache
+    std::string cacheKey() const;
+
     /// Perlin noise module from libnoise
     noise::module::Perlin m_module;
 
@@ -59,6 +69,37 @@ inline GLfloat PerlinNoiseTexture<3>::generator_func(const typename NoiseTexture
     return scaleNoise(m_module.GetValue(coordf[0], coordf[1], coordf[2]));
 }
 
+template<size_t DIM>
+void PerlinNoiseTexture<DIM>::generator_batch(const GLfloat *_x,
+                                              const GLfloat *_y,
+                                              const GLfloat *_z,
+                                              GLfloat *_out,
+                                              size_t _count) {
+    // There's only a generator_func() for 2 and 3 dimensions
+    if (DIM < 2) {
+        NoiseTexture<DIM>::generator_batch(_x, _y, _z, _out, _count);
+        return;
+    }
+    m_module.GetValues(_x, _y, _z, _out, _count);
+    for (size_t i=0; i<_count; ++i) {
+        _out[i] = scaleNoise(_out[i]);
+    }
+}
+
+template<size_t DIM>
+std::string PerlinNoiseTexture<DIM>::cacheKey() const {
+    std::ostringstream key;
+    key << std::setprecision(17) << "perlin "
+        << m_module.GetFrequency() << ' '
+        << m_module.GetLacunarity() << ' '
+        << m_module.GetNoiseQuality() << ' '
+        << m_module.GetNoisePrecision() << ' '
+        << m_module.GetOctaveCount() << ' '
+        << m_module.GetPersistence() << ' '
+        << m_module.GetSeed();
+    return key.str();
+}
+
 template<size_t DIM>
 float PerlinNoiseTexture<DIM>::scaleNoise(float _v) {
     // Note that libnoise returns a value between -1 and 1 so this needs to be corrected
@@ -21,7 +21,7 @@ public:
                                  size_t /*resolution*/ = 64);
 
     /// Dtor
-    ~SimplexNoiseTexture() {}
+    ~SimplexNoiseTexture() {this->stopGenerating();}
 
 protected:
     /// Parameters required for simplex noise generation
@@ -32,6 +32,16 @@ protected:
     /// Generates the data using simplex noise
     inline GLfloat generator_func(const typename NoiseTexture<DIM>::CoordinateArrayf &);
 
+    /// Generates a whole batch through the SIMD batch kernels
+    void generator_batch(const GLfloat */*x*/,
+                         const GLfloat */*y*/,
+                         const GLfloat */*z*/,
+                         GLfloat */*out*/,
+                         size_t /*count*/);
+
+    /// The noise parameters, for the disk cache
+    std::string cacheKey() const;
+
     /// Precompute the inverse resolution for the purposes of coordinate generation
     float m_inv_resf;
 };
@@ -53,6 +63,36 @@ SimplexNoiseTexture<DIM>::SimplexNoiseTexture(float _octaves,
 {
 }
 
+template<size_t DIM>
+void SimplexNoiseTexture<DIM>::generator_batch(const GLfloat *_x,
+                                               const GLfloat *_y,
+                                               const GLfloat *_z,
+                                               GLfloat *_out,
+                                               size_t _count) {
+    switch(DIM) {
+    case 2:
+        scaled_octave_noise_2d_batch(m_octaves, m_persistence, m_scale, this->m_lower, this->m_upper,
+                                     _x, _y, _out, int(_count));
+        break;
+    case 3:
+        scaled_octave_noise_3d_batch(m_octaves, m_persistence, m_scale, this->m_lower, this->m_upper,
+                                     _x, _y, _z, _out, int(_count));
+        break;
+    default:
+        // There's only a generator_func() for 2 and 3 dimensions
+        NoiseTexture<DIM>::generator_batch(_x, _y, _z, _out, _count);
+        break;
+    }
+}
+
+template<size_t DIM>
+std::string SimplexNoiseTexture<DIM>::cacheKey() const {
+    // The batch kernels round slightly differently to the old per texel path
+    std::ostringstream key;
+    key << std::setprecision(9) << "simplex batch " << m_octaves << ' ' << m_persistence << ' ' << m_scale;
+    return key.str();
+}
+
 //template<>
 //GLfloat SimplexNoiseTexture<1>::generator_func(const typename NoiseTexture<1>::CoordinateArrayf &coordf) {
 //    return scaled_octave_noise_1d(m_octaves,
@@ -51,12 +51,18 @@ public:
                                size_t /*resolution*/ = 64);
 
     /// Dtor
-    ~WhiteNoiseTexture() {}
+    ~WhiteNoiseTexture() {this->stopGenerating();}
 
 protected:
     /// Specialisation of this class to generate pure white noise
     inline GLfloat generator_func(const typename NoiseTexture<DIM>::CoordinateArrayf &);
 
+    /// The generator below draws from one shared sequence so it can't be run in parallel
+    bool isThreadSafe() const {return false;}
+
+    /// The sequence always starts from the same seed, so the texels only depend on the bounds
+    std::string cacheKey() const {return "white minstd_rand 42";}
+
     /// Boost seed function
     base_generator_type m_seed;
 
@@ -0,0 +1,68 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/**
+ * @brief The WorkStealingPool class
+ * A fixed set of worker threads, each with its own queue of task indices. A worker
+ * takes work from the front of its own queue and, once that runs dry, steals from
+ * the back of somebody else's. The calling thread joins in as worker 0, so a pool
+ * of one thread simply runs everything inline.
+ */
+class WorkStealingPool
+{
+public:
+    /// Construct the pool, 0 threads means one per hardware thread
+    explicit WorkStealingPool(size_t /*numThreads*/ = 0);
+
+    /// Stops and joins the workers
+    ~WorkStealingPool();
+
+    /// Run _task(i) for every i in _costs.size() and wait for them all. Tasks are dealt
+    /// out biggest first, each to the least loaded queue, using _costs as the estimate
+    /// of how much work each one is. Stealing takes care of whatever the estimate missed.
+    void run(const std::vector<size_t> &/*costs*/, const std::function<void(size_t)> &/*task*/);
+
+    /// Run _task(i) for i in [0,_count), assuming every task costs the same
+    void parallelFor(size_t /*count*/, const std::function<void(size_t)> &/*task*/);
+
+    /// Number of threads (including the calling thread) that do work
+    size_t numThreads() const {return m_queues.size();}
+
+private:
+    /// A queue of task indices owned by one worker
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    /// The loop each background thread sits in
+    void workerLoop(size_t /*id*/);
+
+    /// Run one task from our own queue or a stolen one, returns false if there's nothing left
+    bool runOne(size_t /*id*/);
+
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+
+    /// The task of the current (or last) run() call, set before its tasks are queued
+    const std::function<void(size_t)> *m_task = nullptr;
+
+    /// Wakes workers when a new batch is posted and the caller when it's finished
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    size_t m_generation = 0;
+    std::atomic<size_t> m_remaining;
+    bool m_quit = false;
+};
+
+#endif // WORKSTEALINGPOOL_H
@@ -44,6 +44,7 @@ HEADERS += src/basictypes.h \
            src/module/multiply.h \
            src/module/perlin.h \
            src/module/power.h \
+           src/module/program.h \
            src/module/ridgedmulti.h \
            src/module/rotatepoint.h \
            src/module/scalebias.h \
@@ -79,6 +80,7 @@ SOURCES += src/latlon.cpp \
            src/module/multiply.cpp \
            src/module/perlin.cpp \
            src/module/power.cpp \
+           src/module/program.cpp \
            src/module/ridgedmulti.cpp \
            src/module/rotatepoint.cpp \
            src/module/scalebias.cpp \
@@ -69,6 +69,18 @@ namespace noise
     return ((1.0 - a) * n0) + (a * n1);
   }
 
+  /// Performs linear interpolation between two single-precision values.
+  ///
+  /// @param n0 The first value.
+  /// @param n1 The second value.
+  /// @param a The alpha value.
+  ///
+  /// @returns The interpolated value.
+  inline float LinearInterp (float n0, float n1, float a)
+  {
+    return ((1.0f - a) * n0) + (a * n1);
+  }
+
   /// Maps a value onto a cubic S-curve.
   ///
   /// @param a The value to map onto a cubic S-curve.
@@ -84,6 +96,16 @@ namespace noise
     return (a * a * (3.0 - 2.0 * a));
   }
 
+  /// Maps a single-precision value onto a cubic S-curve.
+  ///
+  /// @param a The value to map onto a cubic S-curve.
+  ///
+  /// @returns The mapped value.
+  inline float SCurve3 (float a)
+  {
+    return (a * a * (3.0f - 2.0f * a));
+  }
+
   /// Maps a value onto a quintic S-curve.
   ///
   /// @param a The value to map onto a quintic S-curve.
@@ -105,6 +127,19 @@ namespace noise
     return (6.0 * a5) - (15.0 * a4) + (10.0 * a3);
   }
 
+  /// Maps a single-precision value onto a quintic S-curve.
+  ///
+  /// @param a The value to map onto a quintic S-curve.
+  ///
+  /// @returns The mapped value.
+  inline float SCurve5 (float a)
+  {
+    float a3 = a * a * a;
+    float a4 = a3 * a;
+    float a5 = a4 * a;
+    return (6.0f * a5) - (15.0f * a4) + (10.0f * a3);
+  }
+
   // @}
 
 }
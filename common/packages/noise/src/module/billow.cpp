@@ -29,17 +29,21 @@ Billow::Billow ():
   m_frequency    (DEFAULT_BILLOW_FREQUENCY   ),
   m_lacunarity   (DEFAULT_BILLOW_LACUNARITY  ),
   m_noiseQuality (DEFAULT_BILLOW_QUALITY     ),
+  m_noisePrecision (DEFAULT_BILLOW_PRECISION),
   m_octaveCount  (DEFAULT_BILLOW_OCTAVE_COUNT),
   m_persistence  (DEFAULT_BILLOW_PERSISTENCE ),
   m_seed         (DEFAULT_BILLOW_SEED)
 {
 }
 
-double Billow::GetValue (double x, double y, double z) const
+// The octave coordinates stay in double precision whatever the precision of
+// the noise, so that high octaves don't lose their fractional part.
+template <class Real>
+double Billow::GenerateValue (double x, double y, double z) const
 {
-  double value = 0.0;
-  double signal = 0.0;
-  double curPersistence = 1.0;
+  Real value = 0.0;
+  Real signal = 0.0;
+  Real curPersistence = 1.0;
   double nx, ny, nz;
   int seed;
 
@@ -58,17 +62,77 @@ double Billow::GetValue (double x, double y, double z) const
     // Get the coherent-noise value from the input value and add it to the
     // final result.
     seed = (m_seed + curOctave) & 0xffffffff;
-    signal = GradientCoherentNoise3D (nx, ny, nz, seed, m_noiseQuality);
-    signal = 2.0 * fabs (signal) - 1.0;
+    signal = GradientCoherentNoise3D ((Real)nx, (Real)ny, (Real)nz, seed,
+      m_noiseQuality);
+    signal = (Real)2.0 * fabs (signal) - (Real)1.0;
     value += signal * curPersistence;
 
     // Prepare the next octave.
     x *= m_lacunarity;
     y *= m_lacunarity;
     z *= m_lacunarity;
-    curPersistence *= m_persistence;
+    curPersistence *= (Real)m_persistence;
   }
-  value += 0.5;
+  value += (Real)0.5;
 
   return value;
 }
+
+template <class Real>
+void Billow::GenerateBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  double cx[NOISE_BLOCK_SIZE], cy[NOISE_BLOCK_SIZE], cz[NOISE_BLOCK_SIZE];
+  Real nx[NOISE_BLOCK_SIZE], ny[NOISE_BLOCK_SIZE], nz[NOISE_BLOCK_SIZE];
+  Real signal[NOISE_BLOCK_SIZE], value[NOISE_BLOCK_SIZE];
+  for (int i = 0; i < count; i++) {
+    cx[i] = x[i] * m_frequency;
+    cy[i] = y[i] * m_frequency;
+    cz[i] = z[i] * m_frequency;
+    value[i] = 0.0;
+  }
+
+  Real curPersistence = 1.0;
+  for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+    for (int i = 0; i < count; i++) {
+      nx[i] = (Real)MakeInt32Range (cx[i]);
+      ny[i] = (Real)MakeInt32Range (cy[i]);
+      nz[i] = (Real)MakeInt32Range (cz[i]);
+    }
+
+    int seed = (m_seed + curOctave) & 0xffffffff;
+    GradientCoherentNoise3DBlock (nx, ny, nz, count, seed, m_noiseQuality,
+      signal);
+    for (int i = 0; i < count; i++) {
+      value[i] += ((Real)2.0 * fabs (signal[i]) - (Real)1.0) * curPersistence;
+      cx[i] *= m_lacunarity;
+      cy[i] *= m_lacunarity;
+      cz[i] *= m_lacunarity;
+    }
+    curPersistence *= (Real)m_persistence;
+  }
+
+  for (int i = 0; i < count; i++) {
+    out[i] = value[i] + (Real)0.5;
+  }
+}
+
+double Billow::GetValue (double x, double y, double z) const
+{
+  if (m_noisePrecision == PRECISION_SINGLE) {
+    return GenerateValue<float> (x, y, z);
+  }
+  return GenerateValue<double> (x, y, z);
+}
+
+void Billow::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  if (m_noisePrecision == PRECISION_SINGLE) {
+    GenerateBlock<float> (x, y, z, out, count);
+  } else {
+    GenerateBlock<double> (x, y, z, out, count);
+  }
+}
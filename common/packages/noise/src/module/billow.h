@@ -57,6 +57,9 @@ namespace noise
     /// Default noise quality for the the noise::module::Billow noise module.
     const noise::NoiseQuality DEFAULT_BILLOW_QUALITY = QUALITY_STD;
 
+    /// Default noise precision for the noise::module::Billow noise module.
+    const noise::NoisePrecision DEFAULT_BILLOW_PRECISION = PRECISION_DOUBLE;
+
     /// Default noise seed for the the noise::module::Billow noise module.
     const int DEFAULT_BILLOW_SEED = 0;
 
@@ -128,6 +131,16 @@ namespace noise
           return m_noiseQuality;
         }
 
+        /// Returns the floating-point precision of the billowy noise.
+        ///
+        /// @returns The precision of the billowy noise.
+        ///
+        /// See noise::NoisePrecision for definitions of the precisions.
+        noise::NoisePrecision GetNoisePrecision () const
+        {
+          return m_noisePrecision;
+        }
+
         /// Returns the number of octaves that generate the billowy noise.
         ///
         /// @returns The number of octaves that generate the billowy noise.
@@ -164,6 +177,9 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
         /// Sets the frequency of the first octave.
         ///
         /// @param frequency The frequency of the first octave.
@@ -197,6 +213,18 @@ namespace noise
           m_noiseQuality = noiseQuality;
         }
 
+        /// Sets the floating-point precision of the billowy noise.
+        ///
+        /// @param noisePrecision The precision of the billowy noise.
+        ///
+        /// Single precision is roughly twice as fast through GetValues() and
+        /// is plenty for textures and animation.  See noise::NoisePrecision
+        /// for how far the values stray from double precision.
+        void SetNoisePrecision (noise::NoisePrecision noisePrecision)
+        {
+          m_noisePrecision = noisePrecision;
+        }
+
         /// Sets the number of octaves that generate the billowy noise.
         ///
         /// @param octaveCount The number of octaves that generate the billowy
@@ -244,6 +272,17 @@ namespace noise
 
       protected:
 
+        /// Generates the output value for the specified input value,
+        /// computing the coherent noise in the floating-point type @a Real.
+        template <class Real>
+        double GenerateValue (double x, double y, double z) const;
+
+        /// Generates the output values for a block of input values,
+        /// computing the coherent noise in the floating-point type @a Real.
+        template <class Real>
+        void GenerateBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
         /// Frequency of the first octave.
         double m_frequency;
 
@@ -253,6 +292,9 @@ namespace noise
         /// Quality of the billowy noise.
         noise::NoiseQuality m_noiseQuality;
 
+        /// Floating-point precision of the billowy noise.
+        noise::NoisePrecision m_noisePrecision;
+
         /// Total number of octaves that generate the billowy noise.
         int m_octaveCount;
 
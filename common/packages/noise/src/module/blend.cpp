@@ -36,8 +36,57 @@ double Blend::GetValue (double x, double y, double z) const
   assert (m_pSourceModule[1] != NULL);
   assert (m_pSourceModule[2] != NULL);
 
+  // At the ends of the blend only one source module is needed.
+  double alpha = (m_pSourceModule[2]->GetValue (x, y, z) + 1.0) / 2.0;
+  if (alpha == 0.0) {
+    return m_pSourceModule[0]->GetValue (x, y, z);
+  } else if (alpha == 1.0) {
+    return m_pSourceModule[1]->GetValue (x, y, z);
+  }
   double v0 = m_pSourceModule[0]->GetValue (x, y, z);
   double v1 = m_pSourceModule[1]->GetValue (x, y, z);
-  double alpha = (m_pSourceModule[2]->GetValue (x, y, z) + 1.0) / 2.0;
   return LinearInterp (v0, v1, alpha);
 }
+
+void Blend::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+  assert (m_pSourceModule[2] != NULL);
+
+  double alpha[NOISE_BLOCK_SIZE];
+  m_pSourceModule[2]->GetBlock (x, y, z, alpha, count);
+
+  // Like GetValue(), only generate each source module at the input values
+  // that need its output value.
+  int indices0[NOISE_BLOCK_SIZE], indices1[NOISE_BLOCK_SIZE];
+  int position0[NOISE_BLOCK_SIZE], position1[NOISE_BLOCK_SIZE];
+  int count0 = 0;
+  int count1 = 0;
+  for (int i = 0; i < count; i++) {
+    alpha[i] = (alpha[i] + 1.0) / 2.0;
+    position0[i] = count0;
+    position1[i] = count1;
+    if (alpha[i] != 1.0) {
+      indices0[count0++] = i;
+    }
+    if (alpha[i] != 0.0) {
+      indices1[count1++] = i;
+    }
+  }
+
+  double v0[NOISE_BLOCK_SIZE];
+  double v1[NOISE_BLOCK_SIZE];
+  GetSourceBlock (0, x, y, z, indices0, count0, v0);
+  GetSourceBlock (1, x, y, z, indices1, count1, v1);
+  for (int i = 0; i < count; i++) {
+    if (alpha[i] == 0.0) {
+      out[i] = v0[position0[i]];
+    } else if (alpha[i] == 1.0) {
+      out[i] = v1[position1[i]];
+    } else {
+      out[i] = LinearInterp (v0[position0[i]], v1[position1[i]], alpha[i]);
+    }
+  }
+}
@@ -66,6 +66,11 @@ namespace noise
     /// This noise module uses linear interpolation to perform the blending
     /// operation.
     ///
+    /// Where the output value from the control module is exactly -1.0 or
+    /// +1.0, this noise module outputs the output value from the source
+    /// module with an index value of 0 or 1, respectively, without
+    /// generating the other one.
+    ///
     /// This noise module requires three source modules.
     class Blend: public Module
     {
@@ -105,6 +110,9 @@ namespace noise
 
 	      virtual double GetValue (double x, double y, double z) const;
 
+	      virtual void GetBlock (const double* x, const double* y,
+	        const double* z, double* out, int count) const;
+
         /// Sets the control module.
         ///
         /// @param controlModule The control module.
@@ -20,13 +20,82 @@
 // off every 'zig'.)
 //
 
+#include <atomic>
+#include <memory>
+#include <string.h>
 #include "cache.h"
 
+using namespace noise;
 using namespace noise::module;
 
+namespace
+{
+
+  // An input value and the output value a Cache module cached for it.
+  struct CachedPoint
+  {
+    unsigned long long cacheId;
+    double x, y, z;
+    double value;
+  };
+
+  // A block of input values and the output values a Cache module cached for
+  // them.
+  struct CachedBlock
+  {
+    unsigned long long cacheId;
+    int count;
+    double x[NOISE_BLOCK_SIZE];
+    double y[NOISE_BLOCK_SIZE];
+    double z[NOISE_BLOCK_SIZE];
+    double value[NOISE_BLOCK_SIZE];
+  };
+
+  // Everything one thread has cached, for all of the Cache modules.  Entries
+  // with a cache ID of zero are empty.
+  struct CacheStorage
+  {
+    CachedPoint points[CACHE_POINT_COUNT];
+    CachedBlock blocks[CACHE_BLOCK_COUNT];
+  };
+
+  // Only allocated once a thread uses a Cache module.
+  thread_local std::unique_ptr<CacheStorage> t_cacheStorage;
+
+  // IDs are never reused, so values cached for a Cache module that has
+  // since been destroyed, given a new source module or invalidated are never
+  // returned.
+  std::atomic<unsigned long long> s_nextCacheId (1);
+
+  CacheStorage& GetCacheStorage ()
+  {
+    if (!t_cacheStorage) {
+      t_cacheStorage.reset (new CacheStorage ());
+    }
+    return *t_cacheStorage;
+  }
+
+  // Picks the entry in the table of cached input values for an input value.
+  int GetPointIndex (unsigned long long cacheId, double x, double y, double z)
+  {
+    unsigned long long xBits, yBits, zBits;
+    memcpy (&xBits, &x, sizeof (double));
+    memcpy (&yBits, &y, sizeof (double));
+    memcpy (&zBits, &z, sizeof (double));
+    unsigned long long hash = xBits * 0x9e3779b97f4a7c15ULL
+      ^ yBits * 0xc2b2ae3d27d4eb4fULL
+      ^ zBits * 0x165667b19e3779f9ULL
+      ^ cacheId * 0x27d4eb2f165667c5ULL;
+    hash ^= hash >> 32;
+    hash ^= hash >> 16;
+    return (int)(hash & (CACHE_POINT_COUNT - 1));
+  }
+
+}
+
 Cache::Cache ():
   Module (GetSourceModuleCount ()),
-  m_isCached (false)
+  m_cacheId (s_nextCacheId++)
 {
 }
 
@@ -34,12 +103,51 @@ double Cache::GetValue (double x, double y, double z) const
 {
   assert (m_pSourceModule[0] != NULL);
 
-  if (!(m_isCached && x == m_xCache && y == m_yCache && z == m_zCache)) {
-    m_cachedValue = m_pSourceModule[0]->GetValue (x, y, z);
-    m_xCache = x;
-    m_yCache = y;
-    m_zCache = z;
+  CachedPoint& point = GetCacheStorage ().points[
+    GetPointIndex (m_cacheId, x, y, z)];
+  if (!(point.cacheId == m_cacheId
+    && x == point.x && y == point.y && z == point.z)) {
+    point.value = m_pSourceModule[0]->GetValue (x, y, z);
+    point.cacheId = m_cacheId;
+    point.x = x;
+    point.y = y;
+    point.z = z;
   }
-  m_isCached = true;
-  return m_cachedValue;
+  return point.value;
+}
+
+void Cache::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+
+  size_t size = count * sizeof (double);
+  CachedBlock& block = GetCacheStorage ().blocks[
+    m_cacheId % CACHE_BLOCK_COUNT];
+  if (block.cacheId == m_cacheId && block.count == count
+    && memcmp (block.x, x, size) == 0
+    && memcmp (block.y, y, size) == 0
+    && memcmp (block.z, z, size) == 0) {
+    memcpy (out, block.value, size);
+    return;
+  }
+
+  m_pSourceModule[0]->GetBlock (x, y, z, out, count);
+  block.cacheId = m_cacheId;
+  block.count = count;
+  memcpy (block.x, x, size);
+  memcpy (block.y, y, size);
+  memcpy (block.z, z, size);
+  memcpy (block.value, out, size);
+}
+
+void Cache::Invalidate ()
+{
+  m_cacheId = s_nextCacheId++;
+}
+
+void Cache::SetSourceModule (int index, const Module& sourceModule)
+{
+  Module::SetSourceModule (index, sourceModule);
+  Invalidate ();
 }
@@ -41,22 +41,44 @@ namespace noise
     /// @addtogroup miscmodules
     /// @{
 
-    /// Noise module that caches the last output value generated by a source
+    /// Number of input values each thread caches for the
+    /// noise::module::Cache noise modules it uses.  Must be a power of two.
+    const int CACHE_POINT_COUNT = 1024;
+
+    /// Number of blocks of input values each thread caches for the
+    /// noise::module::Cache noise modules it uses.
+    const int CACHE_BLOCK_COUNT = 16;
+
+    /// Noise module that caches the output values generated by a source
     /// module.
     ///
-    /// If an application passes an input value to the GetValue() method that
-    /// differs from the previously passed-in input value, this noise module
-    /// instructs the source module to calculate the output value.  This
-    /// value, as well as the ( @a x, @a y, @a z ) coordinates of the input
-    /// value, are stored (cached) in this noise module.
+    /// When an application passes an input value to the GetValue() method,
+    /// this noise module looks the input value up in a table of recently
+    /// passed-in input values.  If it's there, this noise module returns the
+    /// cached output value without having the source module recalculate it.
+    /// Otherwise it instructs the source module to calculate the output
+    /// value, and stores (caches) that value along with the ( @a x, @a y,
+    /// @a z ) coordinates of the input value.
+    ///
+    /// Blocks of input values passed to the GetBlock() method are cached the
+    /// same way, a whole block at a time: if the last block this noise
+    /// module generated has the same input values, its output values are
+    /// returned.  This is the case whenever several noise modules share this
+    /// one as a source module and one batch of input values passes through
+    /// all of them.
     ///
-    /// If the application passes an input value to the GetValue() method
-    /// that is equal to the previously passed-in input value, this noise
-    /// module returns the cached output value without having the source
-    /// module recalculate the output value.
+    /// The cached values are kept per thread, so any number of threads can
+    /// generate output values from the same noise modules at once.  Each
+    /// thread has room for noise::module::CACHE_POINT_COUNT input values and
+    /// noise::module::CACHE_BLOCK_COUNT blocks, shared by all of the Cache
+    /// modules it uses.
     ///
     /// If an application passes a new source module to the SetSourceModule()
-    /// method, the cache is invalidated.
+    /// method, the cache is invalidated.  Changing the parameters of the
+    /// source module (or of any noise module it depends on) does not
+    /// invalidate the cache; the application must call the Invalidate()
+    /// method afterwards, or this noise module keeps returning the output
+    /// values the source module generated before the change.
     ///
     /// Caching a noise module is useful if it is used as a source module for
     /// multiple noise modules.  If a source module is not cached, the source
@@ -79,29 +101,26 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
-        virtual void SetSourceModule (int index, const Module& sourceModule)
-        {
-          Module::SetSourceModule (index, sourceModule);
-          m_isCached = false;
-        }
+        virtual void GetBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
 
-      protected:
-
-        /// The cached output value at the cached input value.
-        mutable double m_cachedValue;
+        /// Discards the output values cached for this noise module.
+        ///
+        /// Call this method after changing the parameters of the source
+        /// module, or of any noise module it depends on.  The cached values
+        /// are discarded in every thread.
+        ///
+        /// No other thread may be generating output values from this noise
+        /// module while this method is called.
+        void Invalidate ();
 
-        /// Determines if a cached output value is stored in this noise
-        /// module.
-        mutable double m_isCached;
+        virtual void SetSourceModule (int index, const Module& sourceModule);
 
-        /// @a x coordinate of the cached input value.
-        mutable double m_xCache;
-
-        /// @a y coordinate of the cached input value.
-        mutable double m_yCache;
+      protected:
 
-        /// @a z coordinate of the cached input value.
-        mutable double m_zCache;
+        /// Identifies the values cached for this noise module, in every
+        /// thread.  A new identifier invalidates all of them at once.
+        unsigned long long m_cacheId;
 
     };
 
@@ -36,3 +36,14 @@ double Checkerboard::GetValue (double x, double y, double z) const
   int iz = (int)(floor (MakeInt32Range (z)));
   return (ix & 1 ^ iy & 1 ^ iz & 1)? -1.0: 1.0;
 }
+
+void Checkerboard::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  for (int i = 0; i < count; i++) {
+    int ix = (int)(floor (MakeInt32Range (x[i])));
+    int iy = (int)(floor (MakeInt32Range (y[i])));
+    int iz = (int)(floor (MakeInt32Range (z[i])));
+    out[i] = ((ix & 1) ^ (iy & 1) ^ (iz & 1))? -1.0: 1.0;
+  }
+}
@@ -66,6 +66,9 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
     };
 
     /// @}
@@ -52,3 +52,16 @@ void Clamp::SetBounds (double lowerBound, double upperBound)
   m_lowerBound = lowerBound;
   m_upperBound = upperBound;
 }
+
+void Clamp::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+
+  m_pSourceModule[0]->GetBlock (x, y, z, out, count);
+  for (int i = 0; i < count; i++) {
+    double value = out[i];
+    value = (value < m_lowerBound? m_lowerBound: value);
+    out[i] = (value > m_upperBound? m_upperBound: value);
+  }
+}
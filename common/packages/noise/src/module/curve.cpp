@@ -76,9 +76,12 @@ double Curve::GetValue (double x, double y, double z) const
   assert (m_pSourceModule[0] != NULL);
   assert (m_controlPointCount >= 4);
 
-  // Get the output value from the source module.
-  double sourceModuleValue = m_pSourceModule[0]->GetValue (x, y, z);
+  // Get the output value from the source module and map it.
+  return MapValue (m_pSourceModule[0]->GetValue (x, y, z));
+}
 
+double Curve::MapValue (double sourceModuleValue) const
+{
   // Find the first element in the control point array that has an input value
   // larger than the output value from the source module.
   int indexPos;
@@ -141,3 +144,15 @@ void Curve::InsertAtPos (int insertionPos, double inputValue,
   m_pControlPoints[insertionPos].inputValue  = inputValue ;
   m_pControlPoints[insertionPos].outputValue = outputValue;
 }
+
+void Curve::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_controlPointCount >= 4);
+
+  m_pSourceModule[0]->GetBlock (x, y, z, out, count);
+  for (int i = 0; i < count; i++) {
+    out[i] = MapValue (out[i]);
+  }
+}
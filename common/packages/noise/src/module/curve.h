@@ -137,6 +137,21 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
+        /// Maps an output value from the source module onto the curve.
+        ///
+        /// @param sourceModuleValue The output value from the source module.
+        ///
+        /// @returns The value on the curve.
+        ///
+        /// @pre The number of control points on the curve is greater than or
+        /// equal to four.
+        ///
+        /// Shared by GetValue(), GetBlock() and noise::module::Program.
+        double MapValue (double sourceModuleValue) const;
+
       protected:
 
         /// Determines the array index in which to insert the control point
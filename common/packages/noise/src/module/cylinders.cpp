@@ -42,3 +42,18 @@ double Cylinders::GetValue (double x, double y, double z) const
   double nearestDist = GetMin (distFromSmallerSphere, distFromLargerSphere);
   return 1.0 - (nearestDist * 4.0); // Puts it in the -1.0 to +1.0 range.
 }
+
+void Cylinders::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  for (int i = 0; i < count; i++) {
+    double cx = x[i] * m_frequency;
+    double cz = z[i] * m_frequency;
+
+    double distFromCenter = sqrt (cx * cx + cz * cz);
+    double distFromSmallerSphere = distFromCenter - floor (distFromCenter);
+    double distFromLargerSphere = 1.0 - distFromSmallerSphere;
+    double nearestDist = GetMin (distFromSmallerSphere, distFromLargerSphere);
+    out[i] = 1.0 - (nearestDist * 4.0);
+  }
+}
@@ -46,3 +46,26 @@ double Displace::GetValue (double x, double y, double z) const
   // the original input value.
   return m_pSourceModule[0]->GetValue (xDisplace, yDisplace, zDisplace);
 }
+
+void Displace::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+  assert (m_pSourceModule[2] != NULL);
+  assert (m_pSourceModule[3] != NULL);
+
+  double xDisplace[NOISE_BLOCK_SIZE];
+  double yDisplace[NOISE_BLOCK_SIZE];
+  double zDisplace[NOISE_BLOCK_SIZE];
+  m_pSourceModule[1]->GetBlock (x, y, z, xDisplace, count);
+  m_pSourceModule[2]->GetBlock (x, y, z, yDisplace, count);
+  m_pSourceModule[3]->GetBlock (x, y, z, zDisplace, count);
+  for (int i = 0; i < count; i++) {
+    xDisplace[i] = x[i] + xDisplace[i];
+    yDisplace[i] = y[i] + yDisplace[i];
+    zDisplace[i] = z[i] + zDisplace[i];
+  }
+
+  m_pSourceModule[0]->GetBlock (xDisplace, yDisplace, zDisplace, out, count);
+}
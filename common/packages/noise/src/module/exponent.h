@@ -85,6 +85,9 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
         /// Sets the exponent value to apply to the output value from the
         /// source module.
         ///
@@ -39,3 +39,17 @@ double Min::GetValue (double x, double y, double z) const
   double v1 = m_pSourceModule[1]->GetValue (x, y, z);
   return GetMin (v0, v1);
 }
+
+void Min::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+
+  double v1[NOISE_BLOCK_SIZE];
+  m_pSourceModule[0]->GetBlock (x, y, z, out, count);
+  m_pSourceModule[1]->GetBlock (x, y, z, v1, count);
+  for (int i = 0; i < count; i++) {
+    out[i] = GetMin (out[i], v1[i]);
+  }
+}
@@ -41,6 +41,7 @@
 #include "multiply.h"
 #include "perlin.h"
 #include "power.h"
+#include "program.h"
 #include "ridgedmulti.h"
 #include "rotatepoint.h"
 #include "scalebias.h"
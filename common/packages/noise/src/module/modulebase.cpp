@@ -20,6 +20,7 @@
 // off every 'zig'.)
 //
 
+#include "../misc.h"
 #include "modulebase.h"
 
 using namespace noise::module;
@@ -44,3 +45,51 @@ Module::~Module ()
 {
   delete[] m_pSourceModule;
 }
+
+void Module::GetValues (const float* xs, const float* ys, const float* zs,
+  float* out, size_t count) const
+{
+  double x[NOISE_BLOCK_SIZE];
+  double y[NOISE_BLOCK_SIZE];
+  double z[NOISE_BLOCK_SIZE];
+  double value[NOISE_BLOCK_SIZE];
+
+  for (size_t start = 0; start < count; start += NOISE_BLOCK_SIZE) {
+    int blockCount = (int)GetMin (count - start, (size_t)NOISE_BLOCK_SIZE);
+    for (int i = 0; i < blockCount; i++) {
+      x[i] = xs[start + i];
+      y[i] = ys[start + i];
+      z[i] = zs[start + i];
+    }
+    GetBlock (x, y, z, value, blockCount);
+    for (int i = 0; i < blockCount; i++) {
+      out[start + i] = (float)value[i];
+    }
+  }
+}
+
+void Module::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  for (int i = 0; i < count; i++) {
+    out[i] = GetValue (x[i], y[i], z[i]);
+  }
+}
+
+void Module::GetSourceBlock (int index, const double* x, const double* y,
+  const double* z, const int* indices, int count, double* out) const
+{
+  assert (m_pSourceModule[index] != NULL);
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  if (count == 0) {
+    return;
+  }
+  double px[NOISE_BLOCK_SIZE], py[NOISE_BLOCK_SIZE], pz[NOISE_BLOCK_SIZE];
+  for (int i = 0; i < count; i++) {
+    px[i] = x[indices[i]];
+    py[i] = y[indices[i]];
+    pz[i] = z[indices[i]];
+  }
+  m_pSourceModule[index]->GetBlock (px, py, pz, out, count);
+}
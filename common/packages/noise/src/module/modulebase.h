@@ -295,6 +295,46 @@ namespace noise
         /// module, call the GetSourceModuleCount() method.
         virtual double GetValue (double x, double y, double z) const = 0;
 
+        /// Generates the output values for a batch of input values.
+        ///
+        /// @param xs The @a x coordinates of the input values.
+        /// @param ys The @a y coordinates of the input values.
+        /// @param zs The @a z coordinates of the input values.
+        /// @param out The array that receives the output values.
+        /// @param count The number of input values.
+        ///
+        /// @pre All source modules required by this noise module have been
+        /// passed to the SetSourceModule() method.
+        ///
+        /// Each output value is the value GetValue() returns for the same
+        /// input value, rounded to a float.  The batch is split into blocks
+        /// of noise::NOISE_BLOCK_SIZE input values that are passed down the
+        /// whole module tree at once through GetBlock(), so there is one
+        /// virtual call per module per block instead of one per module per
+        /// input value.
+        void GetValues (const float* xs, const float* ys, const float* zs,
+          float* out, size_t count) const;
+
+        /// Generates the output values for a block of input values.
+        ///
+        /// @param x The @a x coordinates of the input values.
+        /// @param y The @a y coordinates of the input values.
+        /// @param z The @a z coordinates of the input values.
+        /// @param out The array that receives the output values.
+        /// @param count The number of input values.
+        ///
+        /// @pre @a count is no larger than noise::NOISE_BLOCK_SIZE.
+        /// @pre All source modules required by this noise module have been
+        /// passed to the SetSourceModule() method.
+        ///
+        /// Each output value is exactly the value GetValue() returns for the
+        /// same input value.  This default implementation calls GetValue()
+        /// for each input value in turn; noise modules override it to
+        /// process the whole block at once, calling GetBlock() on their
+        /// source modules.
+        virtual void GetBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
         /// Connects a source module to this noise module.
         ///
         /// @param index An index value to assign to this source module.
@@ -336,6 +376,26 @@ namespace noise
 
       protected:
 
+        /// Generates the output values of a source module for some of the
+        /// input values in a block.
+        ///
+        /// @param index The index value assigned to the source module.
+        /// @param x The @a x coordinates of the input values in the block.
+        /// @param y The @a y coordinates of the input values in the block.
+        /// @param z The @a z coordinates of the input values in the block.
+        /// @param indices The positions in the block of the input values to
+        /// generate, in increasing order.
+        /// @param count The number of positions in @a indices.
+        /// @param out The array that receives the output values, one for
+        /// each position in @a indices.
+        ///
+        /// The selected input values are packed together and passed to the
+        /// source module's GetBlock() method, so the source module only
+        /// generates the output values that are needed.
+        void GetSourceBlock (int index, const double* x, const double* y,
+          const double* z, const int* indices, int count, double* out)
+          const;
+
         /// An array containing the pointers to each source module required by
         /// this noise module.
         const Module** m_pSourceModule;
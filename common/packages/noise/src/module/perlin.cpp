@@ -29,17 +29,21 @@ Perlin::Perlin ():
   m_frequency    (DEFAULT_PERLIN_FREQUENCY   ),
   m_lacunarity   (DEFAULT_PERLIN_LACUNARITY  ),
   m_noiseQuality (DEFAULT_PERLIN_QUALITY     ),
+  m_noisePrecision (DEFAULT_PERLIN_PRECISION),
   m_octaveCount  (DEFAULT_PERLIN_OCTAVE_COUNT),
   m_persistence  (DEFAULT_PERLIN_PERSISTENCE ),
   m_seed         (DEFAULT_PERLIN_SEED)
 {
 }
 
-double Perlin::GetValue (double x, double y, double z) const
+// The octave coordinates stay in double precision whatever the precision of
+// the noise, so that high octaves don't lose their fractional part.
+template <class Real>
+double Perlin::GenerateValue (double x, double y, double z) const
 {
-  double value = 0.0;
-  double signal = 0.0;
-  double curPersistence = 1.0;
+  Real value = 0.0;
+  Real signal = 0.0;
+  Real curPersistence = 1.0;
   double nx, ny, nz;
   int seed;
 
@@ -58,15 +62,75 @@ double Perlin::GetValue (double x, double y, double z) const
     // Get the coherent-noise value from the input value and add it to the
     // final result.
     seed = (m_seed + curOctave) & 0xffffffff;
-    signal = GradientCoherentNoise3D (nx, ny, nz, seed, m_noiseQuality);
+    signal = GradientCoherentNoise3D ((Real)nx, (Real)ny, (Real)nz, seed,
+      m_noiseQuality);
     value += signal * curPersistence;
 
     // Prepare the next octave.
     x *= m_lacunarity;
     y *= m_lacunarity;
     z *= m_lacunarity;
-    curPersistence *= m_persistence;
+    curPersistence *= (Real)m_persistence;
   }
 
   return value;
 }
+
+template <class Real>
+void Perlin::GenerateBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  double cx[NOISE_BLOCK_SIZE], cy[NOISE_BLOCK_SIZE], cz[NOISE_BLOCK_SIZE];
+  Real nx[NOISE_BLOCK_SIZE], ny[NOISE_BLOCK_SIZE], nz[NOISE_BLOCK_SIZE];
+  Real signal[NOISE_BLOCK_SIZE], value[NOISE_BLOCK_SIZE];
+  for (int i = 0; i < count; i++) {
+    cx[i] = x[i] * m_frequency;
+    cy[i] = y[i] * m_frequency;
+    cz[i] = z[i] * m_frequency;
+    value[i] = 0.0;
+  }
+
+  Real curPersistence = 1.0;
+  for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+    for (int i = 0; i < count; i++) {
+      nx[i] = (Real)MakeInt32Range (cx[i]);
+      ny[i] = (Real)MakeInt32Range (cy[i]);
+      nz[i] = (Real)MakeInt32Range (cz[i]);
+    }
+
+    int seed = (m_seed + curOctave) & 0xffffffff;
+    GradientCoherentNoise3DBlock (nx, ny, nz, count, seed, m_noiseQuality,
+      signal);
+    for (int i = 0; i < count; i++) {
+      value[i] += signal[i] * curPersistence;
+      cx[i] *= m_lacunarity;
+      cy[i] *= m_lacunarity;
+      cz[i] *= m_lacunarity;
+    }
+    curPersistence *= (Real)m_persistence;
+  }
+
+  for (int i = 0; i < count; i++) {
+    out[i] = value[i];
+  }
+}
+
+double Perlin::GetValue (double x, double y, double z) const
+{
+  if (m_noisePrecision == PRECISION_SINGLE) {
+    return GenerateValue<float> (x, y, z);
+  }
+  return GenerateValue<double> (x, y, z);
+}
+
+void Perlin::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  if (m_noisePrecision == PRECISION_SINGLE) {
+    GenerateBlock<float> (x, y, z, out, count);
+  } else {
+    GenerateBlock<double> (x, y, z, out, count);
+  }
+}
@@ -36,3 +36,17 @@ double Power::GetValue (double x, double y, double z) const
   return pow (m_pSourceModule[0]->GetValue (x, y, z),
     m_pSourceModule[1]->GetValue (x, y, z));
 }
+
+void Power::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+
+  double v1[NOISE_BLOCK_SIZE];
+  m_pSourceModule[0]->GetBlock (x, y, z, out, count);
+  m_pSourceModule[1]->GetBlock (x, y, z, v1, count);
+  for (int i = 0; i < count; i++) {
+    out[i] = pow (out[i], v1[i]);
+  }
+}
@@ -0,0 +1,724 @@
+// program.cpp
+//
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation; either version 2.1 of the License, or (at
+// your option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License (COPYING.txt) for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#include <memory>
+#include <string.h>
+#include "../interp.h"
+#include "../misc.h"
+#include "abs.h"
+#include "add.h"
+#include "blend.h"
+#include "cache.h"
+#include "clamp.h"
+#include "curve.h"
+#include "displace.h"
+#include "exponent.h"
+#include "invert.h"
+#include "max.h"
+#include "min.h"
+#include "multiply.h"
+#include "power.h"
+#include "rotatepoint.h"
+#include "scalebias.h"
+#include "scalepoint.h"
+#include "select.h"
+#include "terrace.h"
+#include "translatepoint.h"
+#include "turbulence.h"
+#include "program.h"
+
+using namespace noise;
+using namespace noise::module;
+
+namespace
+{
+
+  // Returns the block of values a register refers to, or NULL for -1.
+  inline double* GetRegister (double* pRegisters, int index)
+  {
+    return (index >= 0)? pRegisters + index * NOISE_BLOCK_SIZE: NULL;
+  }
+
+}
+
+Program::Program ():
+  Module (GetSourceModuleCount ()),
+  m_valueRegisterCount (0),
+  m_pointRegisterCount (0),
+  m_scopeCount (0),
+  m_resultRegister (-1),
+  m_scope (0)
+{
+}
+
+void Program::Compile (const Module& rootModule)
+{
+  m_instructions.clear ();
+  m_valueRegisterCount = 0;
+  m_pointRegisterCount = 1;
+  m_scopeCount = 1;
+  m_resultRegister = -1;
+  m_scope = 0;
+  m_pointScope.assign (1, 0);
+  m_pointOrigin.assign (1, -1);
+
+  try {
+    m_resultRegister = CompileValue (rootModule, 0);
+  } catch (...) {
+    m_instructions.clear ();
+    m_resultRegister = -1;
+    m_compiledValues.clear ();
+    m_compiledPoints.clear ();
+    throw;
+  }
+  m_compiledValues.clear ();
+  m_compiledPoints.clear ();
+
+  AllocateRegisters ();
+}
+
+int Program::CompileValue (const Module& module, int pointRegister)
+{
+  int compiled = FindValue (module, pointRegister);
+  if (compiled >= 0) {
+    return compiled;
+  }
+
+  int result;
+  if (dynamic_cast<const Cache*> (&module) != NULL) {
+    // The program never generates a noise module twice at the same input
+    // values, so the cache has nothing to do.
+    result = CompileValue (module.GetSourceModule (0), pointRegister);
+  } else if (dynamic_cast<const Abs*> (&module) != NULL) {
+    result = EmitValue (OP_ABS, module, -1,
+      CompileValue (module.GetSourceModule (0), pointRegister));
+  } else if (dynamic_cast<const Invert*> (&module) != NULL) {
+    result = EmitValue (OP_INVERT, module, -1,
+      CompileValue (module.GetSourceModule (0), pointRegister));
+  } else if (const Clamp* pClamp = dynamic_cast<const Clamp*> (&module)) {
+    result = EmitValue (OP_CLAMP, module, -1,
+      CompileValue (module.GetSourceModule (0), pointRegister));
+    m_instructions.back ().param[0] = pClamp->GetLowerBound ();
+    m_instructions.back ().param[1] = pClamp->GetUpperBound ();
+  } else if (const ScaleBias* pScaleBias
+    = dynamic_cast<const ScaleBias*> (&module)) {
+    result = EmitValue (OP_SCALE_BIAS, module, -1,
+      CompileValue (module.GetSourceModule (0), pointRegister));
+    m_instructions.back ().param[0] = pScaleBias->GetScale ();
+    m_instructions.back ().param[1] = pScaleBias->GetBias ();
+  } else if (const Exponent* pExponent
+    = dynamic_cast<const Exponent*> (&module)) {
+    result = EmitValue (OP_EXPONENT, module, -1,
+      CompileValue (module.GetSourceModule (0), pointRegister));
+    m_instructions.back ().param[0] = pExponent->GetExponent ();
+  } else if (dynamic_cast<const Curve*> (&module) != NULL) {
+    result = EmitValue (OP_CURVE, module, -1,
+      CompileValue (module.GetSourceModule (0), pointRegister));
+  } else if (dynamic_cast<const Terrace*> (&module) != NULL) {
+    result = EmitValue (OP_TERRACE, module, -1,
+      CompileValue (module.GetSourceModule (0), pointRegister));
+  } else if (dynamic_cast<const Add*> (&module) != NULL) {
+    int source0 = CompileValue (module.GetSourceModule (0), pointRegister);
+    int source1 = CompileValue (module.GetSourceModule (1), pointRegister);
+    result = EmitValue (OP_ADD, module, -1, source0, source1);
+  } else if (dynamic_cast<const Multiply*> (&module) != NULL) {
+    int source0 = CompileValue (module.GetSourceModule (0), pointRegister);
+    int source1 = CompileValue (module.GetSourceModule (1), pointRegister);
+    result = EmitValue (OP_MULTIPLY, module, -1, source0, source1);
+  } else if (dynamic_cast<const Max*> (&module) != NULL) {
+    int source0 = CompileValue (module.GetSourceModule (0), pointRegister);
+    int source1 = CompileValue (module.GetSourceModule (1), pointRegister);
+    result = EmitValue (OP_MAX, module, -1, source0, source1);
+  } else if (dynamic_cast<const Min*> (&module) != NULL) {
+    int source0 = CompileValue (module.GetSourceModule (0), pointRegister);
+    int source1 = CompileValue (module.GetSourceModule (1), pointRegister);
+    result = EmitValue (OP_MIN, module, -1, source0, source1);
+  } else if (dynamic_cast<const Power*> (&module) != NULL) {
+    int source0 = CompileValue (module.GetSourceModule (0), pointRegister);
+    int source1 = CompileValue (module.GetSourceModule (1), pointRegister);
+    result = EmitValue (OP_POWER, module, -1, source0, source1);
+  } else if (dynamic_cast<const Blend*> (&module) != NULL) {
+    int control = CompileValue (module.GetSourceModule (2), pointRegister);
+    int branch = EmitPartition (OP_PARTITION_BLEND, module, control);
+    int source0 = CompileBranch (module.GetSourceModule (0), pointRegister,
+      branch);
+    int source1 = CompileBranch (module.GetSourceModule (1), pointRegister,
+      branch + 1);
+    result = EmitValue (OP_BLEND, module, -1, source0, source1, control);
+    m_instructions.back ().branchScope = branch;
+  } else if (const Select* pSelect = dynamic_cast<const Select*> (&module)) {
+    int control = CompileValue (module.GetSourceModule (2), pointRegister);
+    int branch = EmitPartition (OP_PARTITION_SELECT, module, control);
+    int source0 = CompileBranch (module.GetSourceModule (0), pointRegister,
+      branch);
+    int source1 = CompileBranch (module.GetSourceModule (1), pointRegister,
+      branch + 1);
+    result = EmitValue (OP_SELECT, module, -1, source0, source1, control);
+    m_instructions.back ().branchScope = branch;
+    m_instructions.back ().param[0] = pSelect->GetLowerBound ();
+    m_instructions.back ().param[1] = pSelect->GetUpperBound ();
+    m_instructions.back ().param[2] = pSelect->GetEdgeFalloff ();
+  } else if (dynamic_cast<const ScalePoint*> (&module) != NULL
+    || dynamic_cast<const TranslatePoint*> (&module) != NULL
+    || dynamic_cast<const RotatePoint*> (&module) != NULL
+    || dynamic_cast<const Turbulence*> (&module) != NULL
+    || dynamic_cast<const Displace*> (&module) != NULL) {
+    result = CompileValue (module.GetSourceModule (0),
+      CompilePoint (module, pointRegister));
+  } else {
+    result = EmitValue (OP_GENERATE, module, pointRegister);
+  }
+
+  m_compiledValues[std::make_pair (&module, pointRegister)] = result;
+  return result;
+}
+
+int Program::CompilePoint (const Module& module, int pointRegister)
+{
+  int compiled = FindPoint (module, pointRegister);
+  if (compiled >= 0) {
+    return compiled;
+  }
+
+  int result;
+  if (dynamic_cast<const ScalePoint*> (&module) != NULL) {
+    result = EmitPoint (OP_SCALE_POINT, module, pointRegister);
+  } else if (dynamic_cast<const TranslatePoint*> (&module) != NULL) {
+    result = EmitPoint (OP_TRANSLATE_POINT, module, pointRegister);
+  } else if (dynamic_cast<const RotatePoint*> (&module) != NULL) {
+    result = EmitPoint (OP_ROTATE_POINT, module, pointRegister);
+  } else if (dynamic_cast<const Turbulence*> (&module) != NULL) {
+    result = EmitPoint (OP_TURBULENCE, module, pointRegister);
+  } else {
+    assert (dynamic_cast<const Displace*> (&module) != NULL);
+    int xDisplace = CompileValue (module.GetSourceModule (1), pointRegister);
+    int yDisplace = CompileValue (module.GetSourceModule (2), pointRegister);
+    int zDisplace = CompileValue (module.GetSourceModule (3), pointRegister);
+    result = EmitPoint (OP_DISPLACE, module, pointRegister, xDisplace,
+      yDisplace, zDisplace);
+  }
+
+  m_compiledPoints[std::make_pair (&module, pointRegister)] = result;
+  return result;
+}
+
+int Program::CompileBranch (const Module& module, int pointRegister,
+  int scope)
+{
+  int outerScope = m_scope;
+  m_scope = scope;
+  int branchPoint = EmitPoint (OP_GATHER_POINT, module, pointRegister);
+  m_pointOrigin[branchPoint] = pointRegister;
+  int result = CompileValue (module, branchPoint);
+  m_scope = outerScope;
+  return result;
+}
+
+int Program::FindValue (const Module& module, int pointRegister)
+{
+  std::pair<const Module*, int> key (&module, pointRegister);
+  std::map<std::pair<const Module*, int>, int>::const_iterator compiled
+    = m_compiledValues.find (key);
+  if (compiled != m_compiledValues.end ()) {
+    return compiled->second;
+  }
+  int origin = m_pointOrigin[pointRegister];
+  if (origin < 0) {
+    return -1;
+  }
+  int outer = FindValue (module, origin);
+  if (outer < 0) {
+    return -1;
+  }
+
+  // The gather runs on the point register's scope, which may enclose the
+  // scope being compiled.
+  int innerScope = m_scope;
+  m_scope = m_pointScope[pointRegister];
+  int result = EmitValue (OP_GATHER, module, -1, outer);
+  m_scope = innerScope;
+  m_compiledValues[key] = result;
+  return result;
+}
+
+int Program::FindPoint (const Module& module, int pointRegister)
+{
+  std::pair<const Module*, int> key (&module, pointRegister);
+  std::map<std::pair<const Module*, int>, int>::const_iterator compiled
+    = m_compiledPoints.find (key);
+  if (compiled != m_compiledPoints.end ()) {
+    return compiled->second;
+  }
+  int origin = m_pointOrigin[pointRegister];
+  if (origin < 0) {
+    return -1;
+  }
+  int outer = FindPoint (module, origin);
+  if (outer < 0) {
+    return -1;
+  }
+
+  int innerScope = m_scope;
+  m_scope = m_pointScope[pointRegister];
+  int result = EmitPoint (OP_GATHER_POINT, module, outer);
+  m_pointOrigin[result] = outer;
+  m_scope = innerScope;
+  m_compiledPoints[key] = result;
+  return result;
+}
+
+int Program::EmitValue (Opcode opcode, const Module& module,
+  int pointRegister, int source0, int source1, int source2)
+{
+  Instruction instruction;
+  instruction.opcode = opcode;
+  instruction.pModule = &module;
+  instruction.scope = m_scope;
+  instruction.branchScope = -1;
+  instruction.pointRegister = pointRegister;
+  instruction.sourceRegister[0] = source0;
+  instruction.sourceRegister[1] = source1;
+  instruction.sourceRegister[2] = source2;
+  instruction.resultRegister = m_valueRegisterCount++;
+  instruction.param[0] = 0.0;
+  instruction.param[1] = 0.0;
+  instruction.param[2] = 0.0;
+  m_instructions.push_back (instruction);
+  return instruction.resultRegister;
+}
+
+int Program::EmitPoint (Opcode opcode, const Module& module,
+  int pointRegister, int source0, int source1, int source2)
+{
+  Instruction instruction;
+  instruction.opcode = opcode;
+  instruction.pModule = &module;
+  instruction.scope = m_scope;
+  instruction.branchScope = -1;
+  instruction.pointRegister = pointRegister;
+  instruction.sourceRegister[0] = source0;
+  instruction.sourceRegister[1] = source1;
+  instruction.sourceRegister[2] = source2;
+  instruction.resultRegister = m_pointRegisterCount++;
+  instruction.param[0] = 0.0;
+  instruction.param[1] = 0.0;
+  instruction.param[2] = 0.0;
+  m_instructions.push_back (instruction);
+  m_pointScope.push_back (m_scope);
+  m_pointOrigin.push_back (-1);
+  return instruction.resultRegister;
+}
+
+int Program::EmitPartition (Opcode opcode, const Module& module, int control)
+{
+  Instruction instruction;
+  instruction.opcode = opcode;
+  instruction.pModule = &module;
+  instruction.scope = m_scope;
+  instruction.branchScope = m_scopeCount;
+  instruction.pointRegister = -1;
+  instruction.sourceRegister[0] = control;
+  instruction.sourceRegister[1] = -1;
+  instruction.sourceRegister[2] = -1;
+  instruction.resultRegister = -1;
+  instruction.param[0] = 0.0;
+  instruction.param[1] = 0.0;
+  instruction.param[2] = 0.0;
+  if (const Select* pSelect = dynamic_cast<const Select*> (&module)) {
+    instruction.param[0] = pSelect->GetLowerBound ();
+    instruction.param[1] = pSelect->GetUpperBound ();
+    instruction.param[2] = pSelect->GetEdgeFalloff ();
+  }
+  m_instructions.push_back (instruction);
+  m_scopeCount += 2;
+  return instruction.branchScope;
+}
+
+// Until now every instruction wrote a register of its own.  Walk the
+// program in order and hand each result a register whose last reader has
+// already run.  A result never shares a register with its own sources, so
+// no operation has to worry about reading and writing the same block.
+void Program::AllocateRegisters ()
+{
+  int instructionCount = (int)m_instructions.size ();
+
+  // The last instruction to read each register.  The output values and the
+  // input values are never released.
+  std::vector<int> lastValueRead (m_valueRegisterCount, -1);
+  std::vector<int> lastPointRead (m_pointRegisterCount, -1);
+  for (int i = 0; i < instructionCount; i++) {
+    const Instruction& instruction = m_instructions[i];
+    if (instruction.pointRegister >= 0) {
+      lastPointRead[instruction.pointRegister] = i;
+    }
+    for (int j = 0; j < 3; j++) {
+      if (instruction.sourceRegister[j] >= 0) {
+        lastValueRead[instruction.sourceRegister[j]] = i;
+      }
+    }
+  }
+  lastValueRead[m_resultRegister] = instructionCount;
+  lastPointRead[0] = instructionCount;
+
+  std::vector<int> valueRegister (m_valueRegisterCount, -1);
+  std::vector<int> pointRegister (m_pointRegisterCount, -1);
+  std::vector<int> freeValueRegisters;
+  std::vector<int> freePointRegisters;
+  int valueRegisterCount = 0;
+  int pointRegisterCount = 1;
+  pointRegister[0] = 0;
+
+  for (int i = 0; i < instructionCount; i++) {
+    Instruction& instruction = m_instructions[i];
+    bool writesPoint = (instruction.opcode >= OP_SCALE_POINT
+      && instruction.opcode <= OP_GATHER_POINT);
+
+    // Allocate the result first so it can't land on a source.
+    if (instruction.resultRegister < 0) {
+      // The partition operations write scopes, not registers.
+    } else if (writesPoint) {
+      if (freePointRegisters.empty ()) {
+        freePointRegisters.push_back (pointRegisterCount++);
+      }
+      pointRegister[instruction.resultRegister] = freePointRegisters.back ();
+      freePointRegisters.pop_back ();
+      instruction.resultRegister = pointRegister[instruction.resultRegister];
+    } else {
+      if (freeValueRegisters.empty ()) {
+        freeValueRegisters.push_back (valueRegisterCount++);
+      }
+      valueRegister[instruction.resultRegister] = freeValueRegisters.back ();
+      freeValueRegisters.pop_back ();
+      instruction.resultRegister = valueRegister[instruction.resultRegister];
+    }
+
+    // Then release the registers this instruction is the last to read.  A
+    // register read twice by the same instruction is only released once.
+    if (instruction.pointRegister >= 0) {
+      int point = instruction.pointRegister;
+      instruction.pointRegister = pointRegister[point];
+      if (lastPointRead[point] == i) {
+        freePointRegisters.push_back (pointRegister[point]);
+        lastPointRead[point] = -1;
+      }
+    }
+    for (int j = 0; j < 3; j++) {
+      int source = instruction.sourceRegister[j];
+      if (source >= 0) {
+        instruction.sourceRegister[j] = valueRegister[source];
+        if (lastValueRead[source] == i) {
+          freeValueRegisters.push_back (valueRegister[source]);
+          lastValueRead[source] = -1;
+        }
+      }
+    }
+  }
+
+  m_resultRegister = valueRegister[m_resultRegister];
+  m_valueRegisterCount = valueRegisterCount;
+  m_pointRegisterCount = pointRegisterCount;
+}
+
+double Program::GetValue (double x, double y, double z) const
+{
+  double value;
+  GetBlock (&x, &y, &z, &value, 1);
+  return value;
+}
+
+void Program::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_resultRegister >= 0);
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  // The registers are allocated for each call rather than kept in the
+  // program, so any number of threads can run it at once, and a program can
+  // be part of the graph another program was compiled from.
+  std::unique_ptr<double[]> pValues (
+    new double[m_valueRegisterCount * NOISE_BLOCK_SIZE]);
+  std::unique_ptr<double[]> pPoints (
+    new double[m_pointRegisterCount * 3 * NOISE_BLOCK_SIZE]);
+  double* pPointX = pPoints.get ();
+  double* pPointY = pPointX + m_pointRegisterCount * NOISE_BLOCK_SIZE;
+  double* pPointZ = pPointY + m_pointRegisterCount * NOISE_BLOCK_SIZE;
+
+  // Each scope's number of input values, the position in its parent scope
+  // of each of them, and the position among them of each of the parent
+  // scope's input values.  Scopes the block never reaches stay empty.
+  std::unique_ptr<int[]> pScopes (
+    new int[m_scopeCount * (1 + 2 * NOISE_BLOCK_SIZE)]);
+  int* pScopeCount = pScopes.get ();
+  int* pScopeIndices = pScopeCount + m_scopeCount;
+  int* pScopePositions = pScopeIndices + m_scopeCount * NOISE_BLOCK_SIZE;
+  pScopeCount[0] = count;
+  for (int i = 1; i < m_scopeCount; i++) {
+    pScopeCount[i] = 0;
+  }
+
+  // Point register zero holds the input values.
+  memcpy (pPointX, x, count * sizeof (double));
+  memcpy (pPointY, y, count * sizeof (double));
+  memcpy (pPointZ, z, count * sizeof (double));
+
+  for (size_t n = 0; n < m_instructions.size (); n++) {
+    const Instruction& instruction = m_instructions[n];
+    const double* px = GetRegister (pPointX, instruction.pointRegister);
+    const double* py = GetRegister (pPointY, instruction.pointRegister);
+    const double* pz = GetRegister (pPointZ, instruction.pointRegister);
+    const double* v0 = GetRegister (pValues.get (),
+      instruction.sourceRegister[0]);
+    const double* v1 = GetRegister (pValues.get (),
+      instruction.sourceRegister[1]);
+    const double* v2 = GetRegister (pValues.get (),
+      instruction.sourceRegister[2]);
+    double* result = GetRegister (pValues.get (), instruction.resultRegister);
+    double* resultX = GetRegister (pPointX, instruction.resultRegister);
+    double* resultY = GetRegister (pPointY, instruction.resultRegister);
+    double* resultZ = GetRegister (pPointZ, instruction.resultRegister);
+
+    // Nothing to do if the scope has no input values in this block.
+    int scopeCount = pScopeCount[instruction.scope];
+    if (scopeCount == 0) {
+      continue;
+    }
+    const int* indices = pScopeIndices + instruction.scope * NOISE_BLOCK_SIZE;
+    const int* position0 = NULL;
+    const int* position1 = NULL;
+    if (instruction.branchScope >= 0) {
+      position0 = pScopePositions
+        + instruction.branchScope * NOISE_BLOCK_SIZE;
+      position1 = position0 + NOISE_BLOCK_SIZE;
+    }
+
+    // Each operation matches the GetBlock() method of its noise module.
+    // The selector operations read their source modules' output values
+    // from the positions of their input values in the branch scopes.
+    switch (instruction.opcode) {
+      case OP_GENERATE:
+        instruction.pModule->GetBlock (px, py, pz, result, scopeCount);
+        break;
+      case OP_ABS:
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = fabs (v0[i]);
+        }
+        break;
+      case OP_INVERT:
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = -v0[i];
+        }
+        break;
+      case OP_CLAMP: {
+        double lowerBound = instruction.param[0];
+        double upperBound = instruction.param[1];
+        for (int i = 0; i < scopeCount; i++) {
+          double value = (v0[i] < lowerBound? lowerBound: v0[i]);
+          result[i] = (value > upperBound? upperBound: value);
+        }
+        break;
+      }
+      case OP_SCALE_BIAS: {
+        double scale = instruction.param[0];
+        double bias = instruction.param[1];
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = v0[i] * scale + bias;
+        }
+        break;
+      }
+      case OP_EXPONENT: {
+        double exponent = instruction.param[0];
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = (pow (fabs ((v0[i] + 1.0) / 2.0), exponent) * 2.0
+            - 1.0);
+        }
+        break;
+      }
+      case OP_CURVE: {
+        const Curve* pCurve = static_cast<const Curve*> (instruction.pModule);
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = pCurve->MapValue (v0[i]);
+        }
+        break;
+      }
+      case OP_TERRACE: {
+        const Terrace* pTerrace
+          = static_cast<const Terrace*> (instruction.pModule);
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = pTerrace->MapValue (v0[i]);
+        }
+        break;
+      }
+      case OP_ADD:
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = v0[i] + v1[i];
+        }
+        break;
+      case OP_MULTIPLY:
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = v0[i] * v1[i];
+        }
+        break;
+      case OP_MAX:
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = GetMax (v0[i], v1[i]);
+        }
+        break;
+      case OP_MIN:
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = GetMin (v0[i], v1[i]);
+        }
+        break;
+      case OP_POWER:
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = pow (v0[i], v1[i]);
+        }
+        break;
+      case OP_BLEND:
+        for (int i = 0; i < scopeCount; i++) {
+          double alpha = (v2[i] + 1.0) / 2.0;
+          if (alpha == 0.0) {
+            result[i] = v0[position0[i]];
+          } else if (alpha == 1.0) {
+            result[i] = v1[position1[i]];
+          } else {
+            result[i] = LinearInterp (v0[position0[i]], v1[position1[i]],
+              alpha);
+          }
+        }
+        break;
+      case OP_SELECT: {
+        double lowerBound = instruction.param[0];
+        double upperBound = instruction.param[1];
+        double edgeFalloff = instruction.param[2];
+        if (edgeFalloff > 0.0) {
+          double lowerLow = lowerBound - edgeFalloff;
+          double lowerHigh = lowerBound + edgeFalloff;
+          double upperLow = upperBound - edgeFalloff;
+          double upperHigh = upperBound + edgeFalloff;
+          for (int i = 0; i < scopeCount; i++) {
+            double controlValue = v2[i];
+            if (controlValue < lowerLow) {
+              result[i] = v0[position0[i]];
+            } else if (controlValue < lowerHigh) {
+              double alpha = SCurve3 (
+                (controlValue - lowerLow) / (lowerHigh - lowerLow));
+              result[i] = LinearInterp (v0[position0[i]], v1[position1[i]],
+                alpha);
+            } else if (controlValue < upperLow) {
+              result[i] = v1[position1[i]];
+            } else if (controlValue < upperHigh) {
+              double alpha = SCurve3 (
+                (controlValue - upperLow) / (upperHigh - upperLow));
+              result[i] = LinearInterp (v1[position1[i]], v0[position0[i]],
+                alpha);
+            } else {
+              result[i] = v0[position0[i]];
+            }
+          }
+        } else {
+          for (int i = 0; i < scopeCount; i++) {
+            result[i] = (v2[i] < lowerBound || v2[i] > upperBound)?
+              v0[position0[i]]: v1[position1[i]];
+          }
+        }
+        break;
+      }
+      case OP_GATHER:
+        for (int i = 0; i < scopeCount; i++) {
+          result[i] = v0[indices[i]];
+        }
+        break;
+      case OP_SCALE_POINT:
+        static_cast<const ScalePoint*> (instruction.pModule)->TransformBlock (
+          px, py, pz, resultX, resultY, resultZ, scopeCount);
+        break;
+      case OP_TRANSLATE_POINT:
+        static_cast<const TranslatePoint*> (instruction.pModule)
+          ->TransformBlock (px, py, pz, resultX, resultY, resultZ, scopeCount);
+        break;
+      case OP_ROTATE_POINT:
+        static_cast<const RotatePoint*> (instruction.pModule)
+          ->TransformBlock (px, py, pz, resultX, resultY, resultZ, scopeCount);
+        break;
+      case OP_TURBULENCE:
+        static_cast<const Turbulence*> (instruction.pModule)->TransformBlock (
+          px, py, pz, resultX, resultY, resultZ, scopeCount);
+        break;
+      case OP_DISPLACE:
+        for (int i = 0; i < scopeCount; i++) {
+          resultX[i] = px[i] + v0[i];
+          resultY[i] = py[i] + v1[i];
+          resultZ[i] = pz[i] + v2[i];
+        }
+        break;
+      case OP_GATHER_POINT:
+        for (int i = 0; i < scopeCount; i++) {
+          resultX[i] = px[indices[i]];
+          resultY[i] = py[indices[i]];
+          resultZ[i] = pz[indices[i]];
+        }
+        break;
+      case OP_PARTITION_SELECT:
+      case OP_PARTITION_BLEND: {
+        // Sort the input values by the source modules they need, as the
+        // GetBlock() methods of noise::module::Select and
+        // noise::module::Blend do.
+        int branch = instruction.branchScope;
+        int* branchIndices0 = pScopeIndices + branch * NOISE_BLOCK_SIZE;
+        int* branchIndices1 = branchIndices0 + NOISE_BLOCK_SIZE;
+        int* branchPosition0 = pScopePositions + branch * NOISE_BLOCK_SIZE;
+        int* branchPosition1 = branchPosition0 + NOISE_BLOCK_SIZE;
+        double lowerBound = instruction.param[0];
+        double upperBound = instruction.param[1];
+        double edgeFalloff = instruction.param[2];
+        int count0 = 0;
+        int count1 = 0;
+        for (int i = 0; i < scopeCount; i++) {
+          double controlValue = v0[i];
+          bool needs0, needs1;
+          if (instruction.opcode == OP_PARTITION_BLEND) {
+            double alpha = (controlValue + 1.0) / 2.0;
+            needs0 = (alpha != 1.0);
+            needs1 = (alpha != 0.0);
+          } else if (edgeFalloff > 0.0) {
+            needs0 = !(controlValue >= lowerBound + edgeFalloff
+              && controlValue < upperBound - edgeFalloff);
+            needs1 = (controlValue >= lowerBound - edgeFalloff
+              && controlValue < upperBound + edgeFalloff);
+          } else {
+            needs0 = (controlValue < lowerBound || controlValue > upperBound);
+            needs1 = !needs0;
+          }
+          branchPosition0[i] = count0;
+          branchPosition1[i] = count1;
+          if (needs0) {
+            branchIndices0[count0++] = i;
+          }
+          if (needs1) {
+            branchIndices1[count1++] = i;
+          }
+        }
+        pScopeCount[branch] = count0;
+        pScopeCount[branch + 1] = count1;
+        break;
+      }
+    }
+  }
+
+  memcpy (out, pValues.get () + m_resultRegister * NOISE_BLOCK_SIZE,
+    count * sizeof (double));
+}
@@ -0,0 +1,279 @@
+// program.h
+//
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation; either version 2.1 of the License, or (at
+// your option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License (COPYING.txt) for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#ifndef NOISE_MODULE_PROGRAM_H
+#define NOISE_MODULE_PROGRAM_H
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "modulebase.h"
+
+namespace noise
+{
+
+  namespace module
+  {
+
+    /// @addtogroup libnoise
+    /// @{
+
+    /// @addtogroup modules
+    /// @{
+
+    /// @addtogroup miscmodules
+    /// @{
+
+    /// Noise module that generates the output values of a graph of noise
+    /// modules by running a flat program compiled from it.
+    ///
+    /// Generating an output value from a graph of noise modules walks the
+    /// graph from its root, with a virtual call per noise module, and
+    /// generates a noise module that several others use as a source module
+    /// once for each of them.  The Compile() method walks the graph once
+    /// instead, and emits an instruction for each noise module, in an order
+    /// where every noise module comes after its source modules.  A noise
+    /// module that is used more than once at the same input values gets a
+    /// single instruction, so shared sub-graphs are generated once without
+    /// having to place noise::module::Cache modules in the graph.
+    ///
+    /// The instructions work on registers that each hold a block of
+    /// noise::NOISE_BLOCK_SIZE values or input values, and GetBlock() runs
+    /// the whole program over a block at a time.  The combiner, modifier,
+    /// selector and transformer modules become tight loops over their
+    /// registers.  Generator modules, and any noise module the compiler
+    /// does not know, are generated by calling their GetBlock() method.
+    ///
+    /// The source modules of noise::module::Select and noise::module::Blend
+    /// modules are only generated at the input values that need their
+    /// output values.  Once the control module has been generated, the
+    /// input values are sorted by the source modules they need and packed
+    /// together, and each source module's instructions run on its own
+    /// packed input values.  Noise modules that were already generated for
+    /// the whole block are picked out of it rather than generated again.
+    ///
+    /// The output values are exactly those of the root of the graph.  The
+    /// program refers to the noise modules in the graph and reads some of
+    /// their parameters while compiling, so the graph must outlive the
+    /// program, and Compile() must be called again after changing the graph
+    /// or any of its noise modules.
+    ///
+    /// This noise module does not require any source modules.
+    class Program: public Module
+    {
+
+      public:
+
+        /// Constructor.
+        Program ();
+
+        /// Compiles a graph of noise modules into this program.
+        ///
+        /// @param rootModule The noise module at the root of the graph.
+        ///
+        /// @pre Every noise module in the graph has been passed all of its
+        /// source modules.
+        ///
+        /// @throw noise::ExceptionNoModule
+        /// - A noise module in the graph is missing a source module.
+        void Compile (const Module& rootModule);
+
+        virtual int GetSourceModuleCount () const
+        {
+          return 0;
+        }
+
+        virtual double GetValue (double x, double y, double z) const;
+
+        virtual void GetBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
+        /// Returns the number of instructions in this program.
+        ///
+        /// @returns The number of instructions in this program.
+        int GetInstructionCount () const
+        {
+          return (int)m_instructions.size ();
+        }
+
+      protected:
+
+        /// Operations an instruction performs.
+        enum Opcode
+        {
+          OP_GENERATE,
+          OP_ABS,
+          OP_INVERT,
+          OP_CLAMP,
+          OP_SCALE_BIAS,
+          OP_EXPONENT,
+          OP_CURVE,
+          OP_TERRACE,
+          OP_ADD,
+          OP_MULTIPLY,
+          OP_MAX,
+          OP_MIN,
+          OP_POWER,
+          OP_BLEND,
+          OP_SELECT,
+          OP_GATHER,
+          OP_SCALE_POINT,
+          OP_TRANSLATE_POINT,
+          OP_ROTATE_POINT,
+          OP_TURBULENCE,
+          OP_DISPLACE,
+          OP_GATHER_POINT,
+          OP_PARTITION_SELECT,
+          OP_PARTITION_BLEND
+        };
+
+        /// One step of the program.
+        ///
+        /// Value registers hold output values.  Point registers hold the
+        /// ( @a x, @a y, @a z ) coordinates of input values; point register
+        /// zero holds the input values passed to GetBlock().
+        ///
+        /// Every instruction runs on the input values of a scope.  Scope
+        /// zero is the whole block.  The partition operations split the
+        /// input values of their scope between two new scopes, one for each
+        /// source module of a selector module, and the gather operations
+        /// pick a scope's input values out of a register of its parent
+        /// scope.
+        struct Instruction
+        {
+
+          /// The operation to perform.
+          Opcode opcode;
+
+          /// The noise module this instruction was compiled from.
+          const Module* pModule;
+
+          /// The scope this instruction runs on.
+          int scope;
+
+          /// The first of the two scopes a partition operation writes, or
+          /// that a selector operation reads its source modules from.
+          int branchScope;
+
+          /// The point register read, or -1.
+          int pointRegister;
+
+          /// The value registers read, or -1.
+          int sourceRegister[3];
+
+          /// The register written; a point register for the transformer
+          /// operations and OP_GATHER_POINT, a value register for the
+          /// others, and -1 for the partition operations.
+          int resultRegister;
+
+          /// Parameters of the noise module, read while compiling.
+          double param[3];
+
+        };
+
+        /// Returns the value register that holds the output values of a
+        /// noise module at the input values in a point register, emitting
+        /// the instructions that generate them if there aren't any yet.
+        int CompileValue (const Module& module, int pointRegister);
+
+        /// Returns the point register that holds the input values that a
+        /// transformer module passes to its source module, emitting the
+        /// instructions that generate them if there aren't any yet.
+        int CompilePoint (const Module& module, int pointRegister);
+
+        /// Compiles a source module of a selector module in a new scope,
+        /// starting from a point register of the selector's scope.
+        int CompileBranch (const Module& module, int pointRegister,
+          int scope);
+
+        /// Returns the value register in the scope of a point register that
+        /// already holds a noise module's output values, gathering them from
+        /// an enclosing scope if need be, or -1 if there isn't one.
+        int FindValue (const Module& module, int pointRegister);
+
+        /// Returns the point register in the scope of a point register that
+        /// already holds a transformer module's input values for its source
+        /// module, gathering them from an enclosing scope if need be, or -1
+        /// if there isn't one.
+        int FindPoint (const Module& module, int pointRegister);
+
+        /// Appends an instruction that writes a new value register.
+        int EmitValue (Opcode opcode, const Module& module,
+          int pointRegister, int source0 = -1, int source1 = -1,
+          int source2 = -1);
+
+        /// Appends an instruction that writes a new point register.
+        int EmitPoint (Opcode opcode, const Module& module,
+          int pointRegister, int source0 = -1, int source1 = -1,
+          int source2 = -1);
+
+        /// Appends a partition instruction, returning the first of the two
+        /// scopes it creates.
+        int EmitPartition (Opcode opcode, const Module& module, int control);
+
+        /// Reuses registers once the last instruction that reads them has
+        /// run, so that the program needs as few registers as possible.
+        void AllocateRegisters ();
+
+        /// The program, in the order its instructions run.
+        std::vector<Instruction> m_instructions;
+
+        /// Number of value registers the program uses.
+        int m_valueRegisterCount;
+
+        /// Number of point registers the program uses, including the input
+        /// values.
+        int m_pointRegisterCount;
+
+        /// Number of scopes the program uses, including the whole block.
+        int m_scopeCount;
+
+        /// The value register that holds the output values of the root of
+        /// the graph.
+        int m_resultRegister;
+
+        /// The value register holding each noise module's output values at
+        /// the input values in each point register, while compiling.
+        std::map<std::pair<const Module*, int>, int> m_compiledValues;
+
+        /// The point register holding each transformer module's transformed
+        /// input values for each point register, while compiling.
+        std::map<std::pair<const Module*, int>, int> m_compiledPoints;
+
+        /// The scope instructions are emitted into, while compiling.
+        int m_scope;
+
+        /// The scope of each point register, while compiling.
+        std::vector<int> m_pointScope;
+
+        /// The point register of the parent scope that each point register
+        /// was gathered from, or -1, while compiling.
+        std::vector<int> m_pointOrigin;
+
+    };
+
+    /// @}
+
+    /// @}
+
+    /// @}
+
+  }
+
+}
+
+#endif
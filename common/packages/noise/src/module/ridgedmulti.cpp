@@ -29,6 +29,7 @@ RidgedMulti::RidgedMulti ():
   m_frequency    (DEFAULT_RIDGED_FREQUENCY   ),
   m_lacunarity   (DEFAULT_RIDGED_LACUNARITY  ),
   m_noiseQuality (DEFAULT_RIDGED_QUALITY     ),
+  m_noisePrecision (DEFAULT_RIDGED_PRECISION),
   m_octaveCount  (DEFAULT_RIDGED_OCTAVE_COUNT),
   m_seed         (DEFAULT_RIDGED_SEED)
 {
@@ -52,20 +53,24 @@ void RidgedMulti::CalcSpectralWeights ()
 
 // Multifractal code originally written by F. Kenton "Doc Mojo" Musgrave,
 // 1998.  Modified by jas for use with libnoise.
-double RidgedMulti::GetValue (double x, double y, double z) const
+//
+// The octave coordinates stay in double precision whatever the precision of
+// the noise, so that high octaves don't lose their fractional part.
+template <class Real>
+double RidgedMulti::GenerateValue (double x, double y, double z) const
 {
   x *= m_frequency;
   y *= m_frequency;
   z *= m_frequency;
 
-  double signal = 0.0;
-  double value  = 0.0;
-  double weight = 1.0;
+  Real signal = 0.0;
+  Real value  = 0.0;
+  Real weight = 1.0;
 
   // These parameters should be user-defined; they may be exposed in a
   // future version of libnoise.
-  double offset = 1.0;
-  double gain = 2.0;
+  Real offset = 1.0;
+  Real gain = 2.0;
 
   for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
 
@@ -78,7 +83,8 @@ double RidgedMulti::GetValue (double x, double y, double z) const
 
     // Get the coherent-noise value.
     int seed = (m_seed + curOctave) & 0x7fffffff;
-    signal = GradientCoherentNoise3D (nx, ny, nz, seed, m_noiseQuality);
+    signal = GradientCoherentNoise3D ((Real)nx, (Real)ny, (Real)nz, seed,
+      m_noiseQuality);
 
     // Make the ridges.
     signal = fabs (signal);
@@ -94,15 +100,15 @@ double RidgedMulti::GetValue (double x, double y, double z) const
 
     // Weight successive contributions by the previous signal.
     weight = signal * gain;
-    if (weight > 1.0) {
+    if (weight > (Real)1.0) {
       weight = 1.0;
     }
-    if (weight < 0.0) {
+    if (weight < (Real)0.0) {
       weight = 0.0;
     }
 
     // Add the signal to the output value.
-    value += (signal * m_pSpectralWeights[curOctave]);
+    value += (signal * (Real)m_pSpectralWeights[curOctave]);
 
     // Go to the next octave.
     x *= m_lacunarity;
@@ -110,5 +116,78 @@ double RidgedMulti::GetValue (double x, double y, double z) const
     z *= m_lacunarity;
   }
 
-  return (value * 1.25) - 1.0;
+  return (value * (Real)1.25) - (Real)1.0;
+}
+
+template <class Real>
+void RidgedMulti::GenerateBlock (const double* x, const double* y,
+  const double* z, double* out, int count) const
+{
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  double cx[NOISE_BLOCK_SIZE], cy[NOISE_BLOCK_SIZE], cz[NOISE_BLOCK_SIZE];
+  Real nx[NOISE_BLOCK_SIZE], ny[NOISE_BLOCK_SIZE], nz[NOISE_BLOCK_SIZE];
+  Real signal[NOISE_BLOCK_SIZE], weight[NOISE_BLOCK_SIZE];
+  Real value[NOISE_BLOCK_SIZE];
+  for (int i = 0; i < count; i++) {
+    cx[i] = x[i] * m_frequency;
+    cy[i] = y[i] * m_frequency;
+    cz[i] = z[i] * m_frequency;
+    weight[i] = 1.0;
+    value[i] = 0.0;
+  }
+
+  Real offset = 1.0;
+  Real gain = 2.0;
+
+  for (int curOctave = 0; curOctave < m_octaveCount; curOctave++) {
+    for (int i = 0; i < count; i++) {
+      nx[i] = (Real)MakeInt32Range (cx[i]);
+      ny[i] = (Real)MakeInt32Range (cy[i]);
+      nz[i] = (Real)MakeInt32Range (cz[i]);
+    }
+
+    int seed = (m_seed + curOctave) & 0x7fffffff;
+    GradientCoherentNoise3DBlock (nx, ny, nz, count, seed, m_noiseQuality,
+      signal);
+
+    // The same steps as GenerateValue(), with the weight clamped without
+    // branches.
+    Real spectralWeight = (Real)m_pSpectralWeights[curOctave];
+    for (int i = 0; i < count; i++) {
+      Real s = offset - fabs (signal[i]);
+      s *= s;
+      s *= weight[i];
+      Real w = s * gain;
+      w = (w > (Real)1.0? (Real)1.0: w);
+      weight[i] = (w < (Real)0.0? (Real)0.0: w);
+      value[i] += (s * spectralWeight);
+
+      cx[i] *= m_lacunarity;
+      cy[i] *= m_lacunarity;
+      cz[i] *= m_lacunarity;
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    out[i] = (value[i] * (Real)1.25) - (Real)1.0;
+  }
+}
+
+double RidgedMulti::GetValue (double x, double y, double z) const
+{
+  if (m_noisePrecision == PRECISION_SINGLE) {
+    return GenerateValue<float> (x, y, z);
+  }
+  return GenerateValue<double> (x, y, z);
+}
+
+void RidgedMulti::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  if (m_noisePrecision == PRECISION_SINGLE) {
+    GenerateBlock<float> (x, y, z, out, count);
+  } else {
+    GenerateBlock<double> (x, y, z, out, count);
+  }
 }
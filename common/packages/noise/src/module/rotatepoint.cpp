@@ -66,3 +66,24 @@ void RotatePoint::SetAngles (double xAngle, double yAngle,
   m_yAngle = yAngle;
   m_zAngle = zAngle;
 }
+
+void RotatePoint::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  double nx[NOISE_BLOCK_SIZE], ny[NOISE_BLOCK_SIZE], nz[NOISE_BLOCK_SIZE];
+  TransformBlock (x, y, z, nx, ny, nz, count);
+  m_pSourceModule[0]->GetBlock (nx, ny, nz, out, count);
+}
+
+void RotatePoint::TransformBlock (const double* x, const double* y,
+  const double* z, double* xOut, double* yOut, double* zOut, int count) const
+{
+  for (int i = 0; i < count; i++) {
+    xOut[i] = (m_x1Matrix * x[i]) + (m_y1Matrix * y[i]) + (m_z1Matrix * z[i]);
+    yOut[i] = (m_x2Matrix * x[i]) + (m_y2Matrix * y[i]) + (m_z2Matrix * z[i]);
+    zOut[i] = (m_x3Matrix * x[i]) + (m_y3Matrix * y[i]) + (m_z3Matrix * z[i]);
+  }
+}
@@ -93,6 +93,31 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
+        /// Transforms a block of input values the same way GetBlock() does
+        /// before passing them to the source module.
+        ///
+        /// @param x The @a x coordinates of the input values.
+        /// @param y The @a y coordinates of the input values.
+        /// @param z The @a z coordinates of the input values.
+        /// @param xOut The array that receives the transformed @a x
+        /// coordinates.
+        /// @param yOut The array that receives the transformed @a y
+        /// coordinates.
+        /// @param zOut The array that receives the transformed @a z
+        /// coordinates.
+        /// @param count The number of input values.
+        ///
+        /// @pre @a count is no larger than noise::NOISE_BLOCK_SIZE.
+        ///
+        /// noise::module::Program uses this method to evaluate the source
+        /// module itself.
+        void TransformBlock (const double* x, const double* y,
+          const double* z, double* xOut, double* yOut, double* zOut,
+          int count) const;
+
         /// Returns the rotation angle around the @a x axis to apply to the
         /// input value.
         ///
@@ -37,3 +37,14 @@ double ScaleBias::GetValue (double x, double y, double z) const
 
   return m_pSourceModule[0]->GetValue (x, y, z) * m_scale + m_bias;
 }
+
+void ScaleBias::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+
+  m_pSourceModule[0]->GetBlock (x, y, z, out, count);
+  for (int i = 0; i < count; i++) {
+    out[i] = out[i] * m_scale + m_bias;
+  }
+}
@@ -107,3 +107,75 @@ void Select::SetEdgeFalloff (double edgeFalloff)
   double boundSize = m_upperBound - m_lowerBound;
   m_edgeFalloff = (edgeFalloff > boundSize / 2)? boundSize / 2: edgeFalloff;
 }
+
+void Select::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (m_pSourceModule[1] != NULL);
+  assert (m_pSourceModule[2] != NULL);
+
+  double control[NOISE_BLOCK_SIZE];
+  m_pSourceModule[2]->GetBlock (x, y, z, control, count);
+
+  // Like GetValue(), only generate each source module at the input values
+  // that need its output value.  Both are needed within the edge falloff.
+  double lowerLow = m_lowerBound - m_edgeFalloff;
+  double lowerHigh = m_lowerBound + m_edgeFalloff;
+  double upperLow = m_upperBound - m_edgeFalloff;
+  double upperHigh = m_upperBound + m_edgeFalloff;
+  int indices0[NOISE_BLOCK_SIZE], indices1[NOISE_BLOCK_SIZE];
+  int position0[NOISE_BLOCK_SIZE], position1[NOISE_BLOCK_SIZE];
+  int count0 = 0;
+  int count1 = 0;
+  for (int i = 0; i < count; i++) {
+    double controlValue = control[i];
+    bool needs0, needs1;
+    if (m_edgeFalloff > 0.0) {
+      needs0 = !(controlValue >= lowerHigh && controlValue < upperLow);
+      needs1 = (controlValue >= lowerLow && controlValue < upperHigh);
+    } else {
+      needs0 = (controlValue < m_lowerBound || controlValue > m_upperBound);
+      needs1 = !needs0;
+    }
+    position0[i] = count0;
+    position1[i] = count1;
+    if (needs0) {
+      indices0[count0++] = i;
+    }
+    if (needs1) {
+      indices1[count1++] = i;
+    }
+  }
+
+  double v0[NOISE_BLOCK_SIZE];
+  double v1[NOISE_BLOCK_SIZE];
+  GetSourceBlock (0, x, y, z, indices0, count0, v0);
+  GetSourceBlock (1, x, y, z, indices1, count1, v1);
+
+  if (m_edgeFalloff > 0.0) {
+    for (int i = 0; i < count; i++) {
+      double controlValue = control[i];
+      if (controlValue < lowerLow) {
+        out[i] = v0[position0[i]];
+      } else if (controlValue < lowerHigh) {
+        double alpha = SCurve3 (
+          (controlValue - lowerLow) / (lowerHigh - lowerLow));
+        out[i] = LinearInterp (v0[position0[i]], v1[position1[i]], alpha);
+      } else if (controlValue < upperLow) {
+        out[i] = v1[position1[i]];
+      } else if (controlValue < upperHigh) {
+        double alpha = SCurve3 (
+          (controlValue - upperLow) / (upperHigh - upperLow));
+        out[i] = LinearInterp (v1[position1[i]], v0[position0[i]], alpha);
+      } else {
+        out[i] = v0[position0[i]];
+      }
+    }
+  } else {
+    for (int i = 0; i < count; i++) {
+      out[i] = (control[i] < m_lowerBound || control[i] > m_upperBound)?
+        v0[position0[i]]: v1[position1[i]];
+    }
+  }
+}
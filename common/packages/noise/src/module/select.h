@@ -170,6 +170,9 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
         /// Sets the lower and upper bounds of the selection range.
         ///
         /// @param lowerBound The lower bound.
@@ -43,3 +43,19 @@ double Spheres::GetValue (double x, double y, double z) const
   double nearestDist = GetMin (distFromSmallerSphere, distFromLargerSphere);
   return 1.0 - (nearestDist * 4.0); // Puts it in the -1.0 to +1.0 range.
 }
+
+void Spheres::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  for (int i = 0; i < count; i++) {
+    double cx = x[i] * m_frequency;
+    double cy = y[i] * m_frequency;
+    double cz = z[i] * m_frequency;
+
+    double distFromCenter = sqrt (cx * cx + cy * cy + cz * cz);
+    double distFromSmallerSphere = distFromCenter - floor (distFromCenter);
+    double distFromLargerSphere = 1.0 - distFromSmallerSphere;
+    double nearestDist = GetMin (distFromSmallerSphere, distFromLargerSphere);
+    out[i] = 1.0 - (nearestDist * 4.0);
+  }
+}
@@ -161,6 +161,22 @@ namespace noise
 
     	  virtual double GetValue (double x, double y, double z) const;
 
+    	  virtual void GetBlock (const double* x, const double* y,
+    	    const double* z, double* out, int count) const;
+
+	      /// Maps an output value from the source module onto the terrace-
+	      /// forming curve.
+	      ///
+	      /// @param sourceModuleValue The output value from the source module.
+	      ///
+	      /// @returns The value on the terrace-forming curve.
+	      ///
+	      /// @pre The number of control points is greater than or equal to
+	      /// two.
+	      ///
+	      /// Shared by GetValue(), GetBlock() and noise::module::Program.
+	      double MapValue (double sourceModuleValue) const;
+
 	      /// Creates a number of equally-spaced control points that range from
         /// -1 to +1.
 	      ///
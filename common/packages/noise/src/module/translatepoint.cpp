@@ -39,3 +39,24 @@ double TranslatePoint::GetValue (double x, double y, double z) const
   return m_pSourceModule[0]->GetValue (x + m_xTranslation, y + m_yTranslation,
     z + m_zTranslation);
 }
+
+void TranslatePoint::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  double nx[NOISE_BLOCK_SIZE], ny[NOISE_BLOCK_SIZE], nz[NOISE_BLOCK_SIZE];
+  TransformBlock (x, y, z, nx, ny, nz, count);
+  m_pSourceModule[0]->GetBlock (nx, ny, nz, out, count);
+}
+
+void TranslatePoint::TransformBlock (const double* x, const double* y,
+  const double* z, double* xOut, double* yOut, double* zOut, int count) const
+{
+  for (int i = 0; i < count; i++) {
+    xOut[i] = x[i] + m_xTranslation;
+    yOut[i] = y[i] + m_yTranslation;
+    zOut[i] = z[i] + m_zTranslation;
+  }
+}
@@ -89,3 +89,50 @@ void Turbulence::SetSeed (int seed)
   m_yDistortModule.SetSeed (seed + 1);
   m_zDistortModule.SetSeed (seed + 2);
 }
+
+void Turbulence::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (m_pSourceModule[0] != NULL);
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  double nx[NOISE_BLOCK_SIZE], ny[NOISE_BLOCK_SIZE], nz[NOISE_BLOCK_SIZE];
+  TransformBlock (x, y, z, nx, ny, nz, count);
+  m_pSourceModule[0]->GetBlock (nx, ny, nz, out, count);
+}
+
+void Turbulence::TransformBlock (const double* x, const double* y,
+  const double* z, double* xOut, double* yOut, double* zOut, int count) const
+{
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  // The same offsets as GetValue(), one distortion module at a time.  The
+  // arrays are zeroed only because GCC can't tell that the source modules
+  // never read past count.
+  double px[NOISE_BLOCK_SIZE] = {}, py[NOISE_BLOCK_SIZE] = {},
+    pz[NOISE_BLOCK_SIZE] = {};
+  for (int i = 0; i < count; i++) {
+    px[i] = x[i] + (12414.0 / 65536.0);
+    py[i] = y[i] + (65124.0 / 65536.0);
+    pz[i] = z[i] + (31337.0 / 65536.0);
+  }
+  m_xDistortModule.GetBlock (px, py, pz, xOut, count);
+  for (int i = 0; i < count; i++) {
+    px[i] = x[i] + (26519.0 / 65536.0);
+    py[i] = y[i] + (18128.0 / 65536.0);
+    pz[i] = z[i] + (60493.0 / 65536.0);
+  }
+  m_yDistortModule.GetBlock (px, py, pz, yOut, count);
+  for (int i = 0; i < count; i++) {
+    px[i] = x[i] + (53820.0 / 65536.0);
+    py[i] = y[i] + (11213.0 / 65536.0);
+    pz[i] = z[i] + (44845.0 / 65536.0);
+  }
+  m_zDistortModule.GetBlock (px, py, pz, zOut, count);
+
+  for (int i = 0; i < count; i++) {
+    xOut[i] = x[i] + (xOut[i] * m_power);
+    yOut[i] = y[i] + (yOut[i] * m_power);
+    zOut[i] = z[i] + (zOut[i] * m_power);
+  }
+}
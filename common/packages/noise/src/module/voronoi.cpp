@@ -20,11 +20,217 @@
 // off every 'zig'.)
 //
 
+#include <memory>
 #include "../mathconsts.h"
+#include "../misc.h"
 #include "voronoi.h"
 
+using namespace noise;
 using namespace noise::module;
 
+// Number of seed points each thread's seed-point cache holds.  Must be a
+// power of two.
+const int SEED_CACHE_SIZE = 1024;
+
+// Largest number of cells GetBlock() generates the seed points of in one go.
+// Blocks of input values spread over more cells than this are evaluated one
+// value at a time through the seed-point cache instead.
+const int BLOCK_SEED_CELLS = 512;
+
+// A cell is only skipped if its seed point is further away than the nearest
+// one so far by at least this much (in squared units of cells), which is far
+// more than the rounding error of any coordinate that fits in an int.
+const double SEED_PRUNE_MARGIN = 1.0e-6;
+
+namespace
+{
+
+  // A seed point held by a seed-point cache.
+  struct SeedCacheEntry
+  {
+    int x, y, z, seed;
+    bool valid;
+    double xPos, yPos, zPos;
+  };
+
+  // A direct-mapped cache of seed points, keyed by cell and seed.
+  struct SeedCache
+  {
+    SeedCacheEntry entries[SEED_CACHE_SIZE];
+  };
+
+  // Each thread has its own cache so that GetValue() can still be called
+  // from any number of threads at once.  It's only allocated on first use.
+  thread_local std::unique_ptr<SeedCache> t_seedCache;
+
+  // Looks up seed points through the calling thread's seed-point cache.
+  class CachedSeedPoints
+  {
+
+    public:
+
+      CachedSeedPoints (int seed):
+        m_seed (seed)
+      {
+        if (!t_seedCache) {
+          t_seedCache.reset (new SeedCache ());
+        }
+        m_pCache = t_seedCache.get ();
+      }
+
+      void GetSeedPoint (int x, int y, int z, double& xPos, double& yPos,
+        double& zPos) const
+      {
+        unsigned int hash = (unsigned int)x * 73856093u
+          ^ (unsigned int)y * 19349663u
+          ^ (unsigned int)z * 83492791u
+          ^ (unsigned int)m_seed * 2654435761u;
+        SeedCacheEntry& entry = m_pCache->entries[hash & (SEED_CACHE_SIZE - 1)];
+        if (!entry.valid || entry.x != x || entry.y != y || entry.z != z
+          || entry.seed != m_seed) {
+          entry.x = x;
+          entry.y = y;
+          entry.z = z;
+          entry.seed = m_seed;
+          entry.valid = true;
+          entry.xPos = x + ValueNoise3D (x, y, z, m_seed    );
+          entry.yPos = y + ValueNoise3D (x, y, z, m_seed + 1);
+          entry.zPos = z + ValueNoise3D (x, y, z, m_seed + 2);
+        }
+        xPos = entry.xPos;
+        yPos = entry.yPos;
+        zPos = entry.zPos;
+      }
+
+    private:
+
+      int m_seed;
+      SeedCache* m_pCache;
+
+  };
+
+  // Looks up seed points in a box of cells that were all generated at once.
+  class GridSeedPoints
+  {
+
+    public:
+
+      GridSeedPoints (int xMin, int yMin, int zMin, int xCells, int yCells,
+        const double* xPos, const double* yPos, const double* zPos):
+        m_xMin (xMin), m_yMin (yMin), m_zMin (zMin),
+        m_xCells (xCells), m_yCells (yCells),
+        m_pXPos (xPos), m_pYPos (yPos), m_pZPos (zPos)
+      {
+      }
+
+      void GetSeedPoint (int x, int y, int z, double& xPos, double& yPos,
+        double& zPos) const
+      {
+        int index = ((z - m_zMin) * m_yCells + (y - m_yMin)) * m_xCells
+          + (x - m_xMin);
+        xPos = m_pXPos[index];
+        yPos = m_pYPos[index];
+        zPos = m_pZPos[index];
+      }
+
+    private:
+
+      int m_xMin, m_yMin, m_zMin;
+      int m_xCells, m_yCells;
+      const double* m_pXPos;
+      const double* m_pYPos;
+      const double* m_pZPos;
+
+  };
+
+  // Returns the square of the smallest distance from the coordinate p to a
+  // seed point in a cell at the coordinate cell.  ValueNoise3D() ranges from
+  // -1.0 to +1.0, so a seed point can be up to one unit outside its cell.
+  inline double SeedPointGap (double p, int cell)
+  {
+    double below = ((double)cell - 1.0) - p;
+    double above = p - ((double)cell + 1.0);
+    double gap = (below > 0.0? below: (above > 0.0? above: 0.0));
+    return gap * gap;
+  }
+
+  // Finds the seed point nearest to the input value (x, y, z) among the
+  // cells within two of the cell the input value is in.
+  //
+  // This always finds the same seed point as visiting all 125 cells in
+  // order and keeping the first nearest one, but it works outwards from the
+  // input value's own cell one shell of cells at a time, and skips any cell
+  // that can't hold a seed point as near as the nearest one so far.  A tie
+  // goes to the cell that comes first in the full order.
+  template <class SeedPoints>
+  void FindNearestSeedPoint (double x, double y, double z,
+    const SeedPoints& seedPoints, double& xCandidate, double& yCandidate,
+    double& zCandidate)
+  {
+    int xInt = (x > 0.0? (int)x: (int)x - 1);
+    int yInt = (y > 0.0? (int)y: (int)y - 1);
+    int zInt = (z > 0.0? (int)z: (int)z - 1);
+
+    double minDist = 2147483647.0;
+    int minIndex = 0;
+    xCandidate = 0;
+    yCandidate = 0;
+    zCandidate = 0;
+
+    for (int reach = 0; reach <= 2; reach++) {
+      for (int zOffset = -reach; zOffset <= reach; zOffset++) {
+        int zCur = zInt + zOffset;
+        double zGap = SeedPointGap (z, zCur);
+        if (zGap > minDist + SEED_PRUNE_MARGIN) {
+          continue;
+        }
+        for (int yOffset = -reach; yOffset <= reach; yOffset++) {
+          int yCur = yInt + yOffset;
+          double yzGap = zGap + SeedPointGap (y, yCur);
+          if (yzGap > minDist + SEED_PRUNE_MARGIN) {
+            continue;
+          }
+          for (int xOffset = -reach; xOffset <= reach; xOffset++) {
+            // Each shell of cells only visits the cells the smaller ones
+            // didn't.
+            if (xOffset > -reach && xOffset < reach
+              && yOffset > -reach && yOffset < reach
+              && zOffset > -reach && zOffset < reach) {
+              continue;
+            }
+            int xCur = xInt + xOffset;
+            if (yzGap + SeedPointGap (x, xCur) > minDist + SEED_PRUNE_MARGIN) {
+              continue;
+            }
+
+            // Calculate the position and distance to the seed point inside
+            // of this unit cube.
+            double xPos, yPos, zPos;
+            seedPoints.GetSeedPoint (xCur, yCur, zCur, xPos, yPos, zPos);
+            double xDist = xPos - x;
+            double yDist = yPos - y;
+            double zDist = zPos - z;
+            double dist = xDist * xDist + yDist * yDist + zDist * zDist;
+
+            int index = ((zOffset + 2) * 5 + (yOffset + 2)) * 5
+              + (xOffset + 2);
+            if (dist < minDist || (dist == minDist && index < minIndex)) {
+              // This seed point is closer to any others found so far, so
+              // record this seed point.
+              minDist = dist;
+              minIndex = index;
+              xCandidate = xPos;
+              yCandidate = yPos;
+              zCandidate = zPos;
+            }
+          }
+        }
+      }
+    }
+  }
+
+}
+
 Voronoi::Voronoi ():
   Module (GetSourceModuleCount ()),
   m_displacement   (DEFAULT_VORONOI_DISPLACEMENT),
@@ -36,51 +242,24 @@ Voronoi::Voronoi ():
 
 double Voronoi::GetValue (double x, double y, double z) const
 {
-  // This method could be more efficient by caching the seed values.  Fix
-  // later.
-
   x *= m_frequency;
   y *= m_frequency;
   z *= m_frequency;
 
-  int xInt = (x > 0.0? (int)x: (int)x - 1);
-  int yInt = (y > 0.0? (int)y: (int)y - 1);
-  int zInt = (z > 0.0? (int)z: (int)z - 1);
-
-  double minDist = 2147483647.0;
-  double xCandidate = 0;
-  double yCandidate = 0;
-  double zCandidate = 0;
-
   // Inside each unit cube, there is a seed point at a random position.  Go
   // through each of the nearby cubes until we find a cube with a seed point
-  // that is closest to the specified position.
-  for (int zCur = zInt - 2; zCur <= zInt + 2; zCur++) {
-    for (int yCur = yInt - 2; yCur <= yInt + 2; yCur++) {
-      for (int xCur = xInt - 2; xCur <= xInt + 2; xCur++) {
-
-        // Calculate the position and distance to the seed point inside of
-        // this unit cube.
-        double xPos = xCur + ValueNoise3D (xCur, yCur, zCur, m_seed    );
-        double yPos = yCur + ValueNoise3D (xCur, yCur, zCur, m_seed + 1);
-        double zPos = zCur + ValueNoise3D (xCur, yCur, zCur, m_seed + 2);
-        double xDist = xPos - x;
-        double yDist = yPos - y;
-        double zDist = zPos - z;
-        double dist = xDist * xDist + yDist * yDist + zDist * zDist;
-
-        if (dist < minDist) {
-          // This seed point is closer to any others found so far, so record
-          // this seed point.
-          minDist = dist;
-          xCandidate = xPos;
-          yCandidate = yPos;
-          zCandidate = zPos;
-        }
-      }
-    }
-  }
+  // that is closest to the specified position.  Neighbouring input values
+  // share most of their cubes, so the seed points come from a cache.
+  double xCandidate, yCandidate, zCandidate;
+  FindNearestSeedPoint (x, y, z, CachedSeedPoints (m_seed), xCandidate,
+    yCandidate, zCandidate);
+
+  return GetCellValue (x, y, z, xCandidate, yCandidate, zCandidate);
+}
 
+double Voronoi::GetCellValue (double x, double y, double z,
+  double xCandidate, double yCandidate, double zCandidate) const
+{
   double value;
   if (m_enableDistance) {
     // Determine the distance to the nearest seed point.
@@ -99,3 +278,86 @@ double Voronoi::GetValue (double x, double y, double z) const
     (int)(floor (yCandidate)),
     (int)(floor (zCandidate))));
 }
+
+void Voronoi::GetBlock (const double* x, const double* y, const double* z,
+  double* out, int count) const
+{
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  double px[NOISE_BLOCK_SIZE], py[NOISE_BLOCK_SIZE], pz[NOISE_BLOCK_SIZE];
+  int xMin = 0, yMin = 0, zMin = 0, xMax = 0, yMax = 0, zMax = 0;
+  for (int i = 0; i < count; i++) {
+    px[i] = x[i] * m_frequency;
+    py[i] = y[i] * m_frequency;
+    pz[i] = z[i] * m_frequency;
+    int xInt = (px[i] > 0.0? (int)px[i]: (int)px[i] - 1);
+    int yInt = (py[i] > 0.0? (int)py[i]: (int)py[i] - 1);
+    int zInt = (pz[i] > 0.0? (int)pz[i]: (int)pz[i] - 1);
+    if (i == 0 || xInt < xMin) xMin = xInt;
+    if (i == 0 || yInt < yMin) yMin = yInt;
+    if (i == 0 || zInt < zMin) zMin = zInt;
+    if (i == 0 || xInt > xMax) xMax = xInt;
+    if (i == 0 || yInt > yMax) yMax = yInt;
+    if (i == 0 || zInt > zMax) zMax = zInt;
+  }
+
+  // The seed points any input value of the block can need are in the cells
+  // within two of the cells the input values are in.  If the block is
+  // coherent enough, generate all of them together and search those;
+  // otherwise go through the cache one input value at a time.
+  double cellCount = ((double)xMax - (double)xMin + 5.0)
+    * ((double)yMax - (double)yMin + 5.0)
+    * ((double)zMax - (double)zMin + 5.0);
+  double xCandidate, yCandidate, zCandidate;
+  if (count == 0 || cellCount > BLOCK_SEED_CELLS) {
+    CachedSeedPoints seedPoints (m_seed);
+    for (int i = 0; i < count; i++) {
+      FindNearestSeedPoint (px[i], py[i], pz[i], seedPoints, xCandidate,
+        yCandidate, zCandidate);
+      out[i] = GetCellValue (px[i], py[i], pz[i], xCandidate, yCandidate,
+        zCandidate);
+    }
+    return;
+  }
+
+  xMin -= 2;
+  yMin -= 2;
+  zMin -= 2;
+  int xCells = xMax - xMin + 3;
+  int yCells = yMax - yMin + 3;
+  int zCells = zMax - zMin + 3;
+  int cells = xCells * yCells * zCells;
+
+  double xPos[BLOCK_SEED_CELLS], yPos[BLOCK_SEED_CELLS];
+  double zPos[BLOCK_SEED_CELLS];
+  int xCell[BLOCK_SEED_CELLS], yCell[BLOCK_SEED_CELLS];
+  int zCell[BLOCK_SEED_CELLS];
+  for (int cell = 0; cell < cells; cell++) {
+    xCell[cell] = xMin + cell % xCells;
+    yCell[cell] = yMin + (cell / xCells) % yCells;
+    zCell[cell] = zMin + cell / (xCells * yCells);
+  }
+  for (int start = 0; start < cells; start += NOISE_BLOCK_SIZE) {
+    int blockCount = GetMin (cells - start, NOISE_BLOCK_SIZE);
+    const int* xc = xCell + start;
+    const int* yc = yCell + start;
+    const int* zc = zCell + start;
+    ValueNoise3DBlock (xc, yc, zc, blockCount, m_seed    , xPos + start);
+    ValueNoise3DBlock (xc, yc, zc, blockCount, m_seed + 1, yPos + start);
+    ValueNoise3DBlock (xc, yc, zc, blockCount, m_seed + 2, zPos + start);
+    for (int i = 0; i < blockCount; i++) {
+      xPos[start + i] += xc[i];
+      yPos[start + i] += yc[i];
+      zPos[start + i] += zc[i];
+    }
+  }
+
+  GridSeedPoints seedPoints (xMin, yMin, zMin, xCells, yCells, xPos, yPos,
+    zPos);
+  for (int i = 0; i < count; i++) {
+    FindNearestSeedPoint (px[i], py[i], pz[i], seedPoints, xCandidate,
+      yCandidate, zCandidate);
+    out[i] = GetCellValue (px[i], py[i], pz[i], xCandidate, yCandidate,
+      zCandidate);
+  }
+}
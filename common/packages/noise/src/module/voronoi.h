@@ -179,6 +179,9 @@ namespace noise
 
         virtual double GetValue (double x, double y, double z) const;
 
+        virtual void GetBlock (const double* x, const double* y,
+          const double* z, double* out, int count) const;
+
         /// Sets the displacement value of the Voronoi cells.
         ///
         /// @param displacement The displacement value of the Voronoi cells.
@@ -217,6 +220,23 @@ namespace noise
 
       protected:
 
+        /// Returns the output value for an input value given the seed point
+        /// nearest to it.
+        ///
+        /// @param x The @a x coordinate of the input value, already scaled
+        /// by the frequency.
+        /// @param y The @a y coordinate of the input value, already scaled
+        /// by the frequency.
+        /// @param z The @a z coordinate of the input value, already scaled
+        /// by the frequency.
+        /// @param xCandidate The @a x coordinate of the nearest seed point.
+        /// @param yCandidate The @a y coordinate of the nearest seed point.
+        /// @param zCandidate The @a z coordinate of the nearest seed point.
+        ///
+        /// @returns The output value.
+        double GetCellValue (double x, double y, double z, double xCandidate,
+          double yCandidate, double zCandidate) const;
+
         /// Scale of the random displacement to apply to each Voronoi cell.
         double m_displacement;
 
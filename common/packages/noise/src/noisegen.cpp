@@ -23,6 +23,7 @@
 #include "noisegen.h"
 #include "interp.h"
 #include "vectortable.h"
+#include <assert.h>
 
 using namespace noise;
 
@@ -55,36 +56,108 @@ const int SEED_NOISE_GEN = 1013;
 const int SHIFT_NOISE_GEN = 8;
 #endif
 
-double noise::GradientCoherentNoise3D (double x, double y, double z, int seed,
+// The core noise functions are written once as templates on the type of
+// real number they compute with, and instantiated in double precision for
+// the functions libnoise has always had and in single precision for the float
+// overloads.  The double-precision instantiations compute exactly what they
+// did before they were templates.
+
+// The gradient table in the precision of the noise being generated.
+template <class Real>
+static const Real* RandomVectors ();
+
+template <>
+const double* RandomVectors<double> ()
+{
+  return g_randomVectors;
+}
+
+template <>
+const float* RandomVectors<float> ()
+{
+  return g_randomVectorsFloat;
+}
+
+template <class Real>
+static Real GradientNoise3DT (Real fx, Real fy, Real fz, int ix, int iy,
+  int iz, int seed)
+{
+  // Randomly generate a gradient vector given the integer coordinates of the
+  // input value.  This implementation generates a random number and uses it
+  // as an index into a normalized-vector lookup table.
+  int vectorIndex = (
+      X_NOISE_GEN    * ix
+    + Y_NOISE_GEN    * iy
+    + Z_NOISE_GEN    * iz
+    + SEED_NOISE_GEN * seed)
+    & 0xffffffff;
+  vectorIndex ^= (vectorIndex >> SHIFT_NOISE_GEN);
+  vectorIndex &= 0xff;
+
+  const Real* randomVectors = RandomVectors<Real> ();
+  Real xvGradient = randomVectors[(vectorIndex << 2)    ];
+  Real yvGradient = randomVectors[(vectorIndex << 2) + 1];
+  Real zvGradient = randomVectors[(vectorIndex << 2) + 2];
+
+  // Set up us another vector equal to the distance between the two vectors
+  // passed to this function.
+  Real xvPoint = (fx - (Real)ix);
+  Real yvPoint = (fy - (Real)iy);
+  Real zvPoint = (fz - (Real)iz);
+
+  // Now compute the dot product of the gradient vector with the distance
+  // vector.  The resulting value is gradient noise.  Apply a scaling value
+  // so that this noise value ranges from -1.0 to 1.0.
+  return ((xvGradient * xvPoint)
+    + (yvGradient * yvPoint)
+    + (zvGradient * zvPoint)) * (Real)2.12;
+}
+
+// The gradient noise at one corner of a cube, given the distances from the
+// corner to the input value and the hash of the corner's coordinates, before
+// the shift and mask.  The same steps as GradientNoise3D().
+template <class Real>
+static inline Real GradientCornerNoise3DT (Real xvPoint, Real yvPoint,
+  Real zvPoint, unsigned int index)
+{
+  index ^= (index >> SHIFT_NOISE_GEN);
+  const Real* gradient = &RandomVectors<Real> ()[(index & 0xff) << 2];
+  return ((gradient[0] * xvPoint)
+    + (gradient[1] * yvPoint)
+    + (gradient[2] * zvPoint)) * (Real)2.12;
+}
+
+template <class Real>
+static Real GradientCoherentNoise3DT (Real x, Real y, Real z, int seed,
   NoiseQuality noiseQuality)
 {
   // Create a unit-length cube aligned along an integer boundary.  This cube
   // surrounds the input point.
-  int x0 = (x > 0.0? (int)x: (int)x - 1);
+  int x0 = (x > (Real)0.0? (int)x: (int)x - 1);
   int x1 = x0 + 1;
-  int y0 = (y > 0.0? (int)y: (int)y - 1);
+  int y0 = (y > (Real)0.0? (int)y: (int)y - 1);
   int y1 = y0 + 1;
-  int z0 = (z > 0.0? (int)z: (int)z - 1);
+  int z0 = (z > (Real)0.0? (int)z: (int)z - 1);
   int z1 = z0 + 1;
 
   // Map the difference between the coordinates of the input value and the
   // coordinates of the cube's outer-lower-left vertex onto an S-curve.
-  double xs = 0, ys = 0, zs = 0;
+  Real xs = 0, ys = 0, zs = 0;
   switch (noiseQuality) {
     case QUALITY_FAST:
-      xs = (x - (double)x0);
-      ys = (y - (double)y0);
-      zs = (z - (double)z0);
+      xs = (x - (Real)x0);
+      ys = (y - (Real)y0);
+      zs = (z - (Real)z0);
       break;
     case QUALITY_STD:
-      xs = SCurve3 (x - (double)x0);
-      ys = SCurve3 (y - (double)y0);
-      zs = SCurve3 (z - (double)z0);
+      xs = SCurve3 (x - (Real)x0);
+      ys = SCurve3 (y - (Real)y0);
+      zs = SCurve3 (z - (Real)z0);
       break;
     case QUALITY_BEST:
-      xs = SCurve5 (x - (double)x0);
-      ys = SCurve5 (y - (double)y0);
-      zs = SCurve5 (z - (double)z0);
+      xs = SCurve5 (x - (Real)x0);
+      ys = SCurve5 (y - (Real)y0);
+      zs = SCurve5 (z - (Real)z0);
       break;
   }
 
@@ -92,70 +165,214 @@ double noise::GradientCoherentNoise3D (double x, double y, double z, int seed,
   // the coherent-noise value at the input point, interpolate these eight
   // noise values using the S-curve value as the interpolant (trilinear
   // interpolation.)
-  double n0, n1, ix0, ix1, iy0, iy1;
-  n0   = GradientNoise3D (x, y, z, x0, y0, z0, seed);
-  n1   = GradientNoise3D (x, y, z, x1, y0, z0, seed);
+  //
+  // The hash GradientNoise3D() uses is linear in the corner coordinates, so
+  // hash the cube's outer-lower-left corner once and offset it for the rest,
+  // as GradientCoherentNoise3DBlock() does.
+  unsigned int i000 =
+      (unsigned int)X_NOISE_GEN    * (unsigned int)x0
+    + (unsigned int)Y_NOISE_GEN    * (unsigned int)y0
+    + (unsigned int)Z_NOISE_GEN    * (unsigned int)z0
+    + (unsigned int)SEED_NOISE_GEN * (unsigned int)seed;
+  unsigned int i100 = i000 + X_NOISE_GEN;
+  unsigned int i010 = i000 + Y_NOISE_GEN;
+  unsigned int i110 = i010 + X_NOISE_GEN;
+  unsigned int i001 = i000 + Z_NOISE_GEN;
+  unsigned int i101 = i001 + X_NOISE_GEN;
+  unsigned int i011 = i001 + Y_NOISE_GEN;
+  unsigned int i111 = i011 + X_NOISE_GEN;
+  Real xd0 = x - (Real)x0, xd1 = x - (Real)x1;
+  Real yd0 = y - (Real)y0, yd1 = y - (Real)y1;
+  Real zd0 = z - (Real)z0, zd1 = z - (Real)z1;
+  Real n0, n1, ix0, ix1, iy0, iy1;
+  n0   = GradientCornerNoise3DT (xd0, yd0, zd0, i000);
+  n1   = GradientCornerNoise3DT (xd1, yd0, zd0, i100);
   ix0  = LinearInterp (n0, n1, xs);
-  n0   = GradientNoise3D (x, y, z, x0, y1, z0, seed);
-  n1   = GradientNoise3D (x, y, z, x1, y1, z0, seed);
+  n0   = GradientCornerNoise3DT (xd0, yd1, zd0, i010);
+  n1   = GradientCornerNoise3DT (xd1, yd1, zd0, i110);
   ix1  = LinearInterp (n0, n1, xs);
   iy0  = LinearInterp (ix0, ix1, ys);
-  n0   = GradientNoise3D (x, y, z, x0, y0, z1, seed);
-  n1   = GradientNoise3D (x, y, z, x1, y0, z1, seed);
+  n0   = GradientCornerNoise3DT (xd0, yd0, zd1, i001);
+  n1   = GradientCornerNoise3DT (xd1, yd0, zd1, i101);
   ix0  = LinearInterp (n0, n1, xs);
-  n0   = GradientNoise3D (x, y, z, x0, y1, z1, seed);
-  n1   = GradientNoise3D (x, y, z, x1, y1, z1, seed);
+  n0   = GradientCornerNoise3DT (xd0, yd1, zd1, i011);
+  n1   = GradientCornerNoise3DT (xd1, yd1, zd1, i111);
   ix1  = LinearInterp (n0, n1, xs);
   iy1  = LinearInterp (ix0, ix1, ys);
 
   return LinearInterp (iy0, iy1, zs);
 }
 
-double noise::GradientNoise3D (double fx, double fy, double fz, int ix,
-  int iy, int iz, int seed)
+template <class Real>
+static void GradientCoherentNoise3DBlockT (const Real* x, const Real* y,
+  const Real* z, int count, int seed, NoiseQuality noiseQuality, Real* out)
 {
-  // Randomly generate a gradient vector given the integer coordinates of the
-  // input value.  This implementation generates a random number and uses it
-  // as an index into a normalized-vector lookup table.
-  int vectorIndex = (
-      X_NOISE_GEN    * ix
-    + Y_NOISE_GEN    * iy
-    + Z_NOISE_GEN    * iz
-    + SEED_NOISE_GEN * seed)
-    & 0xffffffff;
-  vectorIndex ^= (vectorIndex >> SHIFT_NOISE_GEN);
-  vectorIndex &= 0xff;
+  assert (count <= NOISE_BLOCK_SIZE);
 
-  double xvGradient = g_randomVectors[(vectorIndex << 2)    ];
-  double yvGradient = g_randomVectors[(vectorIndex << 2) + 1];
-  double zvGradient = g_randomVectors[(vectorIndex << 2) + 2];
+  // Find the cube around each input value, exactly as
+  // GradientCoherentNoise3D() does, along with the differences from its
+  // lower and upper corners.
+  //
+  // The hash GradientNoise3D() uses is linear in the corner coordinates, so
+  // hash the cube's outer-lower-left corner once and offset it for the rest.
+  // It wraps the same way in unsigned arithmetic, and only the low 16 bits
+  // survive the shift and mask, so the shift can be a logical one.
+  int x0[NOISE_BLOCK_SIZE], y0[NOISE_BLOCK_SIZE], z0[NOISE_BLOCK_SIZE];
+  Real xd[2][NOISE_BLOCK_SIZE], yd[2][NOISE_BLOCK_SIZE];
+  Real zd[2][NOISE_BLOCK_SIZE];
+  unsigned int cubeIndex[NOISE_BLOCK_SIZE];
+  for (int i = 0; i < count; i++) {
+    x0[i] = (x[i] > (Real)0.0? (int)x[i]: (int)x[i] - 1);
+    y0[i] = (y[i] > (Real)0.0? (int)y[i]: (int)y[i] - 1);
+    z0[i] = (z[i] > (Real)0.0? (int)z[i]: (int)z[i] - 1);
+    xd[0][i] = x[i] - (Real)x0[i];
+    yd[0][i] = y[i] - (Real)y0[i];
+    zd[0][i] = z[i] - (Real)z0[i];
+    xd[1][i] = x[i] - (Real)(x0[i] + 1);
+    yd[1][i] = y[i] - (Real)(y0[i] + 1);
+    zd[1][i] = z[i] - (Real)(z0[i] + 1);
+    cubeIndex[i] =
+        (unsigned int)X_NOISE_GEN    * (unsigned int)x0[i]
+      + (unsigned int)Y_NOISE_GEN    * (unsigned int)y0[i]
+      + (unsigned int)Z_NOISE_GEN    * (unsigned int)z0[i]
+      + (unsigned int)SEED_NOISE_GEN * (unsigned int)seed;
+  }
 
-  // Set up us another vector equal to the distance between the two vectors
-  // passed to this function.
-  double xvPoint = (fx - (double)ix);
-  double yvPoint = (fy - (double)iy);
-  double zvPoint = (fz - (double)iz);
+  // Map the differences onto an S-curve.
+  Real xs[NOISE_BLOCK_SIZE], ys[NOISE_BLOCK_SIZE], zs[NOISE_BLOCK_SIZE];
+  switch (noiseQuality) {
+    case QUALITY_FAST:
+      for (int i = 0; i < count; i++) {
+        xs[i] = xd[0][i];
+        ys[i] = yd[0][i];
+        zs[i] = zd[0][i];
+      }
+      break;
+    case QUALITY_STD:
+      for (int i = 0; i < count; i++) {
+        xs[i] = SCurve3 (xd[0][i]);
+        ys[i] = SCurve3 (yd[0][i]);
+        zs[i] = SCurve3 (zd[0][i]);
+      }
+      break;
+    case QUALITY_BEST:
+      for (int i = 0; i < count; i++) {
+        xs[i] = SCurve5 (xd[0][i]);
+        ys[i] = SCurve5 (yd[0][i]);
+        zs[i] = SCurve5 (zd[0][i]);
+      }
+      break;
+  }
 
-  // Now compute the dot product of the gradient vector with the distance
-  // vector.  The resulting value is gradient noise.  Apply a scaling value
-  // so that this noise value ranges from -1.0 to 1.0.
-  return ((xvGradient * xvPoint)
-    + (yvGradient * yvPoint)
-    + (zvGradient * zvPoint)) * 2.12;
+  // Gradient noise at each of the eight corners of every cube, corner c
+  // being offset by (c & 1, (c >> 1) & 1, (c >> 2) & 1).
+  const Real* randomVectors = RandomVectors<Real> ();
+  Real n[8][NOISE_BLOCK_SIZE];
+  int vectorIndex[NOISE_BLOCK_SIZE];
+  for (int c = 0; c < 8; c++) {
+    int dx = c & 1, dy = (c >> 1) & 1, dz = (c >> 2) & 1;
+    unsigned int cornerOffset = X_NOISE_GEN * dx + Y_NOISE_GEN * dy
+      + Z_NOISE_GEN * dz;
+    for (int i = 0; i < count; i++) {
+      unsigned int index = cubeIndex[i] + cornerOffset;
+      index ^= (index >> SHIFT_NOISE_GEN);
+      vectorIndex[i] = (int)((index & 0xff) << 2);
+    }
+    const Real* xv = xd[dx];
+    const Real* yv = yd[dy];
+    const Real* zv = zd[dz];
+    for (int i = 0; i < count; i++) {
+      const Real* gradient = &randomVectors[vectorIndex[i]];
+      n[c][i] = ((gradient[0] * xv[i])
+        + (gradient[1] * yv[i])
+        + (gradient[2] * zv[i])) * (Real)2.12;
+    }
+  }
+
+  // Trilinear interpolation, in the same order as GradientCoherentNoise3D().
+  for (int i = 0; i < count; i++) {
+    Real ix0 = LinearInterp (n[0][i], n[1][i], xs[i]);
+    Real ix1 = LinearInterp (n[2][i], n[3][i], xs[i]);
+    Real iy0 = LinearInterp (ix0, ix1, ys[i]);
+    ix0 = LinearInterp (n[4][i], n[5][i], xs[i]);
+    ix1 = LinearInterp (n[6][i], n[7][i], xs[i]);
+    Real iy1 = LinearInterp (ix0, ix1, ys[i]);
+    out[i] = LinearInterp (iy0, iy1, zs[i]);
+  }
+}
+
+template <class Real>
+static void ValueNoise3DBlockT (const int* x, const int* y, const int* z,
+  int count, int seed, Real* out)
+{
+  assert (count <= NOISE_BLOCK_SIZE);
+
+  // The same steps as IntValueNoise3D().
+  for (int i = 0; i < count; i++) {
+    unsigned int n = (
+        (unsigned int)X_NOISE_GEN    * (unsigned int)x[i]
+      + (unsigned int)Y_NOISE_GEN    * (unsigned int)y[i]
+      + (unsigned int)Z_NOISE_GEN    * (unsigned int)z[i]
+      + (unsigned int)SEED_NOISE_GEN * (unsigned int)seed)
+      & 0x7fffffff;
+    n = (n >> 13) ^ n;
+    n = (n * (n * n * 60493 + 19990303) + 1376312589) & 0x7fffffff;
+    out[i] = (Real)1.0 - ((Real)(int)n / (Real)1073741824.0);
+  }
+}
+
+double noise::GradientCoherentNoise3D (double x, double y, double z, int seed,
+  NoiseQuality noiseQuality)
+{
+  return GradientCoherentNoise3DT (x, y, z, seed, noiseQuality);
+}
+
+float noise::GradientCoherentNoise3D (float x, float y, float z, int seed,
+  NoiseQuality noiseQuality)
+{
+  return GradientCoherentNoise3DT (x, y, z, seed, noiseQuality);
+}
+
+void noise::GradientCoherentNoise3DBlock (const double* x, const double* y,
+  const double* z, int count, int seed, NoiseQuality noiseQuality,
+  double* out)
+{
+  GradientCoherentNoise3DBlockT (x, y, z, count, seed, noiseQuality, out);
+}
+
+void noise::GradientCoherentNoise3DBlock (const float* x, const float* y,
+  const float* z, int count, int seed, NoiseQuality noiseQuality,
+  float* out)
+{
+  GradientCoherentNoise3DBlockT (x, y, z, count, seed, noiseQuality, out);
+}
+
+double noise::GradientNoise3D (double fx, double fy, double fz, int ix,
+  int iy, int iz, int seed)
+{
+  return GradientNoise3DT (fx, fy, fz, ix, iy, iz, seed);
+}
+
+float noise::GradientNoise3D (float fx, float fy, float fz, int ix,
+  int iy, int iz, int seed)
+{
+  return GradientNoise3DT (fx, fy, fz, ix, iy, iz, seed);
 }
 
 int noise::IntValueNoise3D (int x, int y, int z, int seed)
 {
   // All constants are primes and must remain prime in order for this noise
-  // function to work correctly.
-  int n = (
-      X_NOISE_GEN    * x
-    + Y_NOISE_GEN    * y
-    + Z_NOISE_GEN    * z
-    + SEED_NOISE_GEN * seed)
+  // function to work correctly.  The arithmetic is unsigned so that it wraps
+  // on overflow; signed overflow let optimizing compilers drop the masks and
+  // return values outside the documented range.
+  unsigned int n = (
+      (unsigned int)X_NOISE_GEN    * (unsigned int)x
+    + (unsigned int)Y_NOISE_GEN    * (unsigned int)y
+    + (unsigned int)Z_NOISE_GEN    * (unsigned int)z
+    + (unsigned int)SEED_NOISE_GEN * (unsigned int)seed)
     & 0x7fffffff;
   n = (n >> 13) ^ n;
-  return (n * (n * n * 60493 + 19990303) + 1376312589) & 0x7fffffff;
+  return (int)((n * (n * n * 60493 + 19990303) + 1376312589) & 0x7fffffff);
 }
 
 double noise::ValueCoherentNoise3D (double x, double y, double z, int seed,
@@ -218,3 +435,14 @@ double noise::ValueNoise3D (int x, int y, int z, int seed)
   return 1.0 - ((double)IntValueNoise3D (x, y, z, seed) / 1073741824.0);
 }
 
+void noise::ValueNoise3DBlock (const int* x, const int* y, const int* z,
+  int count, int seed, double* out)
+{
+  ValueNoise3DBlockT (x, y, z, count, seed, out);
+}
+
+void noise::ValueNoise3DBlock (const int* x, const int* y, const int* z,
+  int count, int seed, float* out)
+{
+  ValueNoise3DBlockT (x, y, z, count, seed, out);
+}
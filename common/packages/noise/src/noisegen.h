@@ -59,6 +59,33 @@ namespace noise
 
   };
 
+  /// Enumerates the floating-point precision that coherent noise is
+  /// generated in.
+  enum NoisePrecision
+  {
+
+    /// Generates coherent noise in double precision.  This is the precision
+    /// libnoise has always used.
+    PRECISION_DOUBLE = 0,
+
+    /// Generates coherent noise in single precision.  The block functions
+    /// process twice as many input values per vector instruction and the
+    /// gradient table takes half the cache.  The output values differ from
+    /// the double-precision ones by a few units in the sixth decimal place
+    /// for input values of moderate size, and by more as the input values
+    /// grow, because a float keeps fewer fractional bits of a large
+    /// coordinate.
+    PRECISION_SINGLE = 1
+
+  };
+
+  /// The largest number of input values passed to a block function.
+  ///
+  /// Block functions keep their intermediate values in arrays of this size
+  /// on the stack.  Batches of any length are split into blocks of at most
+  /// this many input values.
+  const int NOISE_BLOCK_SIZE = 64;
+
   /// Generates a gradient-coherent-noise value from the coordinates of a
   /// three-dimensional input value.
   ///
@@ -77,6 +104,63 @@ namespace noise
   double GradientCoherentNoise3D (double x, double y, double z, int seed = 0,
     NoiseQuality noiseQuality = QUALITY_STD);
 
+  /// Generates a single-precision gradient-coherent-noise value from the
+  /// coordinates of a three-dimensional input value.
+  ///
+  /// @param x The @a x coordinate of the input value.
+  /// @param y The @a y coordinate of the input value.
+  /// @param z The @a z coordinate of the input value.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  ///
+  /// @returns The generated gradient-coherent-noise value.
+  ///
+  /// The same function as the double-precision GradientCoherentNoise3D(),
+  /// computed in floats.  See noise::PRECISION_SINGLE.
+  float GradientCoherentNoise3D (float x, float y, float z, int seed,
+    NoiseQuality noiseQuality);
+
+  /// Generates gradient-coherent-noise values for a block of
+  /// three-dimensional input values.
+  ///
+  /// @param x The @a x coordinates of the input values.
+  /// @param y The @a y coordinates of the input values.
+  /// @param z The @a z coordinates of the input values.
+  /// @param count The number of input values.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  /// @param out The array that receives the generated values.
+  ///
+  /// @pre @a count is no larger than noise::NOISE_BLOCK_SIZE.
+  ///
+  /// Each output value is exactly the value GradientCoherentNoise3D()
+  /// returns for the same input value.  The block is processed one step at a
+  /// time across all of its input values instead of one input value at a
+  /// time, so the compiler can vectorize every step except the gradient
+  /// table lookups.
+  void GradientCoherentNoise3DBlock (const double* x, const double* y,
+    const double* z, int count, int seed, NoiseQuality noiseQuality,
+    double* out);
+
+  /// Generates single-precision gradient-coherent-noise values for a block
+  /// of three-dimensional input values.
+  ///
+  /// @param x The @a x coordinates of the input values.
+  /// @param y The @a y coordinates of the input values.
+  /// @param z The @a z coordinates of the input values.
+  /// @param count The number of input values.
+  /// @param seed The random number seed.
+  /// @param noiseQuality The quality of the coherent-noise.
+  /// @param out The array that receives the generated values.
+  ///
+  /// @pre @a count is no larger than noise::NOISE_BLOCK_SIZE.
+  ///
+  /// Each output value is exactly the value the single-precision
+  /// GradientCoherentNoise3D() returns for the same input value.
+  void GradientCoherentNoise3DBlock (const float* x, const float* y,
+    const float* z, int count, int seed, NoiseQuality noiseQuality,
+    float* out);
+
   /// Generates a gradient-noise value from the coordinates of a
   /// three-dimensional input value and the integer coordinates of a
   /// nearby three-dimensional value.
@@ -121,6 +205,25 @@ namespace noise
   double GradientNoise3D (double fx, double fy, double fz, int ix, int iy,
     int iz, int seed = 0);
 
+  /// Generates a single-precision gradient-noise value from the coordinates
+  /// of a three-dimensional input value and the integer coordinates of a
+  /// nearby three-dimensional value.
+  ///
+  /// @param fx The floating-point @a x coordinate of the input value.
+  /// @param fy The floating-point @a y coordinate of the input value.
+  /// @param fz The floating-point @a z coordinate of the input value.
+  /// @param ix The integer @a x coordinate of a nearby value.
+  /// @param iy The integer @a y coordinate of a nearby value.
+  /// @param iz The integer @a z coordinate of a nearby value.
+  /// @param seed The random number seed.
+  ///
+  /// @returns The generated gradient-noise value.
+  ///
+  /// The same function as the double-precision GradientNoise3D(), computed
+  /// in floats with a single-precision copy of the gradient table.
+  float GradientNoise3D (float fx, float fy, float fz, int ix, int iy,
+    int iz, int seed);
+
   /// Generates an integer-noise value from the coordinates of a
   /// three-dimensional input value.
   ///
@@ -184,6 +287,40 @@ namespace noise
   double ValueCoherentNoise3D (double x, double y, double z, int seed = 0,
     NoiseQuality noiseQuality = QUALITY_STD);
 
+  /// Generates value-noise values for a block of three-dimensional integer
+  /// input values.
+  ///
+  /// @param x The integer @a x coordinates of the input values.
+  /// @param y The integer @a y coordinates of the input values.
+  /// @param z The integer @a z coordinates of the input values.
+  /// @param count The number of input values.
+  /// @param seed A random number seed.
+  /// @param out The array that receives the generated values.
+  ///
+  /// @pre @a count is no larger than noise::NOISE_BLOCK_SIZE.
+  ///
+  /// Each output value is exactly the value ValueNoise3D() returns for the
+  /// same input value.
+  void ValueNoise3DBlock (const int* x, const int* y, const int* z,
+    int count, int seed, double* out);
+
+  /// Generates single-precision value-noise values for a block of
+  /// three-dimensional integer input values.
+  ///
+  /// @param x The integer @a x coordinates of the input values.
+  /// @param y The integer @a y coordinates of the input values.
+  /// @param z The integer @a z coordinates of the input values.
+  /// @param count The number of input values.
+  /// @param seed A random number seed.
+  /// @param out The array that receives the generated values.
+  ///
+  /// @pre @a count is no larger than noise::NOISE_BLOCK_SIZE.
+  ///
+  /// Each output value is the value ValueNoise3D() returns for the same
+  /// input value, rounded to a float.
+  void ValueNoise3DBlock (const int* x, const int* y, const int* z,
+    int count, int seed, float* out);
+
   /// Generates a value-noise value from the coordinates of a
   /// three-dimensional input value.
   ///
@@ -0,0 +1,435 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef SIMPLEX_BATCH_H_
+#define SIMPLEX_BATCH_H_
+
+
+/* Kernels behind the batched Simplex noise functions in simplexnoise.h.
+
+Each kernel is written once against a set of vector operations, and evaluates
+as many points at a time as the operations have lanes. ScalarOps has one lane,
+SSE2Ops has four and AVX2Ops (in simplexnoise_avx2.cpp) has eight. The AVX2
+kernels are compiled in their own file, with AVX2 enabled for just that file,
+and simplexnoise.cpp only calls them once it has checked that the CPU has it.
+
+Everything here has internal linkage, so the copies compiled with AVX2 can
+never stand in for the ones the rest of the program calls.
+
+The kernels follow the scalar functions step by step, but work in float
+throughout, where the scalar functions do a few steps in double because of
+their double constants. So the results can differ from them in the last bit
+or so, but all the kernels agree with each other exactly.
+*/
+
+
+#include <math.h>
+
+#include "simplexnoise.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The AVX2 kernels need GCC or clang to switch the instruction set per file
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMPLEX_BATCH_AVX2 1
+#endif
+
+
+// Batched octave noise with the AVX2 kernels, defined in simplexnoise_avx2.cpp.
+void octave_noise_2d_batch_avx2(const float octaves, const float persistence, const float scale,
+                                const float* x, const float* y, float* out, const int count);
+void octave_noise_3d_batch_avx2(const float octaves, const float persistence, const float scale,
+                                const float* x, const float* y, const float* z, float* out, const int count);
+void octave_noise_4d_batch_avx2(const float octaves, const float persistence, const float scale,
+                                const float* x, const float* y, const float* z, const float* w,
+                                float* out, const int count);
+
+
+namespace {
+
+
+// One lane, for the ends of batches and for CPUs without SSE2.
+struct ScalarOps {
+    typedef float F; // Floats
+    typedef int I;   // Integers
+    typedef bool M;  // Masks, from comparisons
+    static const int width = 1;
+
+    static inline F load(const float* p) { return *p; }
+    static inline void store(float* p, const F a) { *p = a; }
+    static inline F set(const float a) { return a; }
+    static inline I seti(const int a) { return a; }
+
+    static inline F add(const F a, const F b) { return a + b; }
+    static inline F sub(const F a, const F b) { return a - b; }
+    static inline F mul(const F a, const F b) { return a * b; }
+    static inline F div(const F a, const F b) { return a / b; }
+
+    static inline I addi(const I a, const I b) { return a + b; }
+    static inline I subi(const I a, const I b) { return a - b; }
+    static inline I andi(const I a, const int b) { return a & b; }
+    static inline I shli(const I a, const int b) { return a << b; }
+
+    static inline F tofloat(const I a) { return (float) a; }
+    static inline I truncate(const F a) { return (int) a; }
+    static inline I fastfloor(const F a) { return a > 0 ? (int) a : (int) a - 1; }
+
+    static inline M greater(const F a, const F b) { return a > b; }
+    static inline M greaterEqual(const F a, const F b) { return a >= b; }
+    static inline M greateri(const I a, const int b) { return a > b; }
+    static inline M both(const M a, const M b) { return a && b; }
+    static inline M either(const M a, const M b) { return a || b; }
+    static inline M negate(const M a) { return !a; }
+
+    // a where the mask is set, otherwise b
+    static inline F select(const M m, const F a, const F b) { return m ? a : b; }
+    // 1 where the mask is set, otherwise 0
+    static inline I onei(const M m) { return m ? 1 : 0; }
+
+    static inline I lookup(const int* table, const I index) { return table[index]; }
+};
+
+
+#if defined(__SSE2__)
+// Four lanes. SSE2 has no gathers, so the table lookups go through memory.
+struct SSE2Ops {
+    typedef __m128 F;
+    typedef __m128i I;
+    typedef __m128 M;
+    static const int width = 4;
+
+    static inline F load(const float* p) { return _mm_loadu_ps(p); }
+    static inline void store(float* p, const F a) { _mm_storeu_ps(p, a); }
+    static inline F set(const float a) { return _mm_set1_ps(a); }
+    static inline I seti(const int a) { return _mm_set1_epi32(a); }
+
+    static inline F add(const F a, const F b) { return _mm_add_ps(a, b); }
+    static inline F sub(const F a, const F b) { return _mm_sub_ps(a, b); }
+    static inline F mul(const F a, const F b) { return _mm_mul_ps(a, b); }
+    static inline F div(const F a, const F b) { return _mm_div_ps(a, b); }
+
+    static inline I addi(const I a, const I b) { return _mm_add_epi32(a, b); }
+    static inline I subi(const I a, const I b) { return _mm_sub_epi32(a, b); }
+    static inline I andi(const I a, const int b) { return _mm_and_si128(a, _mm_set1_epi32(b)); }
+    static inline I shli(const I a, const int b) { return _mm_slli_epi32(a, b); }
+
+    static inline F tofloat(const I a) { return _mm_cvtepi32_ps(a); }
+    static inline I truncate(const F a) { return _mm_cvttps_epi32(a); }
+    static inline I fastfloor(const F a) {
+        // The mask is -1 where a <= 0, taking one off the truncated value
+        return _mm_add_epi32(_mm_cvttps_epi32(a), _mm_castps_si128(_mm_cmple_ps(a, _mm_setzero_ps())));
+    }
+
+    static inline M greater(const F a, const F b) { return _mm_cmpgt_ps(a, b); }
+    static inline M greaterEqual(const F a, const F b) { return _mm_cmpge_ps(a, b); }
+    static inline M greateri(const I a, const int b) { return _mm_castsi128_ps(_mm_cmpgt_epi32(a, _mm_set1_epi32(b))); }
+    static inline M both(const M a, const M b) { return _mm_and_ps(a, b); }
+    static inline M either(const M a, const M b) { return _mm_or_ps(a, b); }
+    static inline M negate(const M a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+
+    static inline F select(const M m, const F a, const F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    static inline I onei(const M m) { return _mm_and_si128(_mm_castps_si128(m), _mm_set1_epi32(1)); }
+
+    static inline I lookup(const int* table, const I index) {
+        int i[4];
+        _mm_storeu_si128((__m128i*) i, index);
+        return _mm_setr_epi32(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+    }
+};
+#endif
+
+
+// Hashed gradient index of a lattice point, perm[] % 12. A float multiply
+// by 1/12 rounds the right way for every entry of perm[], which keeps it
+// to operations every set of lanes has.
+template <class V>
+inline typename V::I gradient_index_12(const typename V::I p) {
+    typename V::I q = V::truncate(V::mul(V::tofloat(p), V::set(1.0f / 12.0f)));
+    return V::subi(p, V::addi(V::shli(q, 3), V::shli(q, 2)));
+}
+
+
+// The contribution of one corner, (t*t)^2 * (g.d) where t = falloff - |d|^2,
+// or zero outside the corner's radius.
+template <class V>
+inline typename V::F corner(const typename V::F t, const typename V::F dot) {
+    typename V::F tt = V::mul(t, t);
+    return V::select(V::greater(V::set(0.0f), t), V::set(0.0f), V::mul(V::mul(tt, tt), dot));
+}
+
+
+// 2D raw Simplex noise, as raw_noise_2d()
+template <class V>
+inline typename V::F raw_noise_2d_kernel(const typename V::F x, const typename V::F y) {
+    typedef typename V::F F;
+    typedef typename V::I I;
+    const float F2 = 0.5 * (sqrtf(3.0) - 1.0);
+    const float G2 = (3.0 - sqrtf(3.0)) / 6.0;
+
+    // Skew the input space to determine which simplex cell we're in
+    F s = V::mul(V::add(x, y), V::set(F2));
+    I i = V::fastfloor(V::add(x, s));
+    I j = V::fastfloor(V::add(y, s));
+
+    // Unskew the cell origin back to (x,y) space
+    F t = V::mul(V::tofloat(V::addi(i, j)), V::set(G2));
+    F x0 = V::sub(x, V::sub(V::tofloat(i), t));
+    F y0 = V::sub(y, V::sub(V::tofloat(j), t));
+
+    // Lower or upper triangle
+    typename V::M lower = V::greater(x0, y0);
+    I i1 = V::onei(lower);
+    I j1 = V::onei(V::negate(lower));
+
+    F x1 = V::add(V::sub(x0, V::tofloat(i1)), V::set(G2));
+    F y1 = V::add(V::sub(y0, V::tofloat(j1)), V::set(G2));
+    F x2 = V::add(V::sub(x0, V::set(1.0f)), V::set(2.0f * G2));
+    F y2 = V::add(V::sub(y0, V::set(1.0f)), V::set(2.0f * G2));
+
+    // Hashed gradient indices of the three corners
+    I ii = V::andi(i, 255);
+    I jj = V::andi(j, 255);
+    I one = V::seti(1);
+    I gi0 = gradient_index_12<V>(V::lookup(perm, V::addi(ii, V::lookup(perm, jj))));
+    I gi1 = gradient_index_12<V>(V::lookup(perm, V::addi(V::addi(ii, i1), V::lookup(perm, V::addi(jj, j1)))));
+    I gi2 = gradient_index_12<V>(V::lookup(perm, V::addi(V::addi(ii, one), V::lookup(perm, V::addi(jj, one)))));
+
+    // Contributions from the three corners, with the (x,y) of grad3
+    const F falloff = V::set(0.5f);
+    const F d[3][2] = {{x0, y0}, {x1, y1}, {x2, y2}};
+    const I gi[3] = {gi0, gi1, gi2};
+    F n = V::set(0.0f);
+    for (int c = 0; c < 3; c++) {
+        I g = V::addi(V::addi(gi[c], gi[c]), gi[c]);
+        F dot = V::add(V::mul(V::tofloat(V::lookup(&grad3[0][0], g)), d[c][0]),
+                       V::mul(V::tofloat(V::lookup(&grad3[0][0], V::addi(g, one))), d[c][1]));
+        F tc = V::sub(V::sub(falloff, V::mul(d[c][0], d[c][0])), V::mul(d[c][1], d[c][1]));
+        n = V::add(n, corner<V>(tc, dot));
+    }
+    return V::mul(V::set(70.0f), n);
+}
+
+
+// 3D raw Simplex noise, as raw_noise_3d()
+template <class V>
+inline typename V::F raw_noise_3d_kernel(const typename V::F x, const typename V::F y, const typename V::F z) {
+    typedef typename V::F F;
+    typedef typename V::I I;
+    typedef typename V::M M;
+    const float F3 = 1.0/3.0;
+    const float G3 = 1.0/6.0;
+
+    // Skew the input space to determine which simplex cell we're in
+    F s = V::mul(V::add(V::add(x, y), z), V::set(F3));
+    I i = V::fastfloor(V::add(x, s));
+    I j = V::fastfloor(V::add(y, s));
+    I k = V::fastfloor(V::add(z, s));
+
+    // Unskew the cell origin back to (x,y,z) space
+    F t = V::mul(V::tofloat(V::addi(V::addi(i, j), k)), V::set(G3));
+    F x0 = V::sub(x, V::sub(V::tofloat(i), t));
+    F y0 = V::sub(y, V::sub(V::tofloat(j), t));
+    F z0 = V::sub(z, V::sub(V::tofloat(k), t));
+
+    // The same choice of tetrahedron as the nested ifs of raw_noise_3d(),
+    // with the second corner one step along the largest offset and the
+    // third one step along all but the smallest
+    M xy = V::greaterEqual(x0, y0);
+    M yz = V::greaterEqual(y0, z0);
+    M xz = V::greaterEqual(x0, z0);
+    I i1 = V::onei(V::both(xy, xz));
+    I j1 = V::onei(V::both(V::negate(xy), yz));
+    I k1 = V::onei(V::both(V::negate(xz), V::negate(yz)));
+    I i2 = V::onei(V::either(xy, xz));
+    I j2 = V::onei(V::either(V::negate(xy), yz));
+    I k2 = V::onei(V::either(V::negate(xz), V::negate(yz)));
+
+    F x1 = V::add(V::sub(x0, V::tofloat(i1)), V::set(G3));
+    F y1 = V::add(V::sub(y0, V::tofloat(j1)), V::set(G3));
+    F z1 = V::add(V::sub(z0, V::tofloat(k1)), V::set(G3));
+    F x2 = V::add(V::sub(x0, V::tofloat(i2)), V::set(2.0f * G3));
+    F y2 = V::add(V::sub(y0, V::tofloat(j2)), V::set(2.0f * G3));
+    F z2 = V::add(V::sub(z0, V::tofloat(k2)), V::set(2.0f * G3));
+    F x3 = V::add(V::sub(x0, V::set(1.0f)), V::set(3.0f * G3));
+    F y3 = V::add(V::sub(y0, V::set(1.0f)), V::set(3.0f * G3));
+    F z3 = V::add(V::sub(z0, V::set(1.0f)), V::set(3.0f * G3));
+
+    // Hashed gradient indices of the four corners
+    I ii = V::andi(i, 255);
+    I jj = V::andi(j, 255);
+    I kk = V::andi(k, 255);
+    I one = V::seti(1);
+    I gi0 = gradient_index_12<V>(V::lookup(perm, V::addi(ii, V::lookup(perm, V::addi(jj, V::lookup(perm, kk))))));
+    I gi1 = gradient_index_12<V>(V::lookup(perm, V::addi(V::addi(ii, i1), V::lookup(perm, V::addi(V::addi(jj, j1), V::lookup(perm, V::addi(kk, k1)))))));
+    I gi2 = gradient_index_12<V>(V::lookup(perm, V::addi(V::addi(ii, i2), V::lookup(perm, V::addi(V::addi(jj, j2), V::lookup(perm, V::addi(kk, k2)))))));
+    I gi3 = gradient_index_12<V>(V::lookup(perm, V::addi(V::addi(ii, one), V::lookup(perm, V::addi(V::addi(jj, one), V::lookup(perm, V::addi(kk, one)))))));
+
+    // Contributions from the four corners
+    const F falloff = V::set(0.6f);
+    const F d[4][3] = {{x0, y0, z0}, {x1, y1, z1}, {x2, y2, z2}, {x3, y3, z3}};
+    const I gi[4] = {gi0, gi1, gi2, gi3};
+    F n = V::set(0.0f);
+    for (int c = 0; c < 4; c++) {
+        I g = V::addi(V::addi(gi[c], gi[c]), gi[c]);
+        F dot = V::add(V::add(V::mul(V::tofloat(V::lookup(&grad3[0][0], g)), d[c][0]),
+                              V::mul(V::tofloat(V::lookup(&grad3[0][0], V::addi(g, one))), d[c][1])),
+                       V::mul(V::tofloat(V::lookup(&grad3[0][0], V::addi(g, V::seti(2)))), d[c][2]));
+        F tc = V::sub(V::sub(V::sub(falloff, V::mul(d[c][0], d[c][0])), V::mul(d[c][1], d[c][1])), V::mul(d[c][2], d[c][2]));
+        n = V::add(n, corner<V>(tc, dot));
+    }
+    return V::mul(V::set(32.0f), n);
+}
+
+
+// 4D raw Simplex noise, as raw_noise_4d()
+template <class V>
+inline typename V::F raw_noise_4d_kernel(const typename V::F x, const typename V::F y, const typename V::F z, const typename V::F w) {
+    typedef typename V::F F;
+    typedef typename V::I I;
+    typedef typename V::M M;
+    const float F4 = (sqrtf(5.0)-1.0)/4.0;
+    const float G4 = (5.0-sqrtf(5.0))/20.0;
+
+    // Skew the (x,y,z,w) space to determine which cell of 24 simplices we're in
+    F s = V::mul(V::add(V::add(V::add(x, y), z), w), V::set(F4));
+    I i = V::fastfloor(V::add(x, s));
+    I j = V::fastfloor(V::add(y, s));
+    I k = V::fastfloor(V::add(z, s));
+    I l = V::fastfloor(V::add(w, s));
+
+    // Unskew the cell origin back to (x,y,z,w) space
+    F t = V::mul(V::tofloat(V::addi(V::addi(V::addi(i, j), k), l)), V::set(G4));
+    F x0 = V::sub(x, V::sub(V::tofloat(i), t));
+    F y0 = V::sub(y, V::sub(V::tofloat(j), t));
+    F z0 = V::sub(z, V::sub(V::tofloat(k), t));
+    F w0 = V::sub(w, V::sub(V::tofloat(l), t));
+
+    // The rank of each offset among the four, which is what simplex[] holds
+    // for the index raw_noise_4d() builds from the same six comparisons
+    M xy = V::greater(x0, y0);
+    M xz = V::greater(x0, z0);
+    M yz = V::greater(y0, z0);
+    M xw = V::greater(x0, w0);
+    M yw = V::greater(y0, w0);
+    M zw = V::greater(z0, w0);
+    I rank[4];
+    rank[0] = V::addi(V::addi(V::onei(xy), V::onei(xz)), V::onei(xw));
+    rank[1] = V::addi(V::addi(V::onei(V::negate(xy)), V::onei(yz)), V::onei(yw));
+    rank[2] = V::addi(V::addi(V::onei(V::negate(xz)), V::onei(V::negate(yz))), V::onei(zw));
+    rank[3] = V::addi(V::addi(V::onei(V::negate(xw)), V::onei(V::negate(yw))), V::onei(V::negate(zw)));
+
+    // Corner c (1 to 3) steps along every offset ranked at least 4 - c
+    const F d0[4] = {x0, y0, z0, w0};
+    F d[5][4];
+    I o[5][4];
+    for (int a = 0; a < 4; a++) {
+        o[0][a] = V::seti(0);
+        o[4][a] = V::seti(1);
+        d[0][a] = d0[a];
+        for (int c = 1; c < 4; c++) {
+            o[c][a] = V::onei(V::greateri(rank[a], 3 - c));
+            d[c][a] = V::add(V::sub(d0[a], V::tofloat(o[c][a])), V::set(c * G4));
+        }
+        d[4][a] = V::add(V::sub(d0[a], V::set(1.0f)), V::set(4.0f * G4));
+    }
+
+    // Hashed gradient indices of the five corners and their contributions
+    I ii = V::andi(i, 255);
+    I jj = V::andi(j, 255);
+    I kk = V::andi(k, 255);
+    I ll = V::andi(l, 255);
+    const F falloff = V::set(0.6f);
+    F n = V::set(0.0f);
+    for (int c = 0; c < 5; c++) {
+        I p = V::lookup(perm, V::addi(ll, o[c][3]));
+        p = V::lookup(perm, V::addi(V::addi(kk, o[c][2]), p));
+        p = V::lookup(perm, V::addi(V::addi(jj, o[c][1]), p));
+        p = V::lookup(perm, V::addi(V::addi(ii, o[c][0]), p));
+        I g = V::shli(V::andi(p, 31), 2);
+
+        F dot = V::mul(V::tofloat(V::lookup(&grad4[0][0], g)), d[c][0]);
+        F tc = V::sub(falloff, V::mul(d[c][0], d[c][0]));
+        for (int a = 1; a < 4; a++) {
+            dot = V::add(dot, V::mul(V::tofloat(V::lookup(&grad4[0][0], V::addi(g, V::seti(a)))), d[c][a]));
+            tc = V::sub(tc, V::mul(d[c][a], d[c][a]));
+        }
+        n = V::add(n, corner<V>(tc, dot));
+    }
+    return V::mul(V::set(27.0f), n);
+}
+
+
+// Loads width points from each array, padding the end of the batch with zeros
+template <class V>
+inline typename V::F load_lanes(const float* p, const int count) {
+    if (count >= V::width) return V::load(p);
+    float lanes[V::width > 1 ? V::width : 1] = {0.0f};
+    for (int i = 0; i < count; i++) lanes[i] = p[i];
+    return V::load(lanes);
+}
+
+template <class V>
+inline void store_lanes(float* p, const typename V::F a, const int count) {
+    if (count >= V::width) {
+        V::store(p, a);
+        return;
+    }
+    float lanes[V::width > 1 ? V::width : 1];
+    V::store(lanes, a);
+    for (int i = 0; i < count; i++) p[i] = lanes[i];
+}
+
+
+// Multi-octave noise over a batch, as octave_noise_2d/3d/4d(). Every lane
+// runs through the octaves together, with the frequency and amplitude
+// stepped the same way as the scalar functions.
+template <class V, int DIM>
+void octave_noise_batch(const float octaves, const float persistence, const float scale,
+                        const float* const* coords, float* out, const int count) {
+    typedef typename V::F F;
+    for (int b = 0; b < count; b += V::width) {
+        const int lanes = count - b;
+        F p[4];
+        for (int a = 0; a < DIM; a++) p[a] = load_lanes<V>(coords[a] + b, lanes);
+
+        F total = V::set(0.0f);
+        float frequency = scale;
+        float amplitude = 1;
+        float maxAmplitude = 0;
+        for (int i = 0; i < octaves; i++) {
+            const F f = V::set(frequency);
+            F noise;
+            if (DIM == 2) noise = raw_noise_2d_kernel<V>(V::mul(p[0], f), V::mul(p[1], f));
+            else if (DIM == 3) noise = raw_noise_3d_kernel<V>(V::mul(p[0], f), V::mul(p[1], f), V::mul(p[2], f));
+            else noise = raw_noise_4d_kernel<V>(V::mul(p[0], f), V::mul(p[1], f), V::mul(p[2], f), V::mul(p[3], f));
+            total = V::add(total, V::mul(noise, V::set(amplitude)));
+
+            frequency *= 2;
+            maxAmplitude += amplitude;
+            amplitude *= persistence;
+        }
+        store_lanes<V>(out + b, V::div(total, V::set(maxAmplitude)), lanes);
+    }
+}
+
+
+}
+
+
+#endif /*SIMPLEX_BATCH_H_*/
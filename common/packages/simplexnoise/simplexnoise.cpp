@@ -19,6 +19,7 @@
 #include <math.h>
 
 #include "simplexnoise.h"
+#include "simplexbatch.h"
 
 
 /* 2D, 3D and 4D Simplex Noise functions return 'random' values in (-1, 1).
@@ -468,6 +469,338 @@ float raw_noise_4d( const float x, const float y, const float z, const float w )
 }
 
 
+// Whether the AVX2 batch kernels can run here, checked once.
+static bool use_avx2() {
+#if defined(SIMPLEX_BATCH_AVX2)
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+
+// Batched multi-octave Simplex noise.
+//
+// Picks the widest kernels this CPU can run.
+void octave_noise_2d_batch( const float octaves, const float persistence, const float scale, const float* x, const float* y, float* out, const int count ) {
+    if( use_avx2() ) {
+        octave_noise_2d_batch_avx2(octaves, persistence, scale, x, y, out, count);
+        return;
+    }
+    const float* coords[2] = {x, y};
+#if defined(__SSE2__)
+    octave_noise_batch<SSE2Ops, 2>(octaves, persistence, scale, coords, out, count);
+#else
+    octave_noise_batch<ScalarOps, 2>(octaves, persistence, scale, coords, out, count);
+#endif
+}
+
+void octave_noise_3d_batch( const float octaves, const float persistence, const float scale, const float* x, const float* y, const float* z, float* out, const int count ) {
+    if( use_avx2() ) {
+        octave_noise_3d_batch_avx2(octaves, persistence, scale, x, y, z, out, count);
+        return;
+    }
+    const float* coords[3] = {x, y, z};
+#if defined(__SSE2__)
+    octave_noise_batch<SSE2Ops, 3>(octaves, persistence, scale, coords, out, count);
+#else
+    octave_noise_batch<ScalarOps, 3>(octaves, persistence, scale, coords, out, count);
+#endif
+}
+
+void octave_noise_4d_batch( const float octaves, const float persistence, const float scale, const float* x, const float* y, const float* z, const float* w, float* out, const int count ) {
+    if( use_avx2() ) {
+        octave_noise_4d_batch_avx2(octaves, persistence, scale, x, y, z, w, out, count);
+        return;
+    }
+    const float* coords[4] = {x, y, z, w};
+#if defined(__SSE2__)
+    octave_noise_batch<SSE2Ops, 4>(octaves, persistence, scale, coords, out, count);
+#else
+    octave_noise_batch<ScalarOps, 4>(octaves, persistence, scale, coords, out, count);
+#endif
+}
+
+
+// Batched scaled multi-octave Simplex noise.
+//
+// Returned values will be between loBound and hiBound.
+void scaled_octave_noise_2d_batch( const float octaves, const float persistence, const float scale, const float loBound, const float hiBound, const float* x, const float* y, float* out, const int count ) {
+    octave_noise_2d_batch(octaves, persistence, scale, x, y, out, count);
+    for( int i=0; i < count; i++ ) out[i] = out[i] * (hiBound - loBound) / 2 + (hiBound + loBound) / 2;
+}
+
+void scaled_octave_noise_3d_batch( const float octaves, const float persistence, const float scale, const float loBound, const float hiBound, const float* x, const float* y, const float* z, float* out, const int count ) {
+    octave_noise_3d_batch(octaves, persistence, scale, x, y, z, out, count);
+    for( int i=0; i < count; i++ ) out[i] = out[i] * (hiBound - loBound) / 2 + (hiBound + loBound) / 2;
+}
+
+void scaled_octave_noise_4d_batch( const float octaves, const float persistence, const float scale, const float loBound, const float hiBound, const float* x, const float* y, const float* z, const float* w, float* out, const int count ) {
+    octave_noise_4d_batch(octaves, persistence, scale, x, y, z, w, out, count);
+    for( int i=0; i < count; i++ ) out[i] = out[i] * (hiBound - loBound) / 2 + (hiBound + loBound) / 2;
+}
+
+
+// Batched raw Simplex noise.
+//
+// A single octave at scale 1 is exactly the raw noise.
+void raw_noise_2d_batch( const float* x, const float* y, float* out, const int count ) {
+    octave_noise_2d_batch(1, 1, 1, x, y, out, count);
+}
+
+void raw_noise_3d_batch( const float* x, const float* y, const float* z, float* out, const int count ) {
+    octave_noise_3d_batch(1, 1, 1, x, y, z, out, count);
+}
+
+void raw_noise_4d_batch( const float* x, const float* y, const float* z, const float* w, float* out, const int count ) {
+    octave_noise_4d_batch(1, 1, 1, x, y, z, w, out, count);
+}
+
+
+// Contribution of one simplex corner to the noise value, as in raw_noise_3d(),
+// adding its gradient to d. With t = 0.6 - |r|^2 the contribution is t^4 (g.r),
+// so its gradient is t^4 g - 8 t^3 (g.r) r.
+static float corner_3d_deriv( const int* g, const float x, const float y, const float z, float* d ) {
+    float t = 0.6 - x*x - y*y - z*z;
+    if(t<0) return 0.0;
+
+    float t2 = t * t;
+    float t4 = t2 * t2;
+    float gr = dot(g, x, y, z);
+    float slope = 8 * t2 * t * gr;
+    d[0] += t4 * g[0] - slope * x;
+    d[1] += t4 * g[1] - slope * y;
+    d[2] += t4 * g[2] - slope * z;
+    return t4 * gr;
+}
+
+
+// Contribution of one simplex corner to the noise value, as in raw_noise_4d(),
+// adding its gradient to d.
+static float corner_4d_deriv( const int* g, const float x, const float y, const float z, const float w, float* d ) {
+    float t = 0.6 - x*x - y*y - z*z - w*w;
+    if(t<0) return 0.0;
+
+    float t2 = t * t;
+    float t4 = t2 * t2;
+    float gr = dot(g, x, y, z, w);
+    float slope = 8 * t2 * t * gr;
+    d[0] += t4 * g[0] - slope * x;
+    d[1] += t4 * g[1] - slope * y;
+    d[2] += t4 * g[2] - slope * z;
+    d[3] += t4 * g[3] - slope * w;
+    return t4 * gr;
+}
+
+
+// 3D raw Simplex noise with its gradient.
+//
+// The simplex and its corners are found exactly as in raw_noise_3d().
+float raw_noise_3d_deriv( const float x, const float y, const float z, float* dx, float* dy, float* dz ) {
+    float F3 = 1.0/3.0;
+    float s = (x+y+z)*F3;
+    int i = fastfloor(x+s);
+    int j = fastfloor(y+s);
+    int k = fastfloor(z+s);
+
+    float G3 = 1.0/6.0;
+    float t = (i+j+k)*G3;
+    float x0 = x-(i-t);
+    float y0 = y-(j-t);
+    float z0 = z-(k-t);
+
+    int i1, j1, k1;
+    int i2, j2, k2;
+    if(x0>=y0) {
+        if(y0>=z0) { i1=1; j1=0; k1=0; i2=1; j2=1; k2=0; }
+        else if(x0>=z0) { i1=1; j1=0; k1=0; i2=1; j2=0; k2=1; }
+        else { i1=0; j1=0; k1=1; i2=1; j2=0; k2=1; }
+    }
+    else {
+        if(y0<z0) { i1=0; j1=0; k1=1; i2=0; j2=1; k2=1; }
+        else if(x0<z0) { i1=0; j1=1; k1=0; i2=0; j2=1; k2=1; }
+        else { i1=0; j1=1; k1=0; i2=1; j2=1; k2=0; }
+    }
+
+    int ii = i & 255;
+    int jj = j & 255;
+    int kk = k & 255;
+    int gi0 = perm[ii+perm[jj+perm[kk]]] % 12;
+    int gi1 = perm[ii+i1+perm[jj+j1+perm[kk+k1]]] % 12;
+    int gi2 = perm[ii+i2+perm[jj+j2+perm[kk+k2]]] % 12;
+    int gi3 = perm[ii+1+perm[jj+1+perm[kk+1]]] % 12;
+
+    float d[3] = {0, 0, 0};
+    float n0 = corner_3d_deriv(grad3[gi0], x0, y0, z0, d);
+    float n1 = corner_3d_deriv(grad3[gi1], x0 - i1 + G3, y0 - j1 + G3, z0 - k1 + G3, d);
+    float n2 = corner_3d_deriv(grad3[gi2], x0 - i2 + 2.0*G3, y0 - j2 + 2.0*G3, z0 - k2 + 2.0*G3, d);
+    float n3 = corner_3d_deriv(grad3[gi3], x0 - 1.0 + 3.0*G3, y0 - 1.0 + 3.0*G3, z0 - 1.0 + 3.0*G3, d);
+
+    *dx = 32.0 * d[0];
+    *dy = 32.0 * d[1];
+    *dz = 32.0 * d[2];
+    return 32.0*(n0 + n1 + n2 + n3);
+}
+
+
+// 4D raw Simplex noise with its gradient.
+//
+// The simplex and its corners are found exactly as in raw_noise_4d().
+float raw_noise_4d_deriv( const float x, const float y, const float z, const float w, float* dx, float* dy, float* dz, float* dw ) {
+    float F4 = (sqrtf(5.0)-1.0)/4.0;
+    float G4 = (5.0-sqrtf(5.0))/20.0;
+
+    float s = (x + y + z + w) * F4;
+    int i = fastfloor(x + s);
+    int j = fastfloor(y + s);
+    int k = fastfloor(z + s);
+    int l = fastfloor(w + s);
+    float t = (i + j + k + l) * G4;
+    float x0 = x - (i - t);
+    float y0 = y - (j - t);
+    float z0 = z - (k - t);
+    float w0 = w - (l - t);
+
+    int c = ((x0 > y0) ? 32 : 0) + ((x0 > z0) ? 16 : 0) + ((y0 > z0) ? 8 : 0) +
+            ((x0 > w0) ? 4 : 0) + ((y0 > w0) ? 2 : 0) + ((z0 > w0) ? 1 : 0);
+
+    int ii = i & 255;
+    int jj = j & 255;
+    int kk = k & 255;
+    int ll = l & 255;
+
+    // Corner n steps along every coordinate whose rank in simplex[c] is at least 4-n.
+    // The offsets are rounded the same way as raw_noise_4d() rounds them.
+    const float r0[4] = {x0, y0, z0, w0};
+    float d[4] = {0, 0, 0, 0};
+    float n[5];
+    for( int corner=0; corner < 5; corner++ ) {
+        int o[4];
+        float r[4];
+        for( int a=0; a < 4; a++ ) {
+            o[a] = (corner == 0) ? 0 : ((corner == 4) ? 1 : (simplex[c][a] >= 4-corner ? 1 : 0));
+            if(corner == 0) r[a] = r0[a];
+            else if(corner == 1) r[a] = r0[a] - o[a] + G4;
+            else if(corner < 4) r[a] = r0[a] - o[a] + corner*(double)G4;
+            else r[a] = r0[a] - 1.0 + 4.0*G4;
+        }
+        int gi = perm[ii+o[0]+perm[jj+o[1]+perm[kk+o[2]+perm[ll+o[3]]]]] % 32;
+        n[corner] = corner_4d_deriv(grad4[gi], r[0], r[1], r[2], r[3], d);
+    }
+
+    *dx = 27.0 * d[0];
+    *dy = 27.0 * d[1];
+    *dz = 27.0 * d[2];
+    *dw = 27.0 * d[3];
+    return 27.0 * (n[0] + n[1] + n[2] + n[3] + n[4]);
+}
+
+
+// 3D Multi-octave Simplex noise with its gradient.
+//
+// Each octave's gradient is scaled by its frequency, as well as its amplitude.
+float octave_noise_3d_deriv( const float octaves, const float persistence, const float scale, const float x, const float y, const float z, float* dx, float* dy, float* dz ) {
+    float total = 0;
+    float frequency = scale;
+    float amplitude = 1;
+    float maxAmplitude = 0;
+    float d[3] = {0, 0, 0};
+
+    for( int i=0; i < octaves; i++ ) {
+        float ox, oy, oz;
+        total += raw_noise_3d_deriv( x * frequency, y * frequency, z * frequency, &ox, &oy, &oz ) * amplitude;
+        d[0] += ox * frequency * amplitude;
+        d[1] += oy * frequency * amplitude;
+        d[2] += oz * frequency * amplitude;
+
+        frequency *= 2;
+        maxAmplitude += amplitude;
+        amplitude *= persistence;
+    }
+
+    *dx = d[0] / maxAmplitude;
+    *dy = d[1] / maxAmplitude;
+    *dz = d[2] / maxAmplitude;
+    return total / maxAmplitude;
+}
+
+
+// 4D Multi-octave Simplex noise with its gradient.
+float octave_noise_4d_deriv( const float octaves, const float persistence, const float scale, const float x, const float y, const float z, const float w, float* dx, float* dy, float* dz, float* dw ) {
+    float total = 0;
+    float frequency = scale;
+    float amplitude = 1;
+    float maxAmplitude = 0;
+    float d[4] = {0, 0, 0, 0};
+
+    for( int i=0; i < octaves; i++ ) {
+        float ox, oy, oz, ow;
+        total += raw_noise_4d_deriv( x * frequency, y * frequency, z * frequency, w * frequency, &ox, &oy, &oz, &ow ) * amplitude;
+        d[0] += ox * frequency * amplitude;
+        d[1] += oy * frequency * amplitude;
+        d[2] += oz * frequency * amplitude;
+        d[3] += ow * frequency * amplitude;
+
+        frequency *= 2;
+        maxAmplitude += amplitude;
+        amplitude *= persistence;
+    }
+
+    *dx = d[0] / maxAmplitude;
+    *dy = d[1] / maxAmplitude;
+    *dz = d[2] / maxAmplitude;
+    *dw = d[3] / maxAmplitude;
+    return total / maxAmplitude;
+}
+
+
+// Offsets of the second and third components of the curl noise potential from
+// the first, far enough apart that the three fields look unrelated.
+static const float curlOffset[2][3] = {
+    {31.416, -47.853, 12.793},
+    {-233.145, -113.408, -185.31}
+};
+
+
+// 3D Curl noise.
+//
+// With the potential (p0, p1, p2), the velocity is
+// (dp2/dy - dp1/dz, dp0/dz - dp2/dx, dp1/dx - dp0/dy).
+void curl_noise_3d( const float octaves, const float persistence, const float scale, const float x, const float y, const float z, float* vx, float* vy, float* vz ) {
+    float d[3][3];
+    octave_noise_3d_deriv(octaves, persistence, scale, x, y, z, &d[0][0], &d[0][1], &d[0][2]);
+    for( int p=1; p < 3; p++ ) {
+        octave_noise_3d_deriv(octaves, persistence, scale,
+                              x + curlOffset[p-1][0], y + curlOffset[p-1][1], z + curlOffset[p-1][2],
+                              &d[p][0], &d[p][1], &d[p][2]);
+    }
+
+    *vx = d[2][1] - d[1][2];
+    *vy = d[0][2] - d[2][0];
+    *vz = d[1][0] - d[0][1];
+}
+
+
+// 4D Curl noise.
+//
+// As curl_noise_3d(), animated by w.
+void curl_noise_4d( const float octaves, const float persistence, const float scale, const float x, const float y, const float z, const float w, float* vx, float* vy, float* vz ) {
+    float d[3][3];
+    float dw;
+    octave_noise_4d_deriv(octaves, persistence, scale, x, y, z, w, &d[0][0], &d[0][1], &d[0][2], &dw);
+    for( int p=1; p < 3; p++ ) {
+        octave_noise_4d_deriv(octaves, persistence, scale,
+                              x + curlOffset[p-1][0], y + curlOffset[p-1][1], z + curlOffset[p-1][2], w,
+                              &d[p][0], &d[p][1], &d[p][2], &dw);
+    }
+
+    *vx = d[2][1] - d[1][2];
+    *vy = d[0][2] - d[2][0];
+    *vz = d[1][0] - d[0][1];
+}
+
+
 int fastfloor( const float x ) { return x > 0 ? (int) x : (int) x - 1; }
 
 float dot( const int* g, const float x, const float y ) { return g[0]*x + g[1]*y; }
@@ -114,6 +114,129 @@ float scaled_raw_noise_4d( const float loBound,
                         const float w);
 
 
+// Batched Simplex noise
+// Each of these evaluates count points at once, reading the coordinates of point i
+// from x[i], y[i] and so on, and writing its value to out[i]. The points are run
+// through SIMD kernels several at a time, using AVX2 when the CPU has it and SSE2
+// otherwise. The values match the functions above to within float rounding.
+void octave_noise_2d_batch(const float octaves,
+                           const float persistence,
+                           const float scale,
+                           const float* x,
+                           const float* y,
+                           float* out,
+                           const int count);
+void octave_noise_3d_batch(const float octaves,
+                           const float persistence,
+                           const float scale,
+                           const float* x,
+                           const float* y,
+                           const float* z,
+                           float* out,
+                           const int count);
+void octave_noise_4d_batch(const float octaves,
+                           const float persistence,
+                           const float scale,
+                           const float* x,
+                           const float* y,
+                           const float* z,
+                           const float* w,
+                           float* out,
+                           const int count);
+
+void scaled_octave_noise_2d_batch(const float octaves,
+                                  const float persistence,
+                                  const float scale,
+                                  const float loBound,
+                                  const float hiBound,
+                                  const float* x,
+                                  const float* y,
+                                  float* out,
+                                  const int count);
+void scaled_octave_noise_3d_batch(const float octaves,
+                                  const float persistence,
+                                  const float scale,
+                                  const float loBound,
+                                  const float hiBound,
+                                  const float* x,
+                                  const float* y,
+                                  const float* z,
+                                  float* out,
+                                  const int count);
+void scaled_octave_noise_4d_batch(const float octaves,
+                                  const float persistence,
+                                  const float scale,
+                                  const float loBound,
+                                  const float hiBound,
+                                  const float* x,
+                                  const float* y,
+                                  const float* z,
+                                  const float* w,
+                                  float* out,
+                                  const int count);
+
+void raw_noise_2d_batch(const float* x, const float* y, float* out, const int count);
+void raw_noise_3d_batch(const float* x, const float* y, const float* z, float* out, const int count);
+void raw_noise_4d_batch(const float* x, const float* y, const float* z, const float* w, float* out, const int count);
+
+
+// Simplex noise with analytic derivatives
+// These return the same value as the functions without _deriv, and write its
+// gradient with respect to the input coordinates to dx, dy, dz (and dw), for far
+// less than the cost of finite differences. The corners' 0.6 falloff radius makes
+// the noise jump slightly across some simplex faces; the gradient there is that of
+// the simplex the point is in.
+float raw_noise_3d_deriv(const float x, const float y, const float z,
+                         float* dx, float* dy, float* dz);
+float raw_noise_4d_deriv(const float x, const float y, const float z, const float w,
+                         float* dx, float* dy, float* dz, float* dw);
+float octave_noise_3d_deriv(const float octaves,
+                            const float persistence,
+                            const float scale,
+                            const float x,
+                            const float y,
+                            const float z,
+                            float* dx,
+                            float* dy,
+                            float* dz);
+float octave_noise_4d_deriv(const float octaves,
+                            const float persistence,
+                            const float scale,
+                            const float x,
+                            const float y,
+                            const float z,
+                            const float w,
+                            float* dx,
+                            float* dy,
+                            float* dz,
+                            float* dw);
+
+
+// Curl noise
+// A divergence free velocity field, the curl of a vector potential made of three
+// offset multi-octave noise fields. The 4D version animates the field with w (for
+// instance time) and takes the curl over x, y and z only.
+void curl_noise_3d(const float octaves,
+                   const float persistence,
+                   const float scale,
+                   const float x,
+                   const float y,
+                   const float z,
+                   float* vx,
+                   float* vy,
+                   float* vz);
+void curl_noise_4d(const float octaves,
+                   const float persistence,
+                   const float scale,
+                   const float x,
+                   const float y,
+                   const float z,
+                   const float w,
+                   float* vx,
+                   float* vy,
+                   float* vz);
+
+
 // Raw Simplex noise - a single noise value.
 float raw_noise_2d(const float x, const float y);
 float raw_noise_3d(const float x, const float y, const float z);
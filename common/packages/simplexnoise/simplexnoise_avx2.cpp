@@ -0,0 +1,115 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// The AVX2 batch kernels. Everything after the pragmas is compiled for AVX2,
+// so the standard headers come first to keep their inline functions out of
+// it, and simplexnoise.cpp only calls in here on CPUs that have it.
+
+
+#include <math.h>
+#include <immintrin.h>
+
+#include "simplexnoise.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include "simplexbatch.h"
+
+
+namespace {
+
+
+// Eight lanes, with gathers for the table lookups.
+struct AVX2Ops {
+    typedef __m256 F;
+    typedef __m256i I;
+    typedef __m256 M;
+    static const int width = 8;
+
+    static inline F load(const float* p) { return _mm256_loadu_ps(p); }
+    static inline void store(float* p, const F a) { _mm256_storeu_ps(p, a); }
+    static inline F set(const float a) { return _mm256_set1_ps(a); }
+    static inline I seti(const int a) { return _mm256_set1_epi32(a); }
+
+    static inline F add(const F a, const F b) { return _mm256_add_ps(a, b); }
+    static inline F sub(const F a, const F b) { return _mm256_sub_ps(a, b); }
+    static inline F mul(const F a, const F b) { return _mm256_mul_ps(a, b); }
+    static inline F div(const F a, const F b) { return _mm256_div_ps(a, b); }
+
+    static inline I addi(const I a, const I b) { return _mm256_add_epi32(a, b); }
+    static inline I subi(const I a, const I b) { return _mm256_sub_epi32(a, b); }
+    static inline I andi(const I a, const int b) { return _mm256_and_si256(a, _mm256_set1_epi32(b)); }
+    static inline I shli(const I a, const int b) { return _mm256_slli_epi32(a, b); }
+
+    static inline F tofloat(const I a) { return _mm256_cvtepi32_ps(a); }
+    static inline I truncate(const F a) { return _mm256_cvttps_epi32(a); }
+    static inline I fastfloor(const F a) {
+        // The mask is -1 where a <= 0, taking one off the truncated value
+        return _mm256_add_epi32(_mm256_cvttps_epi32(a), _mm256_castps_si256(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_LE_OQ)));
+    }
+
+    static inline M greater(const F a, const F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static inline M greaterEqual(const F a, const F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static inline M greateri(const I a, const int b) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(a, _mm256_set1_epi32(b))); }
+    static inline M both(const M a, const M b) { return _mm256_and_ps(a, b); }
+    static inline M either(const M a, const M b) { return _mm256_or_ps(a, b); }
+    static inline M negate(const M a) { return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+
+    static inline F select(const M m, const F a, const F b) { return _mm256_blendv_ps(b, a, m); }
+    static inline I onei(const M m) { return _mm256_and_si256(_mm256_castps_si256(m), _mm256_set1_epi32(1)); }
+
+    static inline I lookup(const int* table, const I index) { return _mm256_i32gather_epi32(table, index, 4); }
+};
+
+
+}
+
+
+void octave_noise_2d_batch_avx2(const float octaves, const float persistence, const float scale,
+                                const float* x, const float* y, float* out, const int count) {
+    const float* coords[2] = {x, y};
+    octave_noise_batch<AVX2Ops, 2>(octaves, persistence, scale, coords, out, count);
+}
+
+void octave_noise_3d_batch_avx2(const float octaves, const float persistence, const float scale,
+                                const float* x, const float* y, const float* z, float* out, const int count) {
+    const float* coords[3] = {x, y, z};
+    octave_noise_batch<AVX2Ops, 3>(octaves, persistence, scale, coords, out, count);
+}
+
+void octave_noise_4d_batch_avx2(const float octaves, const float persistence, const float scale,
+                                const float* x, const float* y, const float* z, const float* w,
+                                float* out, const int count) {
+    const float* coords[4] = {x, y, z, w};
+    octave_noise_batch<AVX2Ops, 4>(octaves, persistence, scale, coords, out, count);
+}
+
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,125 @@
+#include "workstealingpool.h"
+
+#include <algorithm>
+#include <numeric>
+
+/**
+ * @brief WorkStealingPool::WorkStealingPool
+ * @param numThreads The number of threads to do work on, including the caller
+ */
+WorkStealingPool::WorkStealingPool(size_t numThreads) : m_remaining(0) {
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < numThreads; ++i) {
+        m_queues.emplace_back(new Queue);
+    }
+    // Worker 0 is whoever calls run(), so only spawn the rest
+    for (size_t i = 1; i < numThreads; ++i) {
+        m_threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (auto &t : m_threads) t.join();
+}
+
+/**
+ * @brief WorkStealingPool::run
+ * @param costs Estimated cost of each task (e.g. particle count)
+ * @param task Function called with the index of each task
+ */
+void WorkStealingPool::run(const std::vector<size_t> &costs,
+                           const std::function<void(size_t)> &task) {
+    if (costs.empty()) return;
+
+    // Longest processing time first: biggest tasks go out first, each to the queue
+    // with the least work in it so far
+    std::vector<size_t> order(costs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {return costs[a] > costs[b];});
+
+    std::vector<size_t> load(m_queues.size(), 0);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // A worker still in runOne() from the last batch can pick up a task the moment
+        // it is queued, without taking m_mutex, so the batch has to be set up first.
+        // The queue mutexes then publish these to whoever pops the task.
+        m_task = &task;
+        m_remaining = costs.size();
+        ++m_generation;
+        for (size_t i : order) {
+            size_t q = std::min_element(load.begin(), load.end()) - load.begin();
+            load[q] += costs[i];
+            std::lock_guard<std::mutex> qlock(m_queues[q]->mutex);
+            m_queues[q]->tasks.push_back(i);
+        }
+    }
+    m_wake.notify_all();
+
+    // Pitch in, then wait for any stragglers still running on other threads. m_task is
+    // left pointing at _task, nothing dereferences it once every task has finished.
+    while (runOne(0)) {}
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] {return m_remaining == 0;});
+}
+
+/**
+ * @brief WorkStealingPool::parallelFor
+ * @param count The number of tasks
+ * @param task Function called with each index in [0,count)
+ */
+void WorkStealingPool::parallelFor(size_t count, const std::function<void(size_t)> &task) {
+    run(std::vector<size_t>(count, 1), task);
+}
+
+void WorkStealingPool::workerLoop(size_t id) {
+    size_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] {return m_quit || m_generation != seen;});
+            if (m_quit) return;
+            seen = m_generation;
+        }
+        while (runOne(id)) {}
+    }
+}
+
+bool WorkStealingPool::runOne(size_t id) {
+    size_t task = 0;
+    bool found = false;
+
+    // Our own queue first, from the front where the big tasks are
+    {
+        Queue &own = *m_queues[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    // Otherwise steal the smallest task off the back of another queue
+    for (size_t i = 1; !found && i < m_queues.size(); ++i) {
+        Queue &victim = *m_queues[(id + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            found = true;
+        }
+    }
+    if (!found) return false;
+
+    (*m_task)(task);
+    if (--m_remaining == 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done.notify_all();
+    }
+    return true;
+}